@@ -0,0 +1,45 @@
+"""Checks the cycles ACC.cal spends on the einsums of this example.
+
+Runs the example and compares the compute and communicate cycles of each core
+against the expected ones, exiting non-zero on a mismatch. Run it from the
+repository root after building:
+
+    python3 examples/einsum/check.py
+"""
+import re
+import subprocess
+import sys
+
+SIMULATOR = "./build/bin/spatialsim"
+SPEC = "examples/einsum/task_spec"
+
+# core 0: abc,bcd,de->ae reads e from tensor 15, so 4*8*2*16*3 MACs at 256 per cycle
+# core 1: the second ab,bc->ac into 22 keeps its 64,16 dims, so 2 * 64*32*16 MACs
+#         and a 1024-element send
+# core 2: ab,bc->ac into 32 keeps the 8,8 given in the task file, so 32 sends
+#         64 elements to core 3
+# core 3: waits for 32
+COMPUTE = [11, 256, 5, 1]
+COMMUNICATE = [271, 26, 277, 281]
+
+
+def cycles(out, name):
+    return list(map(int, re.search(r"^{} cycles: *\n(.*)$".format(name), out, re.M).group(1).split()))
+
+
+def main():
+    out = subprocess.run([SIMULATOR, SPEC], check=True, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+                         universal_newlines=True).stdout
+    failed = False
+    for name, expected in (("compute", COMPUTE), ("communicate", COMMUNICATE)):
+        got = cycles(out, name)
+        if got != expected:
+            print("{} cycles: expected {}, got {}".format(name, expected, got))
+            failed = True
+    if failed:
+        sys.exit(1)
+    print("ACC.cal cycles match")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,169 @@
+"""Prints the calibration table of the analytic NoC model against booksim.
+
+Generates the workloads of the table into a scratch directory, runs each on
+both noc_models and prints their completion cycles, the communicate cycles of
+the busiest core and the run times as the markdown table in the README. Run it from the repository root after building:
+
+    python3 examples/noc_models/calibrate.py [--only <name>] [--keep <dir>] [--set <key>=<value> ...]
+"""
+import argparse
+import os
+import random
+import re
+import shutil
+import subprocess
+import tempfile
+import time
+
+SIMULATOR = "./build/bin/spatialsim"
+FLIT = 128          # elements per flit, as the NI splits a tensor
+
+SPEC = """log_file = {log};
+log_level = error;
+viewer_trace = 0;
+print_activity = 0;
+
+threshold = 10240;
+working_directory = {dir};
+tasks = {{{tasks}}};
+micro_instr_latency = ./runfiles/instr_latency;
+routing_board = {dir}/routing_board;
+deadlock_check_freq = 100000;
+
+noc_model = {model};
+topology = mesh;
+k = {k};
+n = 2;
+
+sim_type = throughput;
+sim_power = 1;
+channel_width = 128;
+router = mc;
+routing_function = src_routing;
+num_vcs = 4;
+vc_buf_size = 2;
+tech_file = runfiles/noc/techfile.txt;
+"""
+
+# name, k, sends per core, destinations per send, largest tensor in flits
+WORKLOADS = [
+    ("4x4 mesh, 6 random unicasts per core", 4, 6, 1, 16),
+    ("8x8 mesh, 6 random unicasts per core", 8, 6, 1, 16),
+    ("8x8 mesh, 30 random unicasts per core", 8, 30, 1, 16),
+    ("16x16 mesh, 6 random unicasts per core", 16, 6, 1, 16),
+    ("16x16 mesh, 30 random unicasts per core", 16, 30, 1, 16),
+    ("32x32 mesh, 4 random unicasts per core", 32, 4, 1, 16),
+    ("8x8 mesh, 10 4-way sends per core", 8, 10, 4, 16),
+]
+
+
+def generate(dir, k, sends, fanout, flits, seed=1):
+    """Writes the task files and the routing board of a workload into dir.
+
+    Every core sends `sends` tensors of 1 to `flits` flits to `fanout` random
+    other cores, with a short random sleep before each, and then receives what
+    was sent to it. A send to several cores takes a star of dimension-order
+    routes, which is a multicast on a MULTICAST build."""
+    rng = random.Random(seed)
+    nodes = k * k
+    ops = [[] for _ in range(nodes)]
+    data = [[] for _ in range(nodes)]
+    recvs = [[] for _ in range(nodes)]
+    board = []
+    for c in range(nodes):
+        for i in range(sends):
+            tid = (c + 1) * 1000 + i
+            size = rng.randint(1, flits) * FLIT
+            dests = rng.sample([d for d in range(nodes) if d != c], fanout)
+            ops[c].append("CPU.sleep {}".format(rng.randint(1, 20)))
+            ops[c].append("NI.send {} {}".format(tid, " ".join(map(str, dests))))
+            data[c].append("{} # {} # {}".format(tid, ", ".join(map(str, dests)), size))
+            for d in dests:
+                recvs[d].append("NI.recv {}".format(tid))
+                data[d].append("{} # {} # {}".format(tid, c, size))
+            if fanout > 1:
+                board.append("{} {} {}\n".format(tid, c, " ".join(map(str, dests)))
+                             + "".join("{} {}\n".format(c, d) for d in dests))
+
+    for c in range(nodes):
+        with open(os.path.join(dir, "c{}.inst".format(c)), "w") as f:
+            f.write("operators:\n{\n")
+            f.write("".join("assemble # {}\n".format(op) for op in ops[c] + recvs[c]))
+            f.write("}\n\ndata:\n")
+            f.write("".join(line + "\n" for line in data[c]))
+    with open(os.path.join(dir, "routing_board"), "w") as f:
+        f.write("\n".join(board))
+    return nodes
+
+
+def spec(dir, k, nodes, model, options):
+    path = os.path.join(dir, "task_" + model)
+    with open(path, "w") as f:
+        f.write(SPEC.format(log=os.path.join(dir, "log_" + model), dir=dir, k=k, model=model,
+                            tasks=",".join("c{}.inst".format(c) for c in range(nodes))))
+        f.write("".join("{} = {};\n".format(*option.split("=", 1)) for option in options))
+    return path
+
+
+def run(path, log):
+    start = time.time()
+    out = subprocess.run([SIMULATOR, path], check=True, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+                         universal_newlines=True).stdout
+    seconds = time.time() - start
+    communicate = max(map(int, re.search(r"^communicate cycles: *\n(.*)$", out, re.M).group(1).split()))
+    with open(log) as f:
+        cycles = int(re.search(r"^(\d+) \| Task Is Finished", f.read(), re.M).group(1))
+    return cycles, communicate, seconds
+
+
+def compare(name, dir, k, nodes, options):
+    booksim, booksim_comm, booksim_time = run(spec(dir, k, nodes, "booksim", options), os.path.join(dir, "log_booksim"))
+    analytic, analytic_comm, analytic_time = run(spec(dir, k, nodes, "analytic", options), os.path.join(dir, "log_analytic"))
+    error = (analytic - booksim) * 100.0 / booksim
+    # Runs under a second are mostly the start-up
+    speedup = "{:.0f}x".format(booksim_time / analytic_time) if booksim_time > 1 else "-"
+    print("| {} | {} | {} | {:+.1f}% | {} / {} | {} |".format(name, booksim, analytic, error, booksim_comm, analytic_comm,
+                                                           speedup).replace("+0.0%", "0.0%"))
+
+
+def ring(dir, elements):
+    """The ring example with tensors of `elements` elements."""
+    for c in range(4):
+        with open("examples/ring/c{}.inst".format(c)) as f:
+            text = f.read()
+        with open(os.path.join(dir, "c{}.inst".format(c)), "w") as f:
+            f.write(re.sub(r"# 8\.0$", "# {}".format(elements), text, flags=re.M))
+    open(os.path.join(dir, "routing_board"), "w").close()
+    return 4
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--only", help="run the workloads whose name contains this")
+    parser.add_argument("--keep", help="generate into this directory and keep it")
+    parser.add_argument("--set", nargs="*", default=[], metavar="KEY=VALUE",
+                        help="append these options to the task specs of both models")
+    args = parser.parse_args()
+
+    rows = [("`examples/ring`", 2, lambda d: ring(d, 8)),
+            ("`examples/ring`, 1024-element tensors", 2, lambda d: ring(d, 1024))]
+    rows += [(name, k, lambda d, w=(k, sends, fanout, flits): generate(d, *w))
+             for name, k, sends, fanout, flits in WORKLOADS]
+
+    print("| Workload | booksim | analytic | Error | Communicate | Speedup |")
+    print("|----------|---------|----------|-------|-------------|---------|")
+    for i, (name, k, make) in enumerate(rows):
+        if args.only and args.only not in name:
+            continue
+        dir = os.path.join(args.keep, str(i)) if args.keep else tempfile.mkdtemp()
+        os.makedirs(dir, exist_ok=True)
+        dir = os.path.abspath(dir)
+        try:
+            compare(name, dir, k, make(dir), args.set)
+        finally:
+            if not args.keep:
+                shutil.rmtree(dir)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,64 @@
+"""Prints the speedup of parallel core and network stepping on a 16x16 mesh.
+
+Generates the 16x16 mesh workload of the NoC model table, runs it serially
+and with more core_threads and noc_threads, checks that every run finishes at
+the same cycle and prints the median run times as the markdown table in the
+README, under the number of hardware threads of the host. Run it from the
+repository root after building:
+
+    python3 examples/parallel/speedup.py [--runs <n>] [--keep <dir>] [--set <key>=<value> ...]
+"""
+import argparse
+import os
+import shutil
+import statistics
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "noc_models"))
+import calibrate  # noqa: E402
+
+K = 16
+SENDS = 30
+# core_threads, noc_threads
+THREADS = [(1, 1), (2, 1), (4, 1), (1, 2), (1, 4), (4, 4)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--runs", type=int, default=3, help="runs of each setting, of which the median is taken")
+    parser.add_argument("--keep", help="generate into this directory and keep it")
+    parser.add_argument("--set", nargs="*", default=[], metavar="KEY=VALUE",
+                        help="append these options to the task specs")
+    args = parser.parse_args()
+
+    dir = args.keep if args.keep else tempfile.mkdtemp()
+    os.makedirs(dir, exist_ok=True)
+    dir = os.path.abspath(dir)
+    try:
+        nodes = calibrate.generate(dir, K, SENDS, 1, 16)
+        print("{}x{} mesh, {} random unicasts per core, booksim. Hardware threads of the host: {}".format(
+            K, K, SENDS, os.cpu_count()))
+        print()
+        print("| core_threads | noc_threads | Cycles | Seconds | Speedup |")
+        print("|--------------|-------------|--------|---------|---------|")
+        serial = None
+        for cores, routers in THREADS:
+            options = ["core_threads={}".format(cores), "noc_threads={}".format(routers)] + args.set
+            path = calibrate.spec(dir, K, nodes, "booksim", options)
+            runs = [calibrate.run(path, os.path.join(dir, "log_booksim")) for _ in range(args.runs)]
+            cycles = runs[0][0]
+            seconds = statistics.median(seconds for _, _, seconds in runs)
+            if serial is None:
+                serial = (cycles, seconds)
+            elif cycles != serial[0]:
+                sys.exit("{} core_threads and {} noc_threads finish at {}, not {}".format(cores, routers, cycles,
+                                                                                          serial[0]))
+            print("| {} | {} | {} | {:.2f} | {:.2f}x |".format(cores, routers, cycles, seconds, serial[1] / seconds))
+    finally:
+        if not args.keep:
+            shutil.rmtree(dir)
+
+
+if __name__ == "__main__":
+    main()
@@ -15,6 +15,18 @@ class Simulator:
         self.instance = S.SpatialChip(self.spec)
         os.chdir(prev_cwd)
 
+    def reset(self, **parameters):
+        '''Rewinds the chip for another episode, optionally with other NoC
+        parameters or micro_instr_latency. The tasks are not parsed again.
+        '''
+        if parameters:
+            prev_cwd = os.getcwd()
+            os.chdir(self.working_dir)
+            self.instance.reconfigure(parameters)
+            os.chdir(prev_cwd)
+        else:
+            self.instance.reset()
+
     def run(self) -> int:
         self.cycle = self.instance.run()
         return self.cycle
@@ -29,8 +41,23 @@ class Simulator:
         core_busy_ratio = [comp / (comm + comp + 1) for comp, comm in zip(self.compute_cycles(), self.communicate_cycles())]
         return core_busy_ratio
     
-    def router_conflict_factor(self) -> list:
-        return self.instance.router_conflict_factors()
+    def router_conflict_factor(self, window=False):
+        '''The share of allocation requests each router denied, as a NumPy
+        array. With window=True, only since the previous windowed call.
+        '''
+        return self.instance.router_conflict_factors(window)
+
+    def router_port_conflicts(self) -> dict:
+        '''Requests, grants and denials of each output port of each router,
+        as NumPy arrays of routers x ports.
+        '''
+        return self.instance.router_port_conflicts()
+
+    def telemetry(self) -> dict:
+        '''The samples taken every telemetry_interval cycles, as NumPy arrays
+        of samples x values by column name.
+        '''
+        return self.instance.telemetry()
 
     def print_stats(self):
         print("Overall Cycles: {}, Core busy ratio: {}".format(self.cycle, self.core_busy_ratio()))
@@ -0,0 +1,269 @@
+#include <climits>
+#include <functional>
+#include <iostream>
+#include "analytic_noc.hpp"
+
+#include "routefunc.hpp"
+#include "globals.hpp"
+#include "misc_utils.hpp"
+
+
+spatial::AnalyticNoC::AnalyticNoC(BookSimConfig config, PCNInterfaceSet send_queues_, PCNInterfaceSet receive_queues_, LogSink* log) {
+    if (config.GetStr("topology") != "mesh") {
+        throw "The analytic noc_model only models a mesh !!";
+    }
+    if (config.GetInt("subnets") != 1) {
+        throw "The number of subnets is not 1 !!";
+    }
+    _k = config.GetInt("k");
+    _n = config.GetInt("n");
+    _nodes = powi(_k, _n);
+    _hop_latency = config.GetInt("routing_delay") + config.GetInt("vc_alloc_delay") + config.GetInt("sw_alloc_delay")
+                 + config.GetInt("st_prepare_delay") + config.GetInt("st_final_delay");
+    _vc_buf = config.GetInt("vc_buf_size");
+    _credit_loop = config.GetInt("sw_alloc_delay") + config.GetInt("st_prepare_delay") + config.GetInt("st_final_delay")
+                 + config.GetInt("credit_delay") + 2;
+    _lanes = std::max(1, std::min(config.GetInt("num_vcs"), (_credit_loop + _vc_buf - 1) / _vc_buf));
+    _buffer = config.GetInt("analytic_buffer");
+    for (int d = 0; d < _n; ++d) {
+        _stride.push_back(powi(_k, d));
+    }
+
+    // The routes are those of the mesh booksim would build
+    gK = _k;
+    gN = _n;
+    gNodes = _nodes;
+    InitializeRoutingMap(config);
+
+    _send_queues = send_queues_;
+    _receive_queues = receive_queues_;
+    _log = log;
+
+    _time = 0;
+    _inject_free.assign(_nodes, 0);
+    _inject_start.assign(_nodes, 0);
+    _inject_size.assign(_nodes, 0);
+    _eject_free.assign(_nodes * _lanes, 0);
+    _link_free.assign(_nodes * 2 * _n, 0);
+    _link_flits.assign(_link_free.size(), 0);
+    _seq = 0;
+    _cur_pid = 0;
+    _cur_id = 0;
+    _in_flight = 0;
+}
+
+
+// The output port at router towards the next hop of the segment, past the hops
+// it has reached, as FocusFlit routes
+int spatial::AnalyticNoC::_Port(const RoutingBoard& board, int seg, int& hop, int router) const {
+    const RoutingBoard::Seg& s = board.seg(seg);
+    while (hop < s.hop_end && board.hop(hop) == router) {
+        ++hop;
+    }
+    return dor_next_mesh(router, hop < s.hop_end ? board.hop(hop) : s.end);
+}
+
+
+// A head that leaves a router on cycle `leave` keeps the links behind it on the
+// branch busy until the flits queued there fit into the buffers in between
+void spatial::AnalyticNoC::_Hold(long long leave, int size) {
+    for (int d = (int)_path.size() - 1; d >= 0; --d) {
+        int rest = size - (int)(_path.size() - d) * _buffer;
+        if (rest <= 0) {
+            break;
+        }
+        long long free = leave + _Stream(rest) + 1;
+        if (_link_free[_path[d]] >= free) {
+            break;
+        }
+        _link_free[_path[d]] = free;
+    }
+}
+
+
+// Times the packet down its routing tree, branch by branch, reserving the
+// ports it takes from `start` on, when its source begins to inject it
+void spatial::AnalyticNoC::_Send(int src, const Packet& packet, long long start) {
+    const RoutingBoard& board = *packet.board;
+    int root;
+    if (packet.type == Packet::TransferType::_MULTICAST) {
+        root = board.findSeg(packet.tree, std::make_pair(TREESTART, src));
+    } else {
+        std::vector<int> dests = board.getDestNodes(packet.tree);
+        assert(dests.size() == 1);
+        root = board.findSeg(packet.tree, std::make_pair(src, dests.front()));
+    }
+    assert(root >= 0);
+
+    int const size = packet.size;
+    int const busy = _Stream(size) + 1;     // the cycles it holds a port
+    int const pid = _cur_pid++;
+    int const head = _cur_id;
+    _cur_id += size;
+    // The next head waits for the credit of the tail to come back
+    _inject_free[src] = start + busy + _credit_loop;
+    _inject_start[src] = start;
+    _inject_size[src] = size;
+
+    _branches.clear();
+    _branches.push_back(Branch{root, board.seg(root).hop_begin, src, start, 1, -1});
+    while (!_branches.empty()) {
+        Branch b = _branches.back();
+        _branches.pop_back();
+        const RoutingBoard::Seg& s = board.seg(b.seg);
+        _path.clear();
+        if (b.link >= 0) {
+            _path.push_back(b.link);
+        }
+
+        while (b.router != s.end) {
+            int port = _Port(board, b.seg, b.hop, b.router);
+            int link = b.router * 2 * _n + port;
+            // The channel is the last stage of the router pipeline
+            b.arrive = _Take(_link_free[link], b.arrive, busy);
+            _Hold(b.arrive, size);
+            _path.push_back(link);
+            _link_flits[link] += size;
+            b.router = _Next(b.router, port);
+            ++b.hops;
+        }
+
+        // The head leaves for the ejection port and all the succeeding segments at once
+        long long leave = b.arrive + _hop_latency;
+        int eject = s.eject ? _Lane(b.router) : -1;
+        if (eject >= 0) {
+            leave = std::max(leave, _eject_free[eject]);
+        }
+        for (int c = s.child_begin; c < s.child_end; ++c) {
+            int hop = board.seg(c).hop_begin;
+            leave = std::max(leave, _link_free[b.router * 2 * _n + _Port(board, c, hop, b.router)]);
+        }
+        _Hold(leave, size);
+        if (eject >= 0) {
+            // The lane stays busy with the rest of the flits after the head is delivered
+            _eject_free[eject] = leave + busy;
+            Delivery d = {leave + 2, _seq++, b.router, head, pid, src, b.hops, (int)(leave - start + 2), packet};
+            _deliveries.push_back(d);
+            std::push_heap(_deliveries.begin(), _deliveries.end(), std::greater<Delivery>());
+            _tails.push_back(std::make_pair(leave + _Stream(size) + 2, size));
+            std::push_heap(_tails.begin(), _tails.end(), std::greater<std::pair<long long, int>>());
+            _in_flight += size;
+        }
+        for (int c = s.child_begin; c < s.child_end; ++c) {
+            int hop = board.seg(c).hop_begin;
+            int port = _Port(board, c, hop, b.router);
+            int link = b.router * 2 * _n + port;
+            _link_free[link] = leave + busy;
+            _link_flits[link] += size;
+            _branches.push_back(Branch{c, hop, _Next(b.router, port), leave, b.hops + 1, link});
+        }
+    }
+}
+
+
+// A source takes the next packet once the previous one is injected, a
+// destination gets it on the cycle its head arrives, and its flits retire
+// with the tail
+void spatial::AnalyticNoC::step(clock_t clock) {
+    for (int n = 0; n < _nodes; ++n) {
+        std::queue<Packet>& q = *(*_send_queues)[n];
+        if (!q.empty() && _inject_free[n] <= (long long)clock) {
+            _Send(n, q.front(), clock);
+            q.pop();
+        }
+    }
+
+    while (!_deliveries.empty() && _deliveries.front().time <= (long long)clock) {
+        std::pop_heap(_deliveries.begin(), _deliveries.end(), std::greater<Delivery>());
+        Delivery& d = _deliveries.back();
+        _log->Log(EVENT_RETIRE_FLIT, clock, d.flit, d.pid, d.src, d.node, d.hops, d.flat);
+        (*_receive_queues)[d.node]->push(d.packet);
+        _deliveries.pop_back();
+    }
+    while (!_tails.empty() && _tails.front().first <= (long long)clock) {
+        std::pop_heap(_tails.begin(), _tails.end(), std::greater<std::pair<long long, int>>());
+        _in_flight -= _tails.back().second;
+        _tails.pop_back();
+    }
+    _time = clock + 1;
+}
+
+void spatial::AnalyticNoC::skip(clock_t clock, int cycles) {
+    _time = clock + cycles;
+}
+
+bool spatial::AnalyticNoC::idle() const {
+    if (!_deliveries.empty() || !_tails.empty()) {
+        return false;
+    }
+    for (const CNInterface& q: *_send_queues) {
+        if (!q->empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The first source that can take a packet, the first delivery or the first
+// tail to retire, whichever comes first
+unsigned int spatial::AnalyticNoC::next_event(clock_t clock) {
+    long long next = _deliveries.empty() ? UINT_MAX : _deliveries.front().time;
+    if (!_tails.empty()) {
+        next = std::min(next, _tails.front().first);
+    }
+    for (int n = 0; n < _nodes; ++n) {
+        if (!(*_send_queues)[n]->empty()) {
+            next = std::min(next, _inject_free[n]);
+        }
+    }
+    return next <= (long long)clock ? clock : (unsigned int)next;
+}
+
+void spatial::AnalyticNoC::DisplayStats(std::ostream & os) {
+    os << "Analytic NoC: " << _cur_pid << " packets sent, "
+       << _deliveries.size() << " deliveries and " << _in_flight << " flits in flight" << std::endl;
+}
+
+// Packets are not arbitrated, they only queue for the ports
+std::vector<double> spatial::AnalyticNoC::router_conflict_factors(bool /* window */) {
+    return std::vector<double>(_nodes, 0.0);
+}
+
+// Counted when the packets are timed, which is before they get there
+void spatial::AnalyticNoC::read_link_flits(uint64_t* flits) {
+    std::copy(_link_flits.begin(), _link_flits.end(), flits);
+}
+
+void spatial::AnalyticNoC::read_router_occupancy(uint64_t* flits) {
+    std::fill(flits, flits + _nodes, 0);
+}
+
+void spatial::AnalyticNoC::read_waiting_flits(uint64_t* flits) {
+    for (int n = 0; n < _nodes; ++n) {
+        flits[n] = QueuedFlits::of(*(*_send_queues)[n])
+                   + _inject_size[n] - _Injected(_inject_size[n], _time - 1 - _inject_start[n]);
+    }
+}
+
+// The flits that have arrived, streaming in behind their heads at the rate
+// they were injected
+unsigned long spatial::AnalyticNoC::progress() {
+    unsigned long arrived = _cur_id - _in_flight;
+    for (const std::pair<long long, int>& tail: _tails) {
+        arrived += _Injected(tail.second, _time - 1 - (tail.first - _Stream(tail.second)));
+    }
+    return arrived;
+}
+
+int spatial::AnalyticNoC::router_port_conflicts(std::vector<unsigned long>& requests, std::vector<unsigned long>& grants) {
+    int ports = 2 * _n + 1;
+    requests.assign(_nodes * ports, 0);
+    grants.assign(_nodes * ports, 0);
+    return ports;
+}
+
+void spatial::AnalyticNoC::Checkpoint(StateArchive& ar) {
+    ar.Check(_nodes, "the number of routers");
+    ar & _time & _inject_free & _inject_start & _inject_size & _eject_free & _link_free & _link_flits & _deliveries & _tails;
+    ar & _seq & _cur_pid & _cur_id & _in_flight;
+}
@@ -0,0 +1,23 @@
+#include <iostream>
+#include <string>
+#include "parser.h"
+
+// Compiles a routing board from the text format into a board file, which
+// the simulator maps into memory instead of parsing it. Give the board file
+// as `routing_board` in the chip specification.
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " routing_board board_file" << std::endl;
+        return -1;
+    }
+
+    try {
+        std::shared_ptr<const RoutingBoard> board = spatial::PathParser::parsePathFile(argv[1]);
+        board->save(argv[2]);
+        std::cout << "Compiled " << board->size() << " trees of " << argv[1] << " into " << argv[2] << std::endl;
+    } catch (const std::string& e) {
+        std::cerr << "ERROR: " << e << std::endl;
+        return -1;
+    }
+    return 0;
+}
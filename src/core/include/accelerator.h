@@ -10,10 +10,10 @@ public:
 
     using COMPONENT::COMPONENT;
     ACCELERATOR(const std::map<std::string, float> mi_);
-    virtual int simple_sim(const std::string micro_instr, std::map<int, Tensor>& data, int clock_) override;
+    virtual int simple_sim(const CompInstr& instr, const OperandPool& pool, TensorTable& data, int clock_) override;
 
 private:
-    int pre_execute(const std::string& micro_instr, std::map<int, Tensor>& data);
+    int pre_execute(const CompInstr& instr, const OperandPool& pool, TensorTable& data);
 };
 
 }
@@ -9,7 +9,7 @@ class BUFFER : public COMPONENT {
 public:
     using COMPONENT::COMPONENT;
     BUFFER(const std::map<std::string, float> mi_);
-    virtual int simple_sim(const std::string micro_instr, std::map<int, Tensor>& data, int clock_) override;
+    virtual int simple_sim(const CompInstr& instr, const OperandPool& pool, TensorTable& data, int clock_) override;
 private:
     
 };
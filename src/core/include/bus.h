@@ -9,7 +9,7 @@ class BUS : public COMPONENT {
 public:
     using COMPONENT::COMPONENT;
     BUS(const std::map<std::string, float> mi_);
-    int simple_sim(const std::string micro_instr, std::map<int, Tensor>& data, int clock_) override;
+    int simple_sim(const CompInstr& instr, const OperandPool& pool, TensorTable& data, int clock_) override;
 
 };
 
@@ -4,22 +4,38 @@
 #include <string>
 #include "common.h"
 #include "bridge.hpp"
+#include "event_log.hpp"
+#include "micro_instr.h"
 
 namespace spatial {
 
-struct CompInstr;
-
 class COMPONENT {
 public:
-    COMPONENT(const std::string name_, const std::map<std::string, float> mi_);
+    COMPONENT(const std::string name_, CompIndex comp_, const std::map<std::string, float> mi_);
     const std::string name;
+    const CompIndex comp;
 
     void instruction_mismatch(const std::string& micro_instr);
-    virtual int simple_sim(const std::string micro_instr, std::map<int, Tensor>& data, int clock_);
+    virtual int simple_sim(const CompInstr& instr, const OperandPool& pool, TensorTable& data, int clock_);
     virtual void DisplayStats(ostream & os = cout );
 
+    void SetLogSink(LogSink* log) { _log = log; }
+    // Replaces the latencies given at construction, e.g. between two runs
+    void SetLatency(const std::map<std::string, float>& mi_);
+
 protected:
-    std::map<std::string, float> _micro_instr_latency;
+    static constexpr float MISSING_LATENCY = -1;
+    float _latency[NUM_OPCODES];    // per opcode, MISSING_LATENCY if the latency file has none
+
+    // The latency of the opcode, or exits if this module can not execute it
+    float latency(const CompInstr& instr) {
+        if (instr.comp != comp || _latency[instr.op] == MISSING_LATENCY) {
+            instruction_mismatch(OPCODES[instr.op].name);
+        }
+        return _latency[instr.op];
+    }
+
+    LogSink* _log;              // where events go, the default text log if not attached to a simulation
 };
 
 };
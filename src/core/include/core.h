@@ -3,6 +3,7 @@
 
 #include <fstream>
 #include <map>
+#include <random>
 #include "common.h"
 #include "network_interface.h"
 #include "bus.h"
@@ -14,43 +15,80 @@
 
 namespace spatial {
 
-extern int array_size;
-
 class CORE {
 public:
 
     // initialization
-    CORE(const std::string&, const std::string&, const std::string&, int, CNInterface, CNInterface , std::shared_ptr<std::vector<bool> >, int, int);
+    // The compiled tasks are only read, so forks of a chip share them with it,
+    // as cores share the routing board
+    CORE(std::shared_ptr<const CompiledTasks> tasks, const LatencyTable& latency, std::shared_ptr<const RoutingBoard>, 
+         int, CNInterface, CNInterface , std::shared_ptr<std::vector<bool> >, int, int);
     void SetupSim();
     
     // execute
     void ClockTick(int clock);
 
-    shared_ptr<COMPONENT> getExecuteComponent(std::string instr);
+    // The two halves of ClockTick. PrepareTick only touches the core's private 
+    // state and selects the instruction to issue; IssueTick executes it, which 
+    // may read the credit board. Parallel steps run them separated by a barrier.
+    void PrepareTick(int clock);
+    void IssueTick(int clock);
+    void StageCredit(CreditStage& stage) const;
+    void SetCreditStage(const CreditStage* stage);
+    void SetLogSink(LogSink* log);
+    // Replaces the latencies of the modules
+    void SetLatency(const LatencyTable& latency);
+    std::shared_ptr<const CompiledTasks> program() const { return _program; }
+
+    COMPONENT* getExecuteComponent(const CompInstr& instr) const;
     int selectActiveTask(int clock);
     bool isBusy(int clock);
+    int wakeupCycle(int clock) const;
+    void Skip(int clock);
     void DisplayStats(ostream & os = std::cout ) const;
+    void DisplayInitialization(ostream & os) const;
+
+    // Saves or loads the progress of the tasks and the state of the modules.
+    // The tasks themselves come from the task files.
+    void Checkpoint(StateArchive& ar);
 
     // statistics functions
     int getBusyCycles() const;
     int getIdleCycles() const;
+    int getReceiveDepth() const;
 
 protected:
     std::vector<shared_ptr<COMPONENT>> _modules;
-    std::vector<std::queue<std::string>> _tasks;
+    std::shared_ptr<const CompiledTasks> _program;  // the tasks as compiled, kept to start over
+    std::vector<std::queue<CompInstr>> _tasks;      // what is left of them
+    std::vector<int> _text_ids;             // ids of the program's texts in _log, -1 until first logged
     std::vector<int> _cycle_to_issue;
-    std::map<int, Tensor> data;
+    TensorTable data;
     int cid;
 
+    // the task selected by PrepareTick, -1 if nothing to issue
+    int _staged_task;
+    COMPONENT* _staged_executer;
+    shared_ptr<NI> _ni;
+
+    std::minstd_rand _rng;      // per-core, so that the task order doesn't depend on the stepping order
+    LogSink* _log;
+    int _internText(int text);
+
     // statistics tracking
     int _busy_cycles;
     int _idle_cycles;
     int _last_clock;
+    unsigned long _progress;
+    void _updateStats(int clock);
 
 public:
     // control
-    inline bool equalTo(CORE& other) const {
-        return _cycle_to_issue == other._cycle_to_issue && _tasks == other._tasks;
+    // Monotonic count of issued and retired instructions, plus the NI's packets.
+    // The core state only changes when it grows, so comparing two readings is
+    // enough to tell whether the core moved on.
+    inline unsigned long progress() const {
+        return _progress + _ni->Progress();
     }
 
     inline bool finishAllTasks(int clock) const {
@@ -1,17 +1,99 @@
 #ifndef __MICRO_INSTR_H__
 #define __MICRO_INSTR_H__
 
+#include <string>
 #include <vector>
-#include "component.h"
 
 namespace spatial {
+
+    // Position of each hardware module in CORE::_modules
+    enum CompIndex {
+        COMP_BUS,
+        COMP_CPU,
+        COMP_ACC,
+        COMP_BUFFER,
+        COMP_NI,
+        NUM_COMPS
+    };
+
+    enum Opcode {
+        OP_BUS_TRANS,           // tensor
+        OP_BUFFER_READ,         // tensor
+        OP_BUFFER_WRITE,        // tensor
+        OP_CPU_SLEEP,           // cycles
+        OP_CPU_POLL,
+        OP_CPU_RESHAPE,         // tensor, dims...
+        OP_ACC_CAL,             // out tensor, in tensors..., the einsum or conv in config
+        OP_NI_SEND,             // tensor, dest nodes...
+        OP_NI_RECV,             // tensor
+        NUM_OPCODES
+    };
+
+    struct OpcodeInfo {
+        const char* name;       // as written in task files and the latency file
+        CompIndex comp;
+        int tensors;            // how many leading operands are tensors, -1 for all of them
+    };
+
+    static const OpcodeInfo OPCODES[NUM_OPCODES] = {
+        {"BUS.trans", COMP_BUS, 1},
+        {"BUFFER.read", COMP_BUFFER, 1},
+        {"BUFFER.write", COMP_BUFFER, 1},
+        {"CPU.sleep", COMP_CPU, 0},
+        {"CPU.poll", COMP_CPU, 0},
+        {"CPU.reshape", COMP_CPU, 1},
+        {"ACC.cal", COMP_ACC, -1},
+        {"NI.send", COMP_NI, 1},
+        {"NI.recv", COMP_NI, 1},
+    };
+
+    // The einsum of an ACC.cal, e.g. "ab,bc->ac", as positions into the dims of
+    // its input tensors. The dims are only known when it's issued.
+    struct Einsum {
+        struct Dim {
+            int input;      // which input tensor
+            int dim;        // which of its dims
+            int next_dim;   // the same index in input + 1, -1 if it's the only input
+        };
+        std::string text;
+        int inputs;                     // how many input tensors it names
+        std::vector<Dim> contracted;    // the indices summed over
+        std::vector<Dim> output;        // where each output index is read from
+        bool scalar;                    // the output has no index at all
+
+        // Returns false if the text is not an einsum of that many inputs
+        static bool decode(const std::string& text, int inputs, Einsum& einsum);
+    };
+
+    // The operands and einsums of a core's micro-instructions, which CompInstr
+    // refers to by position so that it stays a fixed-size record
+    struct OperandPool {
+        std::vector<int> values;
+        std::vector<Einsum> einsums;
+
+        // The index of the einsum, decoded the first time it's seen, or -1
+        // if the text is not an einsum of that many inputs
+        int einsum(const std::string& text, int inputs);
+    };
+
+    // A micro-instruction decoded once when the task file is compiled, so that
+    // executing it needs no string work.
     struct CompInstr {
-        std::shared_ptr<COMPONENT> executer;    // which item to execute
-        std::shared_ptr<int> command;           // point to a CompInstr within the micro instruction board
-        std::vector<int> paras;                 // parameter
+        Opcode op;
+        CompIndex comp;                 // which module executes it
+        int text;                       // the source line, in the core's instruction text table
+        int first;                      // its integer operands are values[first, first + count) of
+        int count;                      // the core's OperandPool, tensors as indices into its TensorTable
+        int einsum;                     // ACC.cal only: the einsum in the OperandPool, -1 for conv
+
+        const int* paras(const OperandPool& pool) const { return pool.values.data() + first; }
+
+        // Returns false if the line is not a known micro-instruction. Its 
+        // operands are appended to the pool.
+        static bool decode(const std::string& line, CompInstr& instr, OperandPool& pool);
     };
 
 }
 
 
-#endif
\ No newline at end of file
+#endif
@@ -2,6 +2,7 @@
 #define _NI_H
 
 #include <queue>
+#include <unordered_map>
 #include "component.h"
 #include "bridge.hpp"
 #include "path.hpp"
@@ -9,6 +10,32 @@
 
 namespace spatial {
 
+// Packets that arrived at a core, indexed by fid. Taking one is O(1), and 
+// packets with the same fid leave in the order they arrived.
+class Mailbox {
+public:
+    Mailbox(): _free(-1), _size(0) { }
+    void push(const Packet& p);
+    bool take(int fid, Packet& p);
+    int size() const { return _size; }
+    void Checkpoint(StateArchive& ar) {
+        ar & _slots & _free & _fids & _size;
+    }
+
+private:
+    struct Slot {
+        Packet packet;
+        int next;
+        void Checkpoint(StateArchive& ar) {
+            ar & packet & next;
+        }
+    };
+    std::vector<Slot> _slots;       // recycled through the _free list
+    int _free;
+    std::unordered_map<int, std::pair<int, int> > _fids;   // fid -> first and last slot, -1 if none
+    int _size;
+};
+
 class NI : public COMPONENT {
 using COMPONENT::COMPONENT;
 
@@ -16,28 +43,50 @@ protected:
     int width;
     int cid;
     int threshold;
-    bool _doorbell(const std::set<int>& dests);
+    bool _doorbell(const std::vector<int>& dests);
     bool _send_package(const Packet&);
     bool _receive_package(int, Tensor&);
+    void _collect();
+    std::shared_ptr<const RoutingBoard> _unicastPath(int src, int dest);
 
 public:
-    virtual int simple_sim(const std::string micro_instr, std::map<int, Tensor>& data, int clock_) override;
+    virtual int simple_sim(const CompInstr& instr, const OperandPool& pool, TensorTable& data, int clock_) override;
     virtual void DisplayStats(std::ostream & os = cout) override;
 
     Packet GeneratePacket(const Tensor& tensor, const std::vector<int>& dests, int src);
     std::pair<CNInterface, CNInterface> GetQueuePairs();
 
+    // Packets delivered to the core and not taken by an NI.recv yet
+    int ReceiveDepth() const { return _receive_queue->size() + _mailbox.size(); }
+    // The credit this NI publishes on the credit board: whether it accepts packets
+    bool PipeOpen() const { return ReceiveDepth() <= threshold; }
+    void SetCreditStage(const CreditStage* stage) { _stage = stage; }
+
+    // Monotonic count of packets handed to and taken from the network
+    unsigned long Progress() const { return _sent + _received; }
+
+    // The send and receive queues belong to the chip, which saves them
+    void Checkpoint(StateArchive& ar) {
+        ar & _mailbox & _sent & _received & _clock;
+    }
+
     NI(CNInterface sq_, CNInterface rq_, std::shared_ptr<std::vector<bool> > pipe_open_, 
-       std::map<std::string, float> mi_, int cid_, const std::string& rb_file, 
+       std::map<std::string, float> mi_, int cid_, std::shared_ptr<const RoutingBoard> routing_board_, 
        int threshold_, int width_);
     ~NI() { }
 
 protected:
     CNInterface _send_queue, _receive_queue;
-    std::shared_ptr<std::vector<bool> > _pipe_open;
+    Mailbox _mailbox;               // packets moved out of _receive_queue, waiting for their NI.recv
+    std::map<Segment, std::shared_ptr<const RoutingBoard> > _unicast_paths;    // src-dest -> a board of that one tree
+    std::shared_ptr<std::vector<bool> > _pipe_open;      // one credit per core of the array
+    std::shared_ptr<const RoutingBoard> _routing_board;  // tid -> multicast tree, shared by the NIs of the array
+    const CreditStage* _stage;      // set during parallel core steps, see CoreArray::step
+    unsigned long _sent, _received;
+    int _clock;                     // cycle of the micro-instruction being simulated, for log records
 };
 
-extern std::shared_ptr<std::map<int, MCTree> > routing_board;
+
 
 }
 
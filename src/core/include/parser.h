@@ -1,18 +1,30 @@
 #ifndef __TASK_H__
 #define __TASK_H__
 
+#include <istream>
 #include <string>
 #include <vector>
 #include <queue>
 #include <map>
+#include <memory>
 
 #include "bridge.hpp"
 #include "operator.hpp"
 #include "path.hpp"
+#include "micro_instr.h"
 
 namespace spatial {
 
 
+// A task file lowered by TaskParser, ready to be handed to a core
+struct CompiledTasks {
+    std::vector<std::queue<CompInstr>> instrs;
+    OperandPool operands;
+    std::vector<std::string> texts;
+    TensorTable data;
+    double seconds;     // how long compiling took
+};
+
 class TaskParser {
 
 private:
@@ -26,17 +38,29 @@ private:
 
     void _allocateMissingTensors();
     void _linkOpWithTensor();
-    void _generate(std::vector<std::queue<std::string>>&, std::map<int, Tensor>&);
+    void _generate(std::vector<std::queue<CompInstr>>&, OperandPool&, std::vector<std::string>&, TensorTable&);
+    static void _compile(const std::string& file, std::istream& in, std::vector<std::queue<CompInstr>>& _instrs, 
+                         OperandPool& _operands, std::vector<std::string>& _texts, TensorTable& _data);
 
 public:
-    static void compileTaskFile(const std::string& file, std::vector<std::queue<std::string>>& _instrs, std::map<int, Tensor>& _data);
+    // Lowers the task file to decoded micro-instructions. Their operands go to
+    // _operands, their source lines to _texts, one entry per distinct line, and
+    // the tensors they name to _data. With a cache directory, a task file 
+    // compiled before is loaded from there.
+    static void compileTaskFile(const std::string& file, std::vector<std::queue<CompInstr>>& _instrs, 
+                                OperandPool& _operands, std::vector<std::string>& _texts, TensorTable& _data, 
+                                const std::string& cache_dir = "");
 };
 
 
+// The latencies of the micro-instructions by module (BUS, CPU, ACC, BUFFER, NI)
+typedef std::map<std::string, std::map<std::string, float> > LatencyTable;
+
 class MIParser {
 
 public:
-    static void parseLatencyFile(const std::string& file, std::map<std::string, std::shared_ptr<std::map<std::string, float>>>& latency);
+    // Parsed once and shared by the cores of an array
+    static std::shared_ptr<const LatencyTable> parseLatencyFile(const std::string& file);
 };
 
 class PathParser {
@@ -48,7 +72,9 @@ private:
     void _parseSegment(const std::string& line, MCTree& tree);
 
 public:
-    static void parsePathFile(const std::string& file, std::map<int, MCTree>& path);
+    // A routing board in the text format, or a board file compiled from one by
+    // spatialsim_boardcompile, which is mapped instead of parsed
+    static std::shared_ptr<const RoutingBoard> parsePathFile(const std::string& file);
 };
 
 };
@@ -0,0 +1,34 @@
+#ifndef _WORKLOAD_CACHE_H
+#define _WORKLOAD_CACHE_H
+
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <vector>
+#include "bridge.hpp"
+#include "micro_instr.h"
+
+namespace spatial {
+
+// Task files compiled by TaskParser, kept in a directory so that later runs
+// skip parsing and lowering them. Each is a binary file named after a hash of
+// the task file's content, so an edited task file simply misses the cache.
+// Files that are stale, damaged or of another version are compiled again and
+// replaced.
+class WorkloadCache {
+public:
+    static uint64_t hash(const std::string& content);
+    static std::string path(const std::string& directory, uint64_t hash);
+
+    // Maps the cache file and decodes it, false if there is no valid one
+    static bool load(const std::string& path, uint64_t hash, std::vector<std::queue<CompInstr>>& instrs,
+                     OperandPool& operands, std::vector<std::string>& texts, TensorTable& data);
+    // Writes through a temporary file, so that concurrent runs never read a
+    // partial one. Failing to write only costs a warning.
+    static void store(const std::string& path, uint64_t hash, const std::vector<std::queue<CompInstr>>& instrs,
+                      const OperandPool& operands, const std::vector<std::string>& texts, const TensorTable& data);
+};
+
+}
+
+#endif
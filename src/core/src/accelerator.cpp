@@ -3,109 +3,68 @@
 
 namespace spatial {
 
-ACCELERATOR::ACCELERATOR(const std::map<std::string, float> mi_): COMPONENT("ACCELERATOR", mi_) { 
+ACCELERATOR::ACCELERATOR(const std::map<std::string, float> mi_): COMPONENT("ACCELERATOR", COMP_ACC, mi_) { 
     
 }
 
-int ACCELERATOR::pre_execute(const std::string& micro_instr, std::map<int, Tensor>& data) 
+int ACCELERATOR::pre_execute(const CompInstr& instr, const OperandPool& pool, TensorTable& data) 
 {
-    std::vector<std::string> inst = split(micro_instr, " ");
-    std::string inst_config = inst[1];
+    const int* paras = instr.paras(pool);
     int mac = 1;
 
-    if (inst_config == "conv") {
-        assert(inst_config.size() == 4);
-        Tensor& output = data[std::stoi(inst[2])];
+    if (instr.einsum < 0) {
+        // conv
+        Tensor& output = data[paras[0]];
         // FIXME: well ... it's ugly ...
-        Tensor& input = data[std::stoi(inst[4])];
-        Tensor& weight = data[std::stoi(inst[3])];
-        assert(input.dims.size() == 3);
-        assert(weight.dims.size() == 4);
+        Tensor& input = data[paras[2]];
+        Tensor& weight = data[paras[1]];
+        assert(input.rank() == 3);
+        assert(weight.rank() == 4);
 
-        if (output.dims.empty()) {
-            output.dims.push_back(weight.dims[0]);
-            output.dims.push_back(input.dims[1]);
-            output.dims.push_back(input.dims[2]);
+        if (output.rank() == 0) {
+            output.addDim(weight.dim(0));
+            output.addDim(input.dim(1));
+            output.addDim(input.dim(2));
         }
 
-        for (int d: output.dims) {
-            mac *= d;
-        }
-        for (int d: weight.dims) {
-            mac *= d;
-        }
-        mac /= weight.dims[0];
+        mac = output.size() * weight.size() / weight.dim(0);
     } else {
-        Tensor& output = data[std::stoi(inst[2])];
-
-        std::vector<std::string>::iterator iter = inst.begin();
-        inst.erase(iter, iter + 3);
-        std::vector<std::string> input = inst;
-        int input_num = input.size();
+        const Einsum& einsum = pool.einsums[instr.einsum];
+        const int* input = paras + 1;
+        Tensor& output = data[paras[0]];
+        bool infer_output = output.rank() == 0;     // keep the dims given in the task file
 
-        std::string input_dims = split(inst_config, "->")[0];
-        std::vector<std::string> input_dim = split(input_dims, ",");
-        std::string output_dim = split(inst_config, "->")[1];
-
-        if (input_num == 1) {
-            std::string t1 = input_dim[0];
-            for (int i = 0; i < t1.size(); i++) {
-                int position = output_dim.find(t1[i]);
-                if (position == output_dim.npos) {
-                    Tensor& input_i = data[std::stoi(input[0])];
-                    mac *= input_i.dims[i];
-                }
-            }
-        } else {
-            for (int i = 0; i < input_num - 1; i++) {
-                std::string t1 = input_dim[i];
-                std::string t2 = input_dim[i + 1];
-                for (int j = 0; j < t2.size(); j++) {
-                    int position = t1.find(t2[j]);
-                    int o_position = output_dim.find(t2[j]);
-                    if (position != t1.npos && o_position == output_dim.npos) {
-                        Tensor& input_i = data[std::stoi(input[i])];
-                        Tensor& input_i_nxt = data[std::stoi(input[i + 1])];
-                        if (input_i.dims[position] != input_i_nxt.dims[j]) {
-                          throw "Tensor Size Mismatch between Input Tensor " + input[i] + " and Tensor " + input[i + 1];
-                        }
-                        mac *= input_i.dims[position];
-                    }
+        for (const Einsum::Dim& d: einsum.contracted) {
+            Tensor& input_i = data[input[d.input]];
+            if (d.next_dim >= 0) {
+                Tensor& input_i_nxt = data[input[d.input + 1]];
+                if (input_i.dim(d.dim) != input_i_nxt.dim(d.next_dim)) {
+                    throw "Tensor Size Mismatch between Input Tensor " + std::to_string(input_i.tid) + " and Tensor " + std::to_string(input_i_nxt.tid);
                 }
             }
+            mac *= input_i.dim(d.dim);
         }
 
-        if (output_dim.size() != 0) {
-            for (int i = 0; i < output_dim.size(); i++) {
-                for (int j = 0; j < input_num; j++) {
-                    int position = input_dim[j].find(output_dim[i]);
-                    if (position != input_dim[j].npos) {
-                        Tensor& input_i = data[std::stoi(input[i])];
-                        mac *= input_i.dims[position];
-                        output.dims.push_back(input_i.dims[position]);
-                        break;
-                    }
-                }
+        for (const Einsum::Dim& d: einsum.output) {
+            Tensor& input_j = data[input[d.input]];
+            mac *= input_j.dim(d.dim);
+            if (infer_output) {
+                output.addDim(input_j.dim(d.dim));
             }
-        } else {
-            output.dims.push_back(1);
+        }
+        if (einsum.scalar && infer_output) {
+            output.addDim(1);
         }
     }
     return mac;
 }
 
-int ACCELERATOR::simple_sim(const std::string micro_instr, std::map<int, Tensor>& data, int clock_) {
+int ACCELERATOR::simple_sim(const CompInstr& instr, const OperandPool& pool, TensorTable& data, int clock_) {
 
     // FIXME: add concat support
-    std::vector<std::string> inst = split(micro_instr, " ");
-    std::string inst_type = inst[0];
-    std::map <std::string, float> ::iterator latency_iter = _micro_instr_latency.find(inst_type);
-    if (latency_iter == _micro_instr_latency.end()) {
-        instruction_mismatch(micro_instr);
-    } else {
-        int mac = pre_execute(micro_instr, data);
-        return clock_ + mac / latency_iter->second;
-    }
+    float cycles = latency(instr);
+    int mac = pre_execute(instr, pool, data);
+    return clock_ + mac / cycles;
     // if (mac != 0) {
     //     return clk >= std::ceil((float)mac / (latency_iter->second));
     // }
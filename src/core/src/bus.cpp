@@ -2,21 +2,15 @@
 
 namespace spatial {
 
-BUS::BUS(const std::map<std::string, float> mi_): COMPONENT("BUS", mi_) {
+BUS::BUS(const std::map<std::string, float> mi_): COMPONENT("BUS", COMP_BUS, mi_) {
 
 }
 
-int BUS::simple_sim(const std::string micro_instr, std::map<int, Tensor>& data, int clock_)
+int BUS::simple_sim(const CompInstr& instr, const OperandPool& pool, TensorTable& data, int clock_)
 {
-    std::vector<std::string> inst_fields = split(micro_instr, " ");
-    std::string inst_type = inst_fields[0];
-    std::map <std::string, float>::iterator iter = _micro_instr_latency.find(inst_type);
-    if (iter == _micro_instr_latency.end()) {
-        instruction_mismatch(micro_instr);
-    }
-
-    int size = data[std::stoi(inst_fields[1])].size();
-    return clock_ + size / iter->second;
+    float cycles = latency(instr);
+    int size = data[instr.paras(pool)[0]].size();
+    return clock_ + size / cycles;
 }
 
 }
\ No newline at end of file
@@ -2,17 +2,24 @@
 
 namespace spatial {
 
-COMPONENT::COMPONENT(const std::string name_, const std::map<std::string, float> mi_): name(name_), _micro_instr_latency(mi_) { }
+COMPONENT::COMPONENT(const std::string name_, CompIndex comp_, const std::map<std::string, float> mi_): name(name_), comp(comp_), _log(&EventLog::Default()) {
+    SetLatency(mi_);
+}
 
-int COMPONENT::simple_sim(const std::string micro_instr, std::map<int, Tensor>& data, int clock_) {
-    std::map <std::string, float>::iterator iter = _micro_instr_latency.find(micro_instr);
-    if (iter == _micro_instr_latency.end()) {
-        instruction_mismatch(micro_instr);
-    } else {
-        return clock_ + iter->second;
+void COMPONENT::SetLatency(const std::map<std::string, float>& mi_) {
+    for (int op = 0; op < NUM_OPCODES; ++op) {
+        auto iter = mi_.find(OPCODES[op].name);
+        _latency[op] = MISSING_LATENCY;
+        if (iter != mi_.end()) {
+            _latency[op] = iter->second;
+        }
     }
 }
 
+int COMPONENT::simple_sim(const CompInstr& instr, const OperandPool& /* pool */, TensorTable& data, int clock_) {
+    return clock_ + latency(instr);
+}
+
 void COMPONENT::instruction_mismatch(const std::string& micro_instr) {
     std::cerr << "ERROR | Module " << name << " can not execute the instruction " << micro_instr << std::endl;
     exit(0);
@@ -22,4 +29,4 @@ void COMPONENT::DisplayStats(std::ostream & os) {
     // TODO:
 }
 
-};
\ No newline at end of file
+};
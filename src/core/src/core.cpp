@@ -2,6 +2,7 @@
 #include <fstream>
 #include <string>
 #include <algorithm>
+#include <climits>
 #include "core.h"
 #include "bridge.hpp"
 #include "parser.h"
@@ -9,71 +10,70 @@
 namespace spatial {
 using namespace std;
 
+// The modules in CompIndex order, by their names in the latency file
+static const char* const MODULE_NAMES[NUM_COMPS] = {"BUS", "CPU", "ACC", "BUFFER", "NI"};
+
 CORE::CORE(
-    const string& instruction_file, const string& latency_file, const string& rb_file, 
+    shared_ptr<const CompiledTasks> tasks, const LatencyTable& latency, shared_ptr<const RoutingBoard> routing_board, 
     int cid_, CNInterface sq_, CNInterface rq_, shared_ptr<vector<bool> > pipe_open_, 
-    int threshold_, int width_ = 128
-): cid(cid_), _busy_cycles(0), _idle_cycles(0), _last_clock(0)
+    int threshold_, int width_
+): cid(cid_), _staged_task(-1), _staged_executer(nullptr), _rng(cid_ + 1), _log(&EventLog::Default()),
+   _busy_cycles(0), _idle_cycles(0), _last_clock(0), _progress(0)
 {
-    clock_t start, end;
-    start = clock();
-
-    // Setup hardare modules
-    map<string, shared_ptr<map<string, float>> > latency = {
-        {"BUS", make_shared<map<string, float>>()}, 
-        {"CPU", make_shared<map<string, float>>()}, 
-        {"ACC", make_shared<map<string, float>>()}, 
-        {"BUFFER", make_shared<map<string, float>>()}, 
-        {"NI", make_shared<map<string, float>>()}, 
-    };
-
-    MIParser::parseLatencyFile(latency_file, latency);
-
-    _modules.push_back(make_shared<BUS>(*(latency["BUS"])));
-    _modules.push_back(make_shared<RISCV_CPU>(*(latency["CPU"])));
-    _modules.push_back(make_shared<ACCELERATOR>(*(latency["ACC"])));
-    _modules.push_back(make_shared<BUFFER>(*(latency["BUFFER"])));
-    _modules.push_back(make_shared<NI>(sq_, rq_, pipe_open_, *(latency["NI"]), cid_, rb_file, threshold_, width_));
-
-    TaskParser::compileTaskFile(instruction_file, _tasks, data);
+    // Setup hardare modules, in CompIndex order
+    _modules.push_back(make_shared<BUS>(latency.at("BUS")));
+    _modules.push_back(make_shared<RISCV_CPU>(latency.at("CPU")));
+    _modules.push_back(make_shared<ACCELERATOR>(latency.at("ACC")));
+    _modules.push_back(make_shared<BUFFER>(latency.at("BUFFER")));
+    _ni = make_shared<NI>(sq_, rq_, pipe_open_, latency.at("NI"), cid_, routing_board, threshold_, width_);
+    _modules.push_back(_ni);
+    for (int i = 0; i < NUM_COMPS; ++i) {
+        assert(_modules[i]->comp == i);
+    }
+
+    _program = tasks;
+    _tasks = _program->instrs;
+    data = _program->data;
     _cycle_to_issue.resize(_tasks.size(), -1);
+    _text_ids.assign(_program->texts.size(), -1);
+}
 
-    end = clock();
 
-    cout << "Initialize | " << "Initialization for core " << cid \
-         << " completes, which generates " << _tasks.size() << " paralleled tasks: ";
+void CORE::DisplayInitialization(ostream & os) const {
+    os << "Initialize | " << "Initialization for core " << cid \
+       << " completes, which generates " << _tasks.size() << " paralleled tasks: ";
     for (auto serial_task: _tasks) {
-        cout << serial_task.size() << "-";
+        os << serial_task.size() << "-";
     }
-    cout << "instructions, and takes " << (double)(end-start) / CLOCKS_PER_SEC << " seconds." << endl;
+    os << "instructions, and takes " << _program->seconds << " seconds." << endl;
 }
 
 
-shared_ptr<COMPONENT> CORE::getExecuteComponent(std::string micro_instr) {
-    micro_instr.erase(std::remove_if(micro_instr.begin(), micro_instr.end(), ::isspace), micro_instr.end());
-    std::string executer_name = split(micro_instr, ".")[0];
-    for (shared_ptr<COMPONENT> c: _modules) {
-        if (c->name == executer_name) {
-            return c;
-        }
+void CORE::SetLatency(const LatencyTable& latency) {
+    for (int i = 0; i < NUM_COMPS; ++i) {
+        _modules[i]->SetLatency(latency.at(MODULE_NAMES[i]));
     }
-    return nullptr;
+}
+
+
+COMPONENT* CORE::getExecuteComponent(const CompInstr& instr) const {
+    return _modules[instr.comp].get();
 }
 
 
 void CORE::ClockTick(int clock) {
+    PrepareTick(clock);
+    IssueTick(clock);
+}
+
+
+void CORE::PrepareTick(int clock) {
+
+    _staged_task = -1;
+    _staged_executer = nullptr;
 
     // Update statistics based on previous clock cycle
-    if (clock > _last_clock) {
-        if (_last_clock > 0) {
-            if (isBusy(_last_clock)) {
-                _busy_cycles++;
-            } else {
-                _idle_cycles++;
-            }
-        }
-        _last_clock = clock;
-    }
+    _updateStats(clock);
 
     // if no instructions lie on the instruction list or 
     if (finishAllTasks(clock)) {
@@ -94,21 +94,67 @@ void CORE::ClockTick(int clock) {
     assert(idx < _cycle_to_issue.size() && idx >= 0 && \
             (_cycle_to_issue[idx] <= clock || _cycle_to_issue[idx] == -1));
 
-    queue<string>& task_to_issue = _tasks[idx];
+    queue<CompInstr>& task_to_issue = _tasks[idx];
     int& issue_cycle = _cycle_to_issue[idx];
 
     // fire the next instruction
     if (issue_cycle != -1) {
-        string finished_instr = task_to_issue.front();
+        int finished_instr = task_to_issue.front().text;
         task_to_issue.pop();
-        cout << clock << " | CORE" << cid << " | Finish Micro-Inst: | " << finished_instr << endl;
+        _progress++;
+        if (_log->Enabled(EVENT_FINISH_INSTR)) {
+            _log->Emit(MakeRecord(EVENT_FINISH_INSTR, clock, cid, _internText(finished_instr)));
+        }
     } 
     if (task_to_issue.size()) {
-        string current_instr = task_to_issue.front();
-        shared_ptr<COMPONENT> executer = getExecuteComponent(current_instr);
-        assert(executer != nullptr);
-        issue_cycle = executer->simple_sim(current_instr, data, clock);
+        _staged_task = idx;
+        _staged_executer = getExecuteComponent(task_to_issue.front());
+        assert(_staged_executer != nullptr);
+    }
+}
+
+
+void CORE::IssueTick(int clock) {
+    if (_staged_task < 0) {
+        return;
+    }
+    int issue_cycle = _staged_executer->simple_sim(_tasks[_staged_task].front(), _program->operands, data, clock);
+    if (issue_cycle != _cycle_to_issue[_staged_task]) {
+        _progress++;        // a failed retry leaves it at -1
+    }
+    _cycle_to_issue[_staged_task] = issue_cycle;
+    _staged_task = -1;
+    _staged_executer = nullptr;
+}
+
+
+void CORE::StageCredit(CreditStage& stage) const {
+    stage.refreshed[cid] = _staged_executer == _ni.get();
+    stage.credit[cid] = _ni->PipeOpen();
+}
+
+
+void CORE::SetCreditStage(const CreditStage* stage) {
+    _ni->SetCreditStage(stage);
+}
+
+
+void CORE::SetLogSink(LogSink* log) {
+    _log = log;
+    _text_ids.assign(_program->texts.size(), -1);
+    for (shared_ptr<COMPONENT> c: _modules) {
+        c->SetLogSink(log);
+    }
+}
+
+
+// The id of a micro-instruction's text in the log, interned on its first use 
+int CORE::_internText(int text) {
+    int& id = _text_ids[text];
+    if (id < 0) {
+        id = _log->Intern(_program->texts[text]);
     }
+    return id;
 }
 
 
@@ -123,7 +169,7 @@ int CORE::selectActiveTask(int clock) {
     if (candidates.empty()) {
         return -1;
     }
-    std::random_shuffle(candidates.begin(), candidates.end());
+    std::shuffle(candidates.begin(), candidates.end(), _rng);
     // The forwarding operators have high priority, while redo operators have low priority
     for (int idx: candidates) {
         if (_cycle_to_issue[idx] != -1) {
@@ -144,6 +190,69 @@ bool CORE::isBusy(int clock) {
 }
 
 
+// The first cycle at which the core may issue or retire something: `clock` if it
+// is free now, the end of its running instruction if it is busy, and INT_MAX if
+// all of its tasks are done.
+int CORE::wakeupCycle(int clock) const {
+    if (finishAllTasks(clock)) {
+        return INT_MAX;
+    }
+    int busy_until = clock;
+    for (int c: _cycle_to_issue) {
+        busy_until = std::max(busy_until, c);
+    }
+    return busy_until;
+}
+
+
+// Account the cycles before `clock` as if the core had been ticked on each of 
+// them. Only valid while the core is busy, when those ticks would do nothing.
+void CORE::Skip(int clock) {
+    _updateStats(clock - 1);
+}
+
+
+// Credit every cycle in [_last_clock, clock) to busy or idle. The core state 
+// doesn't change between two ticks, so the core is busy on cycle x iff x is 
+// before the end of its latest instruction.
+void CORE::_updateStats(int clock) {
+    if (clock <= _last_clock) {
+        return;
+    }
+    int busy_until = -1;
+    for (int c: _cycle_to_issue) {
+        busy_until = std::max(busy_until, c);
+    }
+    int from = std::max(_last_clock, 1);    // cycle 0 is never credited
+    int busy = std::max(0, std::min(clock, busy_until) - from);
+    _busy_cycles += busy;
+    _idle_cycles += std::max(0, clock - from) - busy;
+    _last_clock = clock;
+}
+
+
+// Tasks only ever lose instructions from their front, so the number left in 
+// each tells where it is. Loading starts over from the compiled tasks.
+void CORE::Checkpoint(StateArchive& ar) {
+    ar.Check((int)_tasks.size(), "the number of tasks of a core");
+    for (size_t i = 0; i < _tasks.size(); ++i) {
+        int left = _tasks[i].size();
+        ar & left;
+        if (!ar.loading()) {
+            continue;
+        }
+        if (left > (int)_program->instrs[i].size()) {
+            throw std::string("The checkpoint doesn't match this simulation: core ") 
+                + std::to_string(cid) + " has more instructions left than its task file";
+        }
+        _tasks[i] = _program->instrs[i];
+        for (; (int)_tasks[i].size() > left; _tasks[i].pop()) { }
+    }
+    ar & _cycle_to_issue & data & _rng & _busy_cycles & _idle_cycles & _last_clock & _progress;
+    _ni->Checkpoint(ar);
+}
+
+
 int CORE::getBusyCycles() const {
     return _busy_cycles;
 }
@@ -152,14 +261,18 @@ int CORE::getIdleCycles() const {
     return _idle_cycles;
 }
 
+int CORE::getReceiveDepth() const {
+    return _ni->ReceiveDepth();
+}
+
 void CORE::DisplayStats(std::ostream & os) const {
     os << "CORE " << cid << " Stats: " << std::endl;
     if (finishAllTasks(0)) {
         os << "All instructions are finished, this core is closed" << std::endl;
     } else {
         os << "Some instructions have not been executed, the front instructions are: ";
-        for (auto t: _tasks) {
-            os << t.front() << "-";
+        for (const queue<CompInstr>& t: _tasks) {
+            os << (t.empty() ? "" : _program->texts[t.front().text]) << "-";
         }
         os << std::endl; 
     }
@@ -0,0 +1,118 @@
+#include <sstream>
+#include "micro_instr.h"
+
+namespace spatial {
+
+// Index letters of each input, and of the output
+bool Einsum::decode(const std::string& text, int inputs, Einsum& einsum) {
+    size_t arrow = text.find("->");
+    if (arrow == text.npos) {
+        return false;
+    }
+    std::vector<std::string> terms;
+    std::stringstream ss(text.substr(0, arrow));
+    std::string term;
+    while (std::getline(ss, term, ',')) {
+        terms.push_back(term);
+    }
+    if ((int)terms.size() < inputs) {
+        return false;
+    }
+    std::string output = text.substr(arrow + 2);
+
+    einsum.text = text;
+    einsum.inputs = inputs;
+    einsum.contracted.clear();
+    einsum.output.clear();
+    einsum.scalar = output.empty();
+
+    // An index shared by two neighbouring inputs and missing from the output 
+    // is summed over, and so is every index of a single input missing from it
+    if (inputs == 1) {
+        for (int i = 0; i < (int)terms[0].size(); ++i) {
+            if (output.find(terms[0][i]) == output.npos) {
+                einsum.contracted.push_back({0, i, -1});
+            }
+        }
+    }
+    for (int i = 0; i + 1 < inputs; ++i) {
+        const std::string& t1 = terms[i];
+        const std::string& t2 = terms[i + 1];
+        for (int j = 0; j < (int)t2.size(); ++j) {
+            size_t position = t1.find(t2[j]);
+            if (position != t1.npos && output.find(t2[j]) == output.npos) {
+                einsum.contracted.push_back({i, (int)position, j});
+            }
+        }
+    }
+    // Each output index takes its size from the first input that has it
+    for (char c: output) {
+        for (int j = 0; j < inputs; ++j) {
+            size_t position = terms[j].find(c);
+            if (position != terms[j].npos) {
+                einsum.output.push_back({j, (int)position, -1});
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+
+int OperandPool::einsum(const std::string& text, int inputs) {
+    for (int i = 0; i < (int)einsums.size(); ++i) {
+        if (einsums[i].text == text && einsums[i].inputs == inputs) {
+            return i;
+        }
+    }
+    Einsum e;
+    if (!Einsum::decode(text, inputs, e)) {
+        return -1;
+    }
+    einsums.push_back(e);
+    return einsums.size() - 1;
+}
+
+
+bool CompInstr::decode(const std::string& line, CompInstr& instr, OperandPool& pool) {
+    std::stringstream ss(line);
+    std::string name;
+    ss >> name;
+
+    int op = 0;
+    while (op < NUM_OPCODES && name != OPCODES[op].name) {
+        ++op;
+    }
+    if (op == NUM_OPCODES) {
+        return false;
+    }
+    instr.op = Opcode(op);
+    instr.comp = OPCODES[op].comp;
+    instr.first = pool.values.size();
+    instr.count = 0;
+    instr.einsum = -1;
+
+    std::string config;
+    if (instr.op == OP_ACC_CAL && !(ss >> config)) {
+        return false;
+    }
+    int v;
+    while (ss >> v) {
+        pool.values.push_back(v);
+        ++instr.count;
+    }
+    if (!ss.eof()) {
+        return false;       // a non-integer operand
+    }
+    if (instr.op == OP_ACC_CAL) {
+        if (config == "conv") {
+            return instr.count == 3;
+        }
+        instr.einsum = instr.count > 0 ? pool.einsum(config, instr.count - 1) : -1;
+        return instr.einsum >= 0;
+    }
+    // every opcode but CPU.poll names a tensor or a cycle count first
+    return instr.op == OP_CPU_POLL || instr.count > 0;
+}
+
+}
@@ -9,39 +9,33 @@
 
 namespace spatial {
 
-std::shared_ptr<std::map<int, MCTree> > routing_board = nullptr;
-
 NI::NI(
     CNInterface sq_, CNInterface rq_, std::shared_ptr<std::vector<bool> > pipe_open_, 
-    std::map<std::string, float> mi_, int cid_, const std::string& rb_file, 
+    std::map<std::string, float> mi_, int cid_, std::shared_ptr<const RoutingBoard> routing_board_, 
     int threshold_, int width_ = 128
-): _send_queue(sq_), _receive_queue(rq_), _pipe_open(pipe_open_), width(width_), cid(cid_),
-   threshold(threshold_), COMPONENT("NI", mi_) 
+): COMPONENT("NI", COMP_NI, mi_), width(width_), cid(cid_), threshold(threshold_), _send_queue(sq_), 
+   _receive_queue(rq_), _pipe_open(pipe_open_), _routing_board(routing_board_), _stage(nullptr), _sent(0), 
+   _received(0), _clock(-1)
 {
-    // NIs share a global routing board
-    if (routing_board == nullptr) {
-        routing_board = std::make_shared<std::map<int, MCTree>>();
-        PathParser::parsePathFile(rb_file, *routing_board);
-    }
 };
 
-int NI::simple_sim(const std::string micro_instr, std::map<int, Tensor>& data, int clock_) 
+int NI::simple_sim(const CompInstr& instr, const OperandPool& pool, TensorTable& data, int clock_) 
 {
-    std::stringstream ss(micro_instr);
-    std::string type;
-    ss >> type;
+    _clock = clock_;
 
-    (*_pipe_open)[cid] = _receive_queue->size() <= threshold;
+    // Under a parallel step the refreshed credit was staged before issuing
+    if (_stage == nullptr) {
+        (*_pipe_open)[cid] = PipeOpen();
+    }
 
     // e.g. Ni.send dest_nid data_ptr
-    if (type == "NI.send") {
-        int tid = -1;
-        ss >> tid;
+    if (instr.op == OP_NI_SEND) {
+        const int* paras = instr.paras(pool);
+        const Tensor& tensor = data[paras[0]];
         std::vector<int> dests;
-        int d;
-        while (ss >> d) {
-            if (cid != d) {
-                dests.push_back(d);
+        for (const int* d = paras + 1; d != paras + instr.count; ++d) {
+            if (cid != *d) {
+                dests.push_back(*d);
             } else {
                 std::cerr << "WARNING: " << "core " << cid << " sends a packet"
                           << " to itself. We ignore this packet, " \
@@ -51,10 +45,7 @@ int NI::simple_sim(const std::string micro_instr, std::map<int, Tensor>& data, i
         if (dests.size() == 0) {
             return clock_ + 1;
         }
-        assert(dests.size() && tid != -1);
-        assert(data.count(tid) != 0);
-
-        Tensor tensor = data[tid];
+        assert(dests.size() && tensor.tid != -1);
 
 #ifdef MULTICAST
         Packet p = GeneratePacket(tensor, dests, cid);
@@ -66,8 +57,7 @@ int NI::simple_sim(const std::string micro_instr, std::map<int, Tensor>& data, i
             Packet p = GeneratePacket(tensor, vector<int>({dest}), cid);
             unicast_packets.push_back(p);
         }
-        std::set<int> s(dests.begin(), dests.end());
-        if (_doorbell(s)) {
+        if (_doorbell(dests)) {
             for (Packet& p: unicast_packets) {
                 assert(_send_package(p));
             }
@@ -77,24 +67,24 @@ int NI::simple_sim(const std::string micro_instr, std::map<int, Tensor>& data, i
         }
 #endif
 
-    } else if (type == "NI.recv") {
-        int fid = -1;
-        ss >> fid;
-        assert(fid >= 0);
-        if (_receive_package(fid, data[fid])) {
+    } else if (instr.op == OP_NI_RECV) {
+        Tensor& tensor = data[instr.paras(pool)[0]];
+        assert(tensor.tid >= 0);
+        if (_receive_package(tensor.tid, tensor)) {
             return clock_ + 1;
         } else {
             return -1;
         }
     }
-    instruction_mismatch(micro_instr);
+    instruction_mismatch(OPCODES[instr.op].name);
+    return -1;
 }
 
-bool NI::_doorbell(const std::set<int>& dests) {
+bool NI::_doorbell(const std::vector<int>& dests) {
     bool dests_all_free = true;
     for (int d: dests) {
-        assert(d >= 0 && d < array_size);
-        dests_all_free &= (*_pipe_open)[d];
+        assert(d >= 0 && d < (int)_pipe_open->size());
+        dests_all_free &= _stage ? _stage->read(*_pipe_open, cid, d) : (*_pipe_open)[d];
     }
     // bool src_channel_available = _send_queue->size() < threshold;
     bool src_channel_available = true;      // TODO: this may cause deadlock
@@ -104,43 +94,95 @@ bool NI::_doorbell(const std::set<int>& dests) {
 
 bool NI::_send_package(const Packet& package) {
     assert(package.size > 0);
-    set<int> dests = package.path->getDestNodes();
-
-    if (_doorbell(dests)) {
-        std::cout << "CORE | NI enqueues package" << std::endl;
+    if (_doorbell(package.board->getDestNodes(package.tree))) {
+        _log->Log(EVENT_NI_ENQUEUE, _clock, cid);
         _send_queue->push(package);
+        _sent++;
         return true;
     } else {
-        std::cout << "CORE | Destinations of this package is unavailable, pend package sending" << std::endl;
+        _log->Log(EVENT_NI_PEND, _clock, cid);
         return false;
     }
 }
 
 
 bool NI::_receive_package(int fid, Tensor& buffer) {
-    // Find the package we need in the receive queue.
-    CNInterface inter_buf = std::make_shared<std::queue<Packet> >();
-    bool found = false;
-    while (!_receive_queue->empty()) {
-        Packet p = _receive_queue->front();
-        _receive_queue->pop();
-        if (p.fid == fid) {
-            buffer.copyFrom(p.data);
-            found = true;
-            break;
-        }
-        inter_buf->push(p);
+    _collect();
+    Packet p;
+    if (!_mailbox.take(fid, p)) {
+        return false;
+    }
+    buffer.copyFrom(p.data);
+    _received++;
+    return true;
+}
+
+
+// Move the packets the network delivered since the last call into the mailbox
+void NI::_collect() {
+    for (; !_receive_queue->empty(); _receive_queue->pop()) {
+        _mailbox.push(_receive_queue->front());
+    }
+}
+
+
+void Mailbox::push(const Packet& p) {
+    int slot = _free;
+    if (slot < 0) {
+        slot = _slots.size();
+        _slots.push_back(Slot());
+    } else {
+        _free = _slots[slot].next;
     }
+    _slots[slot].packet = p;
+    _slots[slot].next = -1;
 
-    while (!inter_buf->empty()) {
-        _receive_queue->push(inter_buf->front());
-        inter_buf->pop();
+    auto iter = _fids.insert(std::make_pair(p.fid, std::make_pair(-1, -1))).first;
+    std::pair<int, int>& ends = iter->second;
+    if (ends.first < 0) {
+        ends.first = slot;
+    } else {
+        _slots[ends.second].next = slot;
     }
+    ends.second = slot;
+    _size++;
+}
+
 
-    return found;
+bool Mailbox::take(int fid, Packet& p) {
+    auto iter = _fids.find(fid);
+    if (iter == _fids.end() || iter->second.first < 0) {
+        return false;
+    }
+    std::pair<int, int>& ends = iter->second;
+    int slot = ends.first;
+    p = _slots[slot].packet;
+    _slots[slot].packet = Packet();     // drop the routing tree now
+    ends.first = _slots[slot].next;
+    if (ends.first < 0) {
+        ends.second = -1;
+    }
+    _slots[slot].next = _free;
+    _free = slot;
+    _size--;
+    return true;
 }
 
 
+// Unicast trees never change, so the packets between the same pair of nodes
+// share one, as tree 0 of a board of its own
+std::shared_ptr<const RoutingBoard> NI::_unicastPath(int src, int dest) {
+    std::shared_ptr<const RoutingBoard>& path = _unicast_paths[Segment(src, dest)];
+    if (path == nullptr) {
+        MCTree tree(src);
+        tree.addSegment(src, dest, nullptr, true);
+        std::shared_ptr<RoutingBoard> board = std::make_shared<RoutingBoard>();
+        board->add(-1, tree);
+        path = board;
+    }
+    return path;
+}
+
 Packet NI::GeneratePacket(const Tensor& tensor, const std::vector<int>& dests, int src) {
 
     Packet p;
@@ -153,27 +195,27 @@ Packet NI::GeneratePacket(const Tensor& tensor, const std::vector<int>& dests, i
         p.type = Packet::TransferType::_MULTICAST;
     }
 
-    assert(src >= 0 && src < array_size);
-    auto iter = routing_board->find(p.fid);
-    if (iter != routing_board->end()) {
+    assert(src >= 0 && src < (int)_pipe_open->size());
+    int tree = _routing_board->find(p.fid);
+    if (tree >= 0) {
 #ifdef MULTICAST
-        p.path = std::make_shared<MCTree>(iter->second);
-        assert(p.path->getDestNodes() == std::set<int>(dests.begin(), dests.end()));
+        p.board = _routing_board;
+        p.tree = tree;
+        std::vector<int> tree_dests = p.board->getDestNodes(tree);
+        assert(std::set<int>(dests.begin(), dests.end()) == std::set<int>(tree_dests.begin(), tree_dests.end()));
 #else
-        std::cout << "WARNING | " << "We ignore the broadcast tree because only unicast packets are permitted. " << std::endl;
+        _log->Log(EVENT_NI_IGNORE_TREE, _clock, cid, tensor.tid);
         assert(dests.size() == 1);
-        p.path = std::make_shared<MCTree>(cid);
-        p.path->addSegment(cid, dests.front(), nullptr, true);
+        p.board = _unicastPath(cid, dests.front());
+        p.tree = 0;
 #endif 
     } else {
         if (dests.size() > 1) {
             std::cerr << "ERROR | " << "Please specify the multicast tree for tensor " << tensor.tid << std::endl;
             assert(false);
         }
-        p.path = std::make_shared<MCTree>(src);
-        for (int dest: dests) {
-            p.path->addSegment(src, dest, nullptr, true);
-        }
+        p.board = _unicastPath(src, dests.front());
+        p.tree = 0;
     }
 
     p.data = tensor;
@@ -183,7 +225,7 @@ Packet NI::GeneratePacket(const Tensor& tensor, const std::vector<int>& dests, i
     // But to keep simulation, we just print a warning and pad the tensor with one flit.
     if (p.data.size() == 0) {
         p.size = 1;
-        p.data.dims.push_back(1);
+        p.data.addDim(1);
         std::cerr << "WARNING: The network interface want to send the empty tensor " 
                   << p.fid << ". ";
         std::cerr << "We pad it with one flit to keep on simulating." << std::endl;
@@ -199,7 +241,8 @@ std::pair<CNInterface, CNInterface> NI::GetQueuePairs() {
 
 void NI::DisplayStats(std::ostream& os) {
     os << "Network Interface: ";
-    os << "send queue size: " << _send_queue->size() << " receive queue size: " << _receive_queue->size();
+    os << "send queue size: " << _send_queue->size() << " receive queue size: " << _receive_queue->size() + _mailbox.size();
+    os << " packets sent: " << _sent << " packets received: " << _received;
     os << std::endl;
 }
 
@@ -2,6 +2,7 @@
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <iterator>
 #include <string>
 #include <algorithm>
 #include <map>
@@ -10,19 +11,41 @@
 #include "common.h"
 #include "bridge.hpp"
 #include "parser.h"
+#include "workload_cache.h"
 
 
 void spatial::TaskParser::compileTaskFile(const std::string& file, \
-    std::vector<std::queue<std::string>>& mi_to, std::map<int, Tensor>& data_to) 
+    std::vector<std::queue<CompInstr>>& mi_to, OperandPool& operands_to, std::vector<std::string>& text_to, \
+    TensorTable& data_to, const std::string& cache_dir) 
 {
-    using namespace std;
-    TaskParser parser;
-
-    parser.file_name = file;
     std::ifstream task_file(file, std::ios::in);
     if (!task_file.is_open()) {
         throw "Task speficication file " + file + " not founded !";
     }
+    if (cache_dir.empty()) {
+        _compile(file, task_file, mi_to, operands_to, text_to, data_to);
+        return;
+    }
+
+    std::string content((std::istreambuf_iterator<char>(task_file)), std::istreambuf_iterator<char>());
+    uint64_t hash = WorkloadCache::hash(content);
+    std::string cache_file = WorkloadCache::path(cache_dir, hash);
+    if (WorkloadCache::load(cache_file, hash, mi_to, operands_to, text_to, data_to)) {
+        return;
+    }
+    std::istringstream stream(content);
+    _compile(file, stream, mi_to, operands_to, text_to, data_to);
+    WorkloadCache::store(cache_file, hash, mi_to, operands_to, text_to, data_to);
+}
+
+
+void spatial::TaskParser::_compile(const std::string& file, std::istream& task_file, \
+    std::vector<std::queue<CompInstr>>& mi_to, OperandPool& operands_to, std::vector<std::string>& text_to, \
+    TensorTable& data_to) 
+{
+    using namespace std;
+    TaskParser parser;
+    parser.file_name = file;
 
     // parse the file to operators
     std::string line;
@@ -65,7 +88,7 @@ void spatial::TaskParser::compileTaskFile(const std::string& file, \
     // std::cout << "Pour out tensor finish" << std::endl;
     parser._linkOpWithTensor();
     // std::cout << "setup ops finish" << std::endl;
-    parser._generate(mi_to, data_to);
+    parser._generate(mi_to, operands_to, text_to, data_to);
     // std::cout << "gen micro instr finish" << std::endl;
 }
 
@@ -112,10 +135,15 @@ void spatial::TaskParser::_parseTensor(const std::string& line) {
     std::string dims = fields[2];
     std::replace(dims.begin(), dims.end(), ',', ' ');
     std::stringstream ss(dims);
+    std::vector<int> shape;
     int dim = -1;
     while (ss >> dim) {
-        tensor.dims.push_back(dim);
+        shape.push_back(dim);
+    }
+    if (shape.size() > Tensor::MAX_DIMS) {
+        throw "Tensor " + std::to_string(tid) + " has more than " + std::to_string(Tensor::MAX_DIMS) + " dims in file " + file_name;
     }
+    tensor.setDims(shape);
 
     tensors_.insert(std::make_pair(tensor.tid, tensor));
 }
@@ -178,26 +206,70 @@ void spatial::TaskParser::_linkOpWithTensor()
 }
 
 
-void spatial::TaskParser::_generate(std::vector<std::queue<std::string>>& instrs, std::map<int, spatial::Tensor>& data) {
+void spatial::TaskParser::_generate(std::vector<std::queue<CompInstr>>& instrs, OperandPool& operands,
+    std::vector<std::string>& texts, TensorTable& data) {
 
-    data.insert(tensors_.begin(), tensors_.end());
+    std::map<int, spatial::Tensor> tensors = tensors_;
+
+    // Give each tensor a dense index, the ones only named by instructions are 
+    // registered when they are first seen
+    std::map<int, int> index;
+    for (auto& t: tensors_) {
+        index[t.first] = data.size();
+        data.push_back(t.second);
+    }
+    auto register_tensor = [&] (int tid) {
+        auto iter = index.insert(std::make_pair(tid, (int)data.size())).first;
+        if (iter->second == (int)data.size()) {
+            Tensor t = Tensor();
+            t.tid = tid;
+            data.push_back(t);
+        }
+        return iter->second;
+    };
 
     // Generate micro instructions
-    instrs.resize(tasks_.size(), std::queue<std::string>());
+    instrs.resize(tasks_.size(), std::queue<CompInstr>());
+    std::map<std::string, int> text_ids;
     auto serial_task = tasks_.begin();
     auto micro_instr = instrs.begin();
     for (; serial_task != tasks_.end() && micro_instr != instrs.end(); ++serial_task, ++micro_instr) {
+        std::queue<std::string> lines;
         for (std::shared_ptr<Operator> op: *serial_task) {
-            op->lower(data, *micro_instr);
+            op->lower(tensors, lines);
+        }
+        // Decode them once here, so that issuing them never parses text
+        for (; !lines.empty(); lines.pop()) {
+            const std::string& line = lines.front();
+            CompInstr instr;
+            if (!CompInstr::decode(line, instr, operands)) {
+                throw "Unknown micro instruction \"" + line + "\" in file " + file_name;
+            }
+            int tensor_operands = OPCODES[instr.op].tensors;
+            int* paras = operands.values.data() + instr.first;
+            for (int i = 0; i < instr.count && (tensor_operands < 0 || i < tensor_operands); ++i) {
+                paras[i] = register_tensor(paras[i]);
+            }
+            auto iter = text_ids.insert(std::make_pair(line, (int)texts.size())).first;
+            if (iter->second == (int)texts.size()) {
+                texts.push_back(line);
+            }
+            instr.text = iter->second;
+            micro_instr->push(instr);
         }
     }
 
 }
 
 
-void spatial::MIParser::parseLatencyFile(const std::string& file,  \
-    std::map<std::string, std::shared_ptr<std::map<std::string, float>>>& latency)
+std::shared_ptr<const spatial::LatencyTable> spatial::MIParser::parseLatencyFile(const std::string& file)
 {
+    std::shared_ptr<LatencyTable> table = std::make_shared<LatencyTable>();
+    LatencyTable& latency = *table;
+    for (const char* module: {"BUS", "CPU", "ACC", "BUFFER", "NI"}) {
+        latency[module];
+    }
+
     std::ifstream mi_latency;
     mi_latency.open(file, std::ios::in);
     if (!mi_latency.is_open()) {
@@ -211,11 +283,15 @@ void spatial::MIParser::parseLatencyFile(const std::string& file,  \
         float cycles = stof(line.substr(pos + 1));
         std::string comp = subinstr.substr(0, subinstr.find("."));
         assert(latency.count(comp) == 1);
-        latency[comp]->insert(make_pair(subinstr, cycles));
+        latency[comp].insert(make_pair(subinstr, cycles));
     }
+    return table;
 }
 
-void spatial::PathParser::parsePathFile(const std::string& file, std::map<int, MCTree>& path) {
+std::shared_ptr<const RoutingBoard> spatial::PathParser::parsePathFile(const std::string& file) {
+    if (RoutingBoard::isBoardFile(file)) {
+        return RoutingBoard::load(file);
+    }
 
     std::ifstream stream;
     stream.open(file, std::ios::in);
@@ -223,9 +299,10 @@ void spatial::PathParser::parsePathFile(const std::string& file, std::map<int, M
         std::cerr << "WARNING: The routing board file " << file \
                   << " does not exist, the routing board is set empty. " \
                   << std::endl;
-        return;
+        return std::make_shared<RoutingBoard>();
     }
 
+    std::map<int, MCTree> path;
     std::string line = "";
     PathParser parser;
     MCTree pres_tree = MCTree(INVALID);
@@ -254,6 +331,12 @@ void spatial::PathParser::parsePathFile(const std::string& file, std::map<int, M
     if (pres_tid != INVALID) {
         path.insert(make_pair(pres_tid, pres_tree));
     }
+
+    std::shared_ptr<RoutingBoard> board = std::make_shared<RoutingBoard>();
+    for (auto& tree: path) {
+        board->add(tree.first, tree.second);
+    }
+    return board;
 }
 
 void spatial::PathParser::_parseAttribute(const std::string& line, int& tid, MCTree& tree) {
@@ -274,7 +357,7 @@ void spatial::PathParser::_parseSegment(const std::string& line, MCTree& tree) {
      assert(tree.root() >= 0);
     stringstream ss(line);
     int seg_start, seg_end;
-    std::shared_ptr<std::queue<int>> im_nodes;
+    std::shared_ptr<std::queue<int>> im_nodes = std::make_shared<std::queue<int>>();
     ss >> seg_start >> seg_end;
     int in;
     while (ss >> in) {
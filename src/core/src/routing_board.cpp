@@ -0,0 +1,196 @@
+#include <assert.h>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "path.hpp"
+
+// Layout, all in host byte order: the header, then the leaves, trees, segments
+// and hops as they are in memory, so that a mapped file is used in place
+static const char BOARD_MAGIC[8] = {'S', 'P', 'B', 'O', 'A', 'R', 'D', '\0'};
+static const uint32_t BOARD_VERSION = 1;
+
+struct BoardHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t trees, segs, hops, leaves;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(BoardHeader) % sizeof(uint64_t) == 0, "The leaves follow the header aligned");
+
+
+RoutingBoard::RoutingBoard(): _map(NULL), _map_size(0) {
+    _view();
+}
+
+
+RoutingBoard::~RoutingBoard() {
+    if (_map != NULL) {
+        munmap(_map, _map_size);
+    }
+}
+
+
+void RoutingBoard::_view() {
+    _trees = _tree_store.data();
+    _segs = _seg_store.data();
+    _hops = _hop_store.data();
+    _leaves = _leaf_store.data();
+    _num_trees = _tree_store.size();
+    _num_segs = _seg_store.size();
+    _num_hops = _hop_store.size();
+    _num_leaves = _leaf_store.size();
+}
+
+
+int RoutingBoard::add(int tid, MCTree& tree) {
+    assert(_map == NULL);
+    assert(_tree_store.empty() || _tree_store.back().tid < tid);
+    Tree t;
+    t.tid = tid;
+    t.seg_begin = _seg_store.size();
+
+    vector<Segment> order(1, Segment(TREESTART, tree.root()));
+    for (int i = 0; i < (int)order.size(); ++i) {
+        Seg s;
+        s.start = order[i].first;
+        s.end = order[i].second;
+        s.hop_begin = _hop_store.size();
+        queue<int> im_nodes = *tree.intermediateNodes(order[i]);
+        for (; !im_nodes.empty(); im_nodes.pop()) {
+            _hop_store.push_back(im_nodes.front());
+        }
+        s.hop_end = _hop_store.size();
+        s.child_begin = t.seg_begin + order.size();
+        for (const Segment& child: tree.segmentStartedWith(s.end)) {
+            order.push_back(child);
+        }
+        s.child_end = t.seg_begin + order.size();
+        s.eject = tree.isDestNode(s.end);
+        _seg_store.push_back(s);
+    }
+    t.seg_end = _seg_store.size();
+
+    t.leaf_begin = _leaf_store.size();
+    set<int> leafs = tree.getDestNodes();
+    if (!leafs.empty()) {
+        assert(*leafs.begin() >= 0);
+        _leaf_store.resize(t.leaf_begin + *leafs.rbegin() / 64 + 1, 0);
+        for (int d: leafs) {
+            _leaf_store[t.leaf_begin + d / 64] |= 1ULL << (d % 64);
+        }
+    }
+    t.leaf_end = _leaf_store.size();
+
+    _tree_store.push_back(t);
+    _view();
+    return _num_trees - 1;
+}
+
+
+void RoutingBoard::save(const std::string& file) const {
+    BoardHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BOARD_MAGIC, sizeof(BOARD_MAGIC));
+    header.version = BOARD_VERSION;
+    header.trees = _num_trees;
+    header.segs = _num_segs;
+    header.hops = _num_hops;
+    header.leaves = _num_leaves;
+
+    std::ofstream out(file, std::ios::out | std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(_leaves), _num_leaves * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(_trees), _num_trees * sizeof(Tree));
+    out.write(reinterpret_cast<const char*>(_segs), _num_segs * sizeof(Seg));
+    out.write(reinterpret_cast<const char*>(_hops), _num_hops * sizeof(int32_t));
+    out.close();
+    if (!out) {
+        throw std::string("Failed to write the routing board ") + file;
+    }
+}
+
+
+bool RoutingBoard::isBoardFile(const std::string& file) {
+    char magic[sizeof(BOARD_MAGIC)];
+    std::ifstream in(file, std::ios::in | std::ios::binary);
+    return in.read(magic, sizeof(magic)) && memcmp(magic, BOARD_MAGIC, sizeof(magic)) == 0;
+}
+
+
+// Every index of the board stays inside its arrays, and the segments succeeding
+// one come after it within the same tree, so walking a tree always ends
+static bool valid(const RoutingBoard& board, int segs, int hops, int leaves) {
+    for (int t = 0; t < board.size(); ++t) {
+        const RoutingBoard::Tree& tree = board.tree(t);
+        if ((t > 0 && board.tree(t - 1).tid >= tree.tid) ||
+            tree.seg_begin < 0 || tree.seg_begin >= tree.seg_end || tree.seg_end > segs ||
+            tree.leaf_begin < 0 || tree.leaf_begin > tree.leaf_end || tree.leaf_end > leaves) {
+            return false;
+        }
+        for (int i = tree.seg_begin; i < tree.seg_end; ++i) {
+            const RoutingBoard::Seg& s = board.seg(i);
+            if (s.start == s.end || s.hop_begin < 0 || s.hop_begin > s.hop_end || s.hop_end > hops ||
+                s.child_begin <= i || s.child_begin > s.child_end || s.child_end > tree.seg_end) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+shared_ptr<const RoutingBoard> RoutingBoard::load(const std::string& file) {
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::string("Can not open the routing board ") + file;
+    }
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(BoardHeader)) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        throw std::string("Can not map the routing board ") + file;
+    }
+
+    shared_ptr<RoutingBoard> board = make_shared<RoutingBoard>();
+    board->_map = map;
+    board->_map_size = st.st_size;
+
+    const BoardHeader* header = static_cast<const BoardHeader*>(map);
+    if (memcmp(header->magic, BOARD_MAGIC, sizeof(BOARD_MAGIC)) != 0) {
+        throw std::string("Not a routing board: ") + file;
+    }
+    if (header->version != BOARD_VERSION) {
+        throw std::string("Unsupported routing board version: ") + file;
+    }
+    if (header->trees < 0 || header->segs < 0 || header->hops < 0 || header->leaves < 0 ||
+        (size_t)st.st_size != sizeof(BoardHeader) + header->leaves * sizeof(uint64_t) + header->trees * sizeof(Tree) +
+                              header->segs * sizeof(Seg) + header->hops * sizeof(int32_t)) {
+        throw std::string("The routing board is damaged: ") + file;
+    }
+
+    const char* p = static_cast<const char*>(map) + sizeof(BoardHeader);
+    board->_leaves = reinterpret_cast<const uint64_t*>(p);
+    p += header->leaves * sizeof(uint64_t);
+    board->_trees = reinterpret_cast<const Tree*>(p);
+    p += header->trees * sizeof(Tree);
+    board->_segs = reinterpret_cast<const Seg*>(p);
+    p += header->segs * sizeof(Seg);
+    board->_hops = reinterpret_cast<const int32_t*>(p);
+    board->_num_trees = header->trees;
+    board->_num_segs = header->segs;
+    board->_num_hops = header->hops;
+    board->_num_leaves = header->leaves;
+
+    if (!valid(*board, header->segs, header->hops, header->leaves)) {
+        throw std::string("The routing board is damaged: ") + file;
+    }
+    return board;
+}
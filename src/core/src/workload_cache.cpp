@@ -0,0 +1,257 @@
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "workload_cache.h"
+
+namespace spatial {
+
+// Layout, all in host byte order:
+//   magic, version, content hash
+//   texts:   count, then length and bytes of each
+//   tensors: count, then each Tensor as is
+//   tasks:   count, then for each its instruction count and instructions:
+//            op, comp, text, operand count, operands, config length and bytes
+static const char CACHE_MAGIC[8] = {'S', 'P', 'W', 'L', 'O', 'A', 'D', '\0'};
+static const uint32_t CACHE_VERSION = 1;
+
+static_assert(std::is_trivially_copyable<Tensor>::value, "Tensors are cached bytewise");
+
+namespace {
+
+class Writer {
+public:
+    std::string image;
+
+    template <class T>
+    void put(const T& v) {
+        image.append(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+    void put(const std::string& s) {
+        put((uint32_t)s.size());
+        image.append(s);
+    }
+};
+
+// Reads from the mapped file; every read fails once it would go past the end
+class Reader {
+public:
+    Reader(const char* begin, size_t size): _p(begin), _end(begin + size) { }
+
+    template <class T>
+    bool get(T& v) {
+        if ((size_t)(_end - _p) < sizeof(T)) {
+            return false;
+        }
+        memcpy(&v, _p, sizeof(T));
+        _p += sizeof(T);
+        return true;
+    }
+    bool get(std::string& s) {
+        uint32_t n;
+        if (!get(n) || (size_t)(_end - _p) < n) {
+            return false;
+        }
+        s.assign(_p, n);
+        _p += n;
+        return true;
+    }
+    bool done() const { return _p == _end; }
+
+private:
+    const char* _p;
+    const char* _end;
+};
+
+bool decode(Reader& in, uint64_t hash, std::vector<std::queue<CompInstr>>& instrs,
+            OperandPool& operands, std::vector<std::string>& texts, TensorTable& data) {
+    char magic[sizeof(CACHE_MAGIC)];
+    uint32_t version;
+    uint64_t saved_hash;
+    if (!in.get(magic) || memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 ||
+        !in.get(version) || version != CACHE_VERSION || !in.get(saved_hash) || saved_hash != hash) {
+        return false;
+    }
+
+    uint32_t count;
+    if (!in.get(count)) {
+        return false;
+    }
+    texts.resize(count);
+    for (std::string& text: texts) {
+        if (!in.get(text)) {
+            return false;
+        }
+    }
+
+    if (!in.get(count)) {
+        return false;
+    }
+    data.resize(count);
+    for (Tensor& tensor: data) {
+        if (!in.get(tensor)) {
+            return false;
+        }
+    }
+
+    if (!in.get(count)) {
+        return false;
+    }
+    instrs.resize(count);
+    for (std::queue<CompInstr>& task: instrs) {
+        uint32_t length;
+        if (!in.get(length)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < length; ++i) {
+            CompInstr instr;
+            int32_t op, comp, text;
+            uint32_t operand_count;
+            if (!in.get(op) || !in.get(comp) || !in.get(text) || !in.get(operand_count)) {
+                return false;
+            }
+            if (op < 0 || op >= NUM_OPCODES || comp != OPCODES[op].comp || text < 0 || text >= (int)texts.size()) {
+                return false;
+            }
+            instr.op = (Opcode)op;
+            instr.comp = (CompIndex)comp;
+            instr.text = text;
+            instr.first = operands.values.size();
+            instr.count = operand_count;
+            instr.einsum = -1;
+            int tensors = OPCODES[op].tensors;
+            for (int j = 0; j < (int)operand_count; ++j) {
+                int32_t p;
+                if (!in.get(p) || ((tensors < 0 || j < tensors) && (p < 0 || p >= (int)data.size()))) {
+                    return false;
+                }
+                operands.values.push_back(p);
+            }
+            std::string config;
+            if (!in.get(config)) {
+                return false;
+            }
+            if (instr.op == OP_ACC_CAL && config != "conv") {
+                instr.einsum = operand_count > 0 ? operands.einsum(config, operand_count - 1) : -1;
+                if (instr.einsum < 0) {
+                    return false;
+                }
+            } else if (config != (instr.op == OP_ACC_CAL ? "conv" : "")) {
+                return false;
+            }
+            task.push(instr);
+        }
+    }
+    return in.done();
+}
+
+}
+
+
+// FNV-1a
+uint64_t WorkloadCache::hash(const std::string& content) {
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c: content) {
+        h = (h ^ c) * 1099511628211ULL;
+    }
+    return h;
+}
+
+
+std::string WorkloadCache::path(const std::string& directory, uint64_t hash) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.spw", (unsigned long long)hash);
+    return directory + "/" + name;
+}
+
+
+bool WorkloadCache::load(const std::string& path, uint64_t hash, std::vector<std::queue<CompInstr>>& instrs,
+                         OperandPool& operands, std::vector<std::string>& texts, TensorTable& data) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    std::vector<std::queue<CompInstr>> cached_instrs;
+    OperandPool cached_operands;
+    std::vector<std::string> cached_texts;
+    TensorTable cached_data;
+    Reader in(static_cast<const char*>(map), st.st_size);
+    bool valid = decode(in, hash, cached_instrs, cached_operands, cached_texts, cached_data);
+    munmap(map, st.st_size);
+    if (!valid) {
+        return false;
+    }
+    instrs.swap(cached_instrs);
+    std::swap(operands, cached_operands);
+    texts.swap(cached_texts);
+    data.swap(cached_data);
+    return true;
+}
+
+
+void WorkloadCache::store(const std::string& path, uint64_t hash, const std::vector<std::queue<CompInstr>>& instrs,
+                          const OperandPool& operands, const std::vector<std::string>& texts, const TensorTable& data) {
+    Writer out;
+    out.image.append(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    out.put(CACHE_VERSION);
+    out.put(hash);
+
+    out.put((uint32_t)texts.size());
+    for (const std::string& text: texts) {
+        out.put(text);
+    }
+    out.put((uint32_t)data.size());
+    for (const Tensor& tensor: data) {
+        out.put(tensor);
+    }
+    out.put((uint32_t)instrs.size());
+    for (std::queue<CompInstr> task: instrs) {
+        out.put((uint32_t)task.size());
+        for (; !task.empty(); task.pop()) {
+            const CompInstr& instr = task.front();
+            out.put((int32_t)instr.op);
+            out.put((int32_t)instr.comp);
+            out.put((int32_t)instr.text);
+            out.put((uint32_t)instr.count);
+            for (int j = 0; j < instr.count; ++j) {
+                out.put((int32_t)instr.paras(operands)[j]);
+            }
+            if (instr.op == OP_ACC_CAL) {
+                out.put(instr.einsum < 0 ? std::string("conv") : operands.einsums[instr.einsum].text);
+            } else {
+                out.put(std::string());
+            }
+        }
+    }
+
+    std::string directory = path.substr(0, path.rfind('/'));
+    mkdir(directory.c_str(), 0755);
+    static std::atomic<int> writes(0);
+    std::string temp = path + ".tmp" + std::to_string(getpid()) + "." + std::to_string(writes++);
+    std::ofstream file(temp, std::ios::out | std::ios::binary);
+    file.write(out.image.data(), out.image.size());
+    file.close();
+    if (!file || rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+        std::cerr << "WARNING: Failed to write the workload cache " << path << std::endl;
+    }
+}
+
+}
@@ -2,66 +2,194 @@
 #include "bridge.hpp"
 #include "math.h"
 #include "core.h"
+#include "parser.h"
 #include "spatial_config.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <thread>
 
 namespace spatial {
 
-int array_size;
+typedef std::chrono::steady_clock Clock;
+
+static double secondsBetween(Clock::time_point begin, Clock::time_point end) {
+    return std::chrono::duration<double>(end - begin).count();
+}
 
 CoreArray::CoreArray(Configuration config, PCNInterfaceSet send_queues_, PCNInterfaceSet receive_queues_, \
-    std::shared_ptr<std::vector<bool>> open_pipes): _config(config), _pipe_open(open_pipes)
+    std::shared_ptr<std::vector<bool>> open_pipes, LogSink* log, std::ostream& os): _config(config), _pipe_open(open_pipes), _progress_epoch(0)
 {
     // int size = config.GetInt("array_size");
     int k = config.GetInt("k");
     int n = config.GetInt("n");
-    array_size = (int)std::pow(k, n);
+    int array_size = (int)std::pow(k, n);
 
     std::vector<std::string> inst_file_names = config.GetStrArray("tasks");
     std::string working_dir = config.GetStr("working_directory");
     std::string latency_file = config.GetStr("micro_instr_latency");
+    std::string workload_cache = config.GetStr("workload_cache");
+
+    if (inst_file_names.size() < array_size) {
+        throw "The instruction file of node " + std::to_string(inst_file_names.size()) + " is not specified !!";
+    }
+
+    // The cores share the latency table and the routing board
+    Clock::time_point start = Clock::now();
+    _latency = MIParser::parseLatencyFile(latency_file);
+    Clock::time_point latency_parsed = Clock::now();
+    _routing_board = PathParser::parsePathFile(config.GetStr("routing_board"));
+    Clock::time_point board_parsed = Clock::now();
+
+    // Task files are compiled independently, each thread taking the next one
+    std::vector<std::shared_ptr<CompiledTasks>> programs(array_size);
+    int load_threads = config.GetInt("load_threads");
+    if (load_threads <= 0) {
+        load_threads = std::thread::hardware_concurrency();
+    }
+    load_threads = std::max(1, std::min(load_threads, array_size));
+    {
+        WorkerPool loaders(load_threads);
+        std::atomic<int> next(0);
+        loaders.run([&](int /* partition */) {
+            for (int i = next++; i < array_size; i = next++) {
+                Clock::time_point begin = Clock::now();
+                programs[i] = std::make_shared<CompiledTasks>();
+                TaskParser::compileTaskFile(working_dir + "/" + inst_file_names[i], programs[i]->instrs, 
+                                            programs[i]->operands, programs[i]->texts, programs[i]->data, 
+                                            workload_cache);
+                programs[i]->seconds = secondsBetween(begin, Clock::now());
+            }
+        });
+    }
+    Clock::time_point tasks_compiled = Clock::now();
+
+    _buildCores(std::vector<std::shared_ptr<const CompiledTasks>>(programs.begin(), programs.end()), 
+                send_queues_, receive_queues_, log, os);
+    Clock::time_point cores_built = Clock::now();
+
+    os << "Initialize | Loading the core array takes " << secondsBetween(start, cores_built) << " seconds: "
+       << "latency file " << secondsBetween(start, latency_parsed) << ", "
+       << "routing board " << secondsBetween(latency_parsed, board_parsed) << ", "
+       << "task files " << secondsBetween(board_parsed, tasks_compiled) << " on " << load_threads << " threads, "
+       << "cores " << secondsBetween(tasks_compiled, cores_built) << "." << std::endl;
+}
+
 
-    int width = config.GetInt("channel_width");
+// The cores of a fork start as the parent's were built, from the same compiled
+// tasks, latencies and routing board, so no file is read again
+CoreArray::CoreArray(const CoreArray& parent, Configuration config, PCNInterfaceSet send_queues_, 
+    PCNInterfaceSet receive_queues_, std::shared_ptr<std::vector<bool>> open_pipes, LogSink* log, std::ostream& os)
+    : _pipe_open(open_pipes), _config(config), _progress_epoch(0), _latency(parent._latency), 
+      _routing_board(parent._routing_board)
+{
+    std::vector<std::shared_ptr<const CompiledTasks>> programs;
+    for (const CORE& c: parent._cores) {
+        programs.push_back(c.program());
+    }
+    _buildCores(programs, send_queues_, receive_queues_, log, os);
+}
+
+
+void CoreArray::_buildCores(const std::vector<std::shared_ptr<const CompiledTasks>>& programs, 
+    PCNInterfaceSet send_queues_, PCNInterfaceSet receive_queues_, LogSink* log, std::ostream& os) 
+{
+    int array_size = programs.size();
+    int width = _config.GetInt("channel_width");
     int threshold = _config.GetInt("threshold");
 
+    _cores.reserve(array_size);
     for (int i = 0; i < array_size; ++i) {
-        int core = i;
-        if (core >= inst_file_names.size()) {
-            throw "The instruction file of node " + std::to_string(i) + " is not specified !!";
+        _cores.push_back(CORE(programs[i], *_latency, _routing_board, i, (*send_queues_)[i], (*receive_queues_)[i], _pipe_open, threshold, width));
+        _cores.back().DisplayInitialization(os);
+        _cores.back().SetLogSink(log);
+    }
+
+    int threads = std::min(_config.GetInt("core_threads"), array_size);
+    if (threads > 1) {
+        _pool = std::make_shared<WorkerPool>(threads);
+        _credit_stage.resize(array_size);
+        for (int i = 0; i < array_size; ++i) {
+            _logs.push_back(std::make_shared<LogBuffer>(log));
+            _cores[i].SetLogSink(_logs[i].get());
+            _cores[i].SetCreditStage(&_credit_stage);
         }
-        std::string inst_file = working_dir + "/" + inst_file_names[core];
-        std::string routing_board_file = config.GetStr("routing_board");
-        // routing_board_file = working_dir + "/" + routing_board_file;
-        _cores.push_back(CORE(inst_file, latency_file, routing_board_file, core, (*send_queues_)[i], (*receive_queues_)[i], open_pipes, threshold, width));
+    }
+}
+
+
+void CoreArray::Checkpoint(StateArchive& ar) {
+    ar.Check((int)_cores.size(), "the number of cores");
+    ar & _progress_epoch;
+    for (CORE& core : _cores) {
+        core.Checkpoint(ar);
     }
 }
 
 
 void CoreArray::step(int clock) {
+    if (_pool) {
+        _parallelStep(clock);
+        return;
+    }
     for (CORE& core : _cores) {
         core.ClockTick(clock);
     }
 }
 
-bool CoreArray::stateChanged() {
-    
-    static std::vector<CORE> cores_backup = std::vector<CORE>();
-    bool change = false;
-    if (cores_backup.size() != _cores.size()) {
-        change = true;
-    } else {
-        int size = _cores.size();
-        for (int i = 0; i < size; ++i) {
-            if (!_cores[i].equalTo(cores_backup[i])) {
-                change = true;
-                break;
-            }
+
+// Cores only share the credit board within a step: the send and receive queues
+// of a core are not touched by others until the NoC steps. So we first select 
+// the instruction of every core and stage the credits they would refresh, then
+// issue them against the staged board and commit it in core order. Events are
+// buffered per core and flushed in core order as well, so that both cycle counts
+// and logs match the serial step.
+void CoreArray::_parallelStep(int clock) {
+    _pool->run([this, clock](int partition) {
+        int begin, end;
+        _pool->range(partition, _cores.size(), begin, end);
+        for (int i = begin; i < end; ++i) {
+            _cores[i].PrepareTick(clock);
+            _cores[i].StageCredit(_credit_stage);
+        }
+    });
+
+    _pool->run([this, clock](int partition) {
+        int begin, end;
+        _pool->range(partition, _cores.size(), begin, end);
+        for (int i = begin; i < end; ++i) {
+            _cores[i].IssueTick(clock);
         }
+    });
+
+    _credit_stage.commit(*_pipe_open);
+    for (auto& log: _logs) {
+        log->Flush();
     }
+}
 
-    cores_backup = _cores;
+// Whether any core made progress since the last call. Progress counters only 
+// grow, so their sum serves as an epoch and a check is a single pass.
+bool CoreArray::stateChanged() {
+    unsigned long epoch = 0;
+    for (const CORE& c: _cores) {
+        epoch += c.progress();
+    }
+    bool change = (epoch != _progress_epoch);
+    _progress_epoch = epoch;
     return change;
 }
 
+bool CoreArray::anyCoreBusy(int clock) {
+    for (CORE& c: _cores) {
+        if (c.isBusy(clock)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool CoreArray::allCoreClosed(int _clock) {
     bool core_closed = true;
     for (auto& c: _cores) {
@@ -70,6 +198,33 @@ bool CoreArray::allCoreClosed(int _clock) {
     return core_closed;
 }
 
+// The earliest cycle at which some core may act, `clock` if one can act now
+int CoreArray::wakeupCycle(int clock) const {
+    int wakeup = INT_MAX;
+    for (const CORE& c: _cores) {
+        wakeup = std::min(wakeup, c.wakeupCycle(clock));
+        if (wakeup == clock) {
+            break;
+        }
+    }
+    return wakeup;
+}
+
+// Only between two runs: instructions already issued keep their latencies
+void CoreArray::setLatency(const std::string& latency_file) {
+    _latency = MIParser::parseLatencyFile(latency_file);
+    for (CORE& c: _cores) {
+        c.SetLatency(*_latency);
+    }
+}
+
+// Jump to `clock`: no core acts before it, so only the statistics move
+void CoreArray::skip(int clock) {
+    for (CORE& c: _cores) {
+        c.Skip(clock);
+    }
+}
+
 void CoreArray::DisplayStats(std::ostream& os) {
     for (const CORE& c : _cores) {
         c.DisplayStats(os);
@@ -0,0 +1,163 @@
+#ifndef __ANALYTIC_NOC_H__
+#define __ANALYTIC_NOC_H__
+
+#include <algorithm>
+#include <vector>
+
+#include "noc.hpp"
+
+namespace spatial {
+
+// A packet-level estimate of a k-ary n-mesh, for exploring many mappings
+// where the cycle-accurate network is too slow. A packet is timed as a whole
+// when its source takes it out of the send queue:
+//
+// - its head spends hop_latency cycles in each router on its route, the sum of
+//   the router pipeline delays, and two more to be ejected;
+// - its tail follows the head as fast as the credits of a virtual channel come
+//   back, vc_buf_size flits per credit loop, and the source takes the next
+//   packet a credit loop after it has injected the tail;
+// - it holds every link it takes from its head to its tail, as the multicast
+//   router allocates a single virtual channel, while an ejection port
+//   carries as many packets at once as it takes streams at that rate to
+//   fill it;
+// - its head waits in a router until the port it takes has been released by
+//   the packets that were timed before it, which is how the load of a link
+//   turns into queueing;
+// - while its head waits, the links behind it stay busy with the flits that
+//   don't fit into the analytic_buffer flits of each router in between.
+//
+// Routes follow the routing board with dimension-order routing between its
+// hops, as src_routing does, and the head of a multicast packet takes all the
+// ports of a fork together. A destination gets the packet when its head
+// arrives, as the booksim traffic manager hands it over, and the retirement
+// of the head is the only one logged. Its flits are in flight until its tail
+// arrives, and the network is drained once all tails have. The calibration
+// against booksim is in the README.
+class AnalyticNoC: public NoC {
+
+private:
+    struct Delivery {
+        long long time;     // the cycle it's delivered on
+        long long seq;      // ties are delivered in the order they were timed
+        int node;
+        int flit;           // the head flit, and the rest of its retirement record
+        int pid;
+        int src;
+        int hops;
+        int flat;
+        Packet packet;
+
+        bool operator>(const Delivery& other) const {
+            return time != other.time ? time > other.time : seq > other.seq;
+        }
+        void Checkpoint(StateArchive& ar) {
+            ar & time & seq & node & flit & pid & src & hops & flat & packet;
+        }
+    };
+
+    // The head on segment seg of a routing tree, heading for its hop `hop`,
+    // which arrives at `router` on cycle `arrive` through `link` (-1 from the
+    // source) after `hops` routers
+    struct Branch {
+        int seg;
+        int hop;
+        int router;
+        long long arrive;
+        int hops;
+        int link;
+    };
+
+    PCNInterfaceSet _send_queues;
+    PCNInterfaceSet _receive_queues;
+    LogSink* _log;
+
+    int _k;
+    int _n;
+    int _nodes;
+    int _hop_latency;
+    int _vc_buf;
+    int _credit_loop;   // from a flit leaving a buffer to its credit being used
+    int _lanes;         // of each ejection port
+    int _buffer;
+    std::vector<int> _stride;           // between neighbours in each dimension
+
+    long long _time;                        // the next cycle to step
+    std::vector<long long> _inject_free;    // the cycle each source takes the next packet
+    std::vector<long long> _inject_start;   // the cycle each source took the last one
+    std::vector<int> _inject_size;          // and its flits
+    std::vector<long long> _eject_free;     // the cycle each lane is free again, node * lanes + lane
+    std::vector<long long> _link_free;      // router * 2n + output port, as the mesh numbers its channels
+    std::vector<uint64_t> _link_flits;
+    std::vector<Delivery> _deliveries;      // a min-heap by time
+    std::vector<std::pair<long long, int>> _tails;  // the cycle each tail arrives and the flits it retires, a min-heap
+    long long _seq;
+    int _cur_pid;
+    int _cur_id;
+    int _in_flight;
+
+    std::vector<Branch> _branches;      // scratch for _Send()
+    std::vector<int> _path;             // the links a branch took so far
+
+    int _Next(int router, int port) const {
+        return (port % 2 == 0) ? router + _stride[port / 2] : router - _stride[port / 2];
+    }
+    int _Port(const RoutingBoard& board, int seg, int& hop, int router) const;
+    // The lane of the ejection port of node that is free first
+    int _Lane(int node) const {
+        std::vector<long long>::const_iterator first = _eject_free.begin() + node * _lanes;
+        return std::min_element(first, first + _lanes) - _eject_free.begin();
+    }
+    long long _Take(long long& free, long long arrive, int busy) const {
+        long long leave = std::max(arrive + _hop_latency, free);
+        free = leave + busy;
+        return leave;
+    }
+    // The cycles from the head of a packet to its tail on an idle route
+    int _Stream(int size) const {
+        return std::max(size - 1, (size - 1) / _vc_buf * _credit_loop + (size - 1) % _vc_buf);
+    }
+    // The flits of a packet its source injects in `cycles` cycles from the head
+    int _Injected(int size, long long cycles) const {
+        if (cycles < 0) {
+            return 0;
+        }
+        if (_credit_loop <= _vc_buf) {
+            return (int)std::min<long long>(size, cycles + 1);
+        }
+        return (int)std::min<long long>(size, cycles / _credit_loop * _vc_buf
+                                              + std::min<long long>(_vc_buf, cycles % _credit_loop + 1));
+    }
+    void _Hold(long long leave, int size);
+    void _Send(int src, const Packet& packet, long long start);
+
+public:
+    void step(clock_t clock) override;
+    void skip(clock_t clock, int cycles) override;
+    bool idle() const override;
+    bool traffic_drained() override {
+        return _tails.empty();
+    }
+    unsigned int next_event(clock_t clock) override;
+
+    void DisplayStats(std::ostream & os = std::cout) override;
+    void DisplayPoolStats(std::ostream & /* os */ = std::cout) override { }
+    std::vector<double> router_conflict_factors(bool window) override;
+
+    int num_links() override { return _link_free.size(); }
+    int num_routers() override { return _nodes; }
+    void read_link_flits(uint64_t* flits) override;
+    void read_router_occupancy(uint64_t* flits) override;
+    void read_waiting_flits(uint64_t* flits) override;
+    unsigned long progress() override;
+    int in_flight_flits() const override { return _in_flight; }
+    int router_port_conflicts(std::vector<unsigned long>& requests, std::vector<unsigned long>& grants) override;
+    void Checkpoint(StateArchive& ar) override;
+
+    AnalyticNoC(BookSimConfig config, PCNInterfaceSet send_queues_, PCNInterfaceSet receive_queues_, LogSink* log);
+};
+
+
+};
+
+#endif
@@ -12,51 +12,112 @@
 
 namespace spatial {
 
+// Dims are kept inline and the element count is cached, so tensors can be 
+// copied into packets and queried every cycle without touching the heap.
 struct Tensor {
-    std::vector<int> dims;
+    static const int MAX_DIMS = 8;
     int tid;
 
-    Tensor(std::vector<int> dims_, int tid_): dims(dims_), tid(tid_) { };
-    Tensor(): dims(std::vector<int>()), tid(-1) { };
+    Tensor(const std::vector<int>& dims_, int tid_): tid(tid_), _dims() { setDims(dims_); };
+    Tensor(): tid(-1), _rank(0), _size(0), _dims() { };
     void copyFrom(const Tensor& other) {
-        tid = other.tid;
-        dims = other.dims;
+        *this = other;
     }
-    const int size() {
-        if (dims.empty()) {
-            return 0;
-        }
-        int size = 1;
+    int size() const {
+        return _size;       // 0 while the tensor has no dims
+    }
+    int rank() const {
+        return _rank;
+    }
+    int dim(int i) const {
+        assert(i >= 0 && i < _rank);
+        return _dims[i];
+    }
+    void addDim(int d) {
+        assert(_rank < MAX_DIMS);
+        _dims[_rank++] = d;
+        _size = _rank == 1 ? d : _size * d;
+    }
+    void setDims(const std::vector<int>& dims) {
+        _rank = _size = 0;
         for (int d: dims) {
-            size *= d;
+            addDim(d);
         }
-        return size;
     }
+
+private:
+    int _rank;
+    int _size;
+    int _dims[MAX_DIMS];
 };
 
+// The tensors of one core. Task files name tensors by tid, TaskParser gives 
+// each a dense index and decoded micro-instructions refer to that index.
+typedef std::vector<Tensor> TensorTable;
+
 struct Packet {
     enum TransferType { _UNICAST, _MULTICAST, _REDUCE } type;
     int fid;
     int size;
-    shared_ptr<MCTree> path;
+    shared_ptr<const RoutingBoard> board;   // its tree is board->tree(tree)
+    int tree;
     Tensor data;
 
 public:
 
-    // Packet(int fid_, TransferType type_, int size_, Tensor data_, shared_ptr<MCTree> path_)
-    //     : fid(fid_), type(type_), size(size_), data(data_), path(path_) { };
-    Packet(): type(TransferType::_UNICAST), fid(-1), size(-1), path(nullptr), data() { };
+    Packet(): type(TransferType::_UNICAST), fid(-1), size(-1), board(nullptr), tree(-1), data() { };
     void dumpStat(std::ostream & os) {
         os << "pkt " << fid << ": size-" << size << " tensor-" << data.tid << " to-";
-        for (auto i = path->_leafs.begin(); i != path->_leafs.end(); ++i) {
-            os << *i << ',';
+        for (int d: board->getDestNodes(tree)) {
+            os << d << ',';
+        }
+    }
+    void Checkpoint(StateArchive& ar) {
+        ar & type & fid & size & board & tree & data;
+    }
+};
+
+// Credit-board writes staged while cores are ticked in parallel. In the serial
+// order core i sees the credit that core j refreshed in the same cycle iff
+// j <= i, so reads go through read() to reproduce exactly that.
+struct CreditStage {
+    std::vector<char> refreshed;    // core issues an NI micro-instruction this cycle
+    std::vector<char> credit;       // the credit it writes when doing so
+
+    void resize(int cores) {
+        refreshed.assign(cores, false);
+        credit.assign(cores, false);
+    }
+
+    bool read(const std::vector<bool>& board, int reader, int node) const {
+        return (node <= reader && refreshed[node]) ? credit[node] : board[node];
+    }
+
+    void commit(std::vector<bool>& board) const {
+        for (int node = 0; node < (int)board.size(); ++node) {
+            if (refreshed[node]) {
+                board[node] = credit[node];
+            }
         }
     }
 };
 
-}; 
+};
 
 typedef std::shared_ptr<std::queue<spatial::Packet>> CNInterface;
 typedef std::shared_ptr<std::vector<CNInterface>> PCNInterfaceSet;
 
+// The flits of the packets in a send queue, which std::queue only lets a
+// derived class walk
+struct QueuedFlits: std::queue<spatial::Packet> {
+    static int of(const std::queue<spatial::Packet>& q) {
+        const std::deque<spatial::Packet>& packets = q.*&QueuedFlits::c;
+        int flits = 0;
+        for (const spatial::Packet& p: packets) {
+            flits += p.size;
+        }
+        return flits;
+    }
+};
+
 #endif
\ No newline at end of file
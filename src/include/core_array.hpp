@@ -9,6 +9,8 @@
 
 #include "config_utils.hpp"
 #include "core.h"
+#include "worker_pool.hpp"
+#include "event_log.hpp"
 
 namespace spatial {
 
@@ -19,17 +21,39 @@ private:
     std::vector<CORE> _cores;
     std::shared_ptr<std::vector<bool>> _pipe_open;
     Configuration _config;
+    unsigned long _progress_epoch;     // summed progress of all cores at the last stateChanged()
+
+    // Parallel stepping, enabled when core_threads > 1
+    std::shared_ptr<WorkerPool> _pool;
+    CreditStage _credit_stage;
+    std::vector<std::shared_ptr<LogBuffer> > _logs;     // per-core events, flushed in core order
+
+    // Shared by the cores, and by those of forks
+    std::shared_ptr<const LatencyTable> _latency;
+    std::shared_ptr<const RoutingBoard> _routing_board;
+
+    void _buildCores(const std::vector<std::shared_ptr<const CompiledTasks>>& programs, 
+        PCNInterfaceSet send_queues_, PCNInterfaceSet receive_queues_, LogSink* log, std::ostream& os);
+    void _parallelStep(int clock);
 
 public:
     CoreArray(Configuration config, PCNInterfaceSet send_queues_, PCNInterfaceSet receive_queues_, \
-        std::shared_ptr<std::vector<bool>> open_pipe);
+        std::shared_ptr<std::vector<bool>> open_pipe, LogSink* log, std::ostream& os = std::cout);
+    CoreArray(const CoreArray& parent, Configuration config, PCNInterfaceSet send_queues_, 
+        PCNInterfaceSet receive_queues_, std::shared_ptr<std::vector<bool>> open_pipe, LogSink* log, 
+        std::ostream& os = std::cout);
     ~CoreArray() {}
 
     void step(int clock);
     void DisplayStats(std::ostream & os = std::cout);
 
     bool allCoreClosed(int _clock);
+    int wakeupCycle(int clock) const;
+    void skip(int clock);
     bool stateChanged();
+    bool anyCoreBusy(int clock);
+    void setLatency(const std::string& latency_file);
+    void Checkpoint(StateArchive& ar);
 };
 
 
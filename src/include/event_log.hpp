@@ -0,0 +1,463 @@
+#ifndef __EVENT_LOG_HPP__
+#define __EVENT_LOG_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace spatial {
+
+// Simulation events that used to be printed line by line. Each one belongs to a
+// category and a level, and is stored as a fixed-size record which is turned
+// back into its text line by FormatRecord.
+enum LogLevel { LOG_ERROR = 0, LOG_WARNING, LOG_INFO, LOG_TRACE };
+enum LogCategory { LOG_CORE = 1 << 0, LOG_NI = 1 << 1, LOG_NOC = 1 << 2, LOG_ALL = 0x7 };
+
+enum LogEvent {
+    EVENT_STRING = 0,       // defines string arg[0] of arg[1] bytes, stored in the records that follow
+    EVENT_FINISH_INSTR,     // core, string of the micro-instruction
+    EVENT_NI_ENQUEUE,       // core
+    EVENT_NI_PEND,          // core
+    EVENT_NI_IGNORE_TREE,   // core, tensor
+    EVENT_RETIRE_FLIT,      // flit, packet, src, dest, hops, flat
+    NUM_EVENTS
+};
+
+struct LogRecord {
+    int32_t event;
+    int32_t clock;          // -1 if the event isn't tied to a cycle
+    int32_t arg[6];
+};
+
+static_assert(sizeof(LogRecord) == 32, "log records are written to disk as is");
+
+struct LogFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+
+static const char LOG_MAGIC[8] = {'S', 'P', 'E', 'V', 'L', 'O', 'G', '\0'};
+static const uint32_t LOG_VERSION = 1;
+
+inline int EventCategory(int event) {
+    switch (event) {
+        case EVENT_FINISH_INSTR: return LOG_CORE;
+        case EVENT_RETIRE_FLIT: return LOG_NOC;
+        default: return LOG_NI;
+    }
+}
+
+inline int EventLevel(int event) {
+    switch (event) {
+        case EVENT_FINISH_INSTR: return LOG_INFO;
+        case EVENT_NI_IGNORE_TREE: return LOG_WARNING;
+        default: return LOG_TRACE;
+    }
+}
+
+// The text line of an event, exactly as the simulator printed it before
+inline void FormatRecord(const LogRecord& r, const std::deque<std::string>& strings, std::ostream& os) {
+    switch (r.event) {
+        case EVENT_FINISH_INSTR:
+            os << r.clock << " | CORE" << r.arg[0] << " | Finish Micro-Inst: | " << strings[r.arg[1]] << '\n';
+            break;
+        case EVENT_NI_ENQUEUE:
+            os << "CORE | NI enqueues package" << '\n';
+            break;
+        case EVENT_NI_PEND:
+            os << "CORE | Destinations of this package is unavailable, pend package sending" << '\n';
+            break;
+        case EVENT_NI_IGNORE_TREE:
+            os << "WARNING | " << "We ignore the broadcast tree because only unicast packets are permitted. " << '\n';
+            break;
+        case EVENT_RETIRE_FLIT:
+            os << "Retiring flit " << r.arg[0] << " (packet " << r.arg[1] << ", src = " << r.arg[2]
+               << ", dest = " << r.arg[3] << ", hops = " << r.arg[4] << ", flat = " << r.arg[5] << ")." << '\n';
+            break;
+        default:
+            break;
+    }
+}
+
+inline LogRecord MakeRecord(int event, int clock, int a0 = 0, int a1 = 0, int a2 = 0,
+                            int a3 = 0, int a4 = 0, int a5 = 0) {
+    LogRecord r = {event, clock, {a0, a1, a2, a3, a4, a5}};
+    return r;
+}
+
+
+// Where components send their events. Producers check Enabled() before
+// building a record, so filtered events cost a single branch.
+class LogSink {
+public:
+    virtual ~LogSink() {}
+    virtual bool Enabled(int event) const = 0;
+    virtual void Emit(const LogRecord& r) = 0;
+    virtual int Intern(const std::string& s) = 0;
+
+    void Log(int event, int clock, int a0 = 0, int a1 = 0, int a2 = 0, int a3 = 0, int a4 = 0, int a5 = 0) {
+        if (Enabled(event)) {
+            Emit(MakeRecord(event, clock, a0, a1, a2, a3, a4, a5));
+        }
+    }
+};
+
+
+// A bounded multi-producer, single-consumer ring of records. Producers claim
+// consecutive slots with one atomic add, so a multi-record event is never
+// interleaved with others, and wait only when the ring is full.
+class LogRing {
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq;
+        LogRecord record;
+    };
+
+    uint64_t _mask;
+    std::unique_ptr<Slot[]> _slots;
+    std::atomic<uint64_t> _head;
+    uint64_t _tail;
+
+public:
+    explicit LogRing(int log2_capacity)
+        : _mask((1ull << log2_capacity) - 1), _slots(new Slot[1ull << log2_capacity]), _head(0), _tail(0)
+    {
+        for (uint64_t i = 0; i <= _mask; ++i) {
+            _slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t capacity() const { return _mask + 1; }
+
+    void push(const LogRecord* records, int n) {
+        uint64_t pos = _head.fetch_add(n, std::memory_order_relaxed);
+        for (int i = 0; i < n; ++i, ++pos) {
+            Slot& slot = _slots[pos & _mask];
+            while (slot.seq.load(std::memory_order_acquire) != pos) {
+                std::this_thread::yield();
+            }
+            slot.record = records[i];
+            slot.seq.store(pos + 1, std::memory_order_release);
+        }
+    }
+
+    // Take up to max records in order, stops at the first slot not yet written
+    int pop(LogRecord* out, int max) {
+        int n = 0;
+        while (n < max) {
+            Slot& slot = _slots[_tail & _mask];
+            if (slot.seq.load(std::memory_order_acquire) != _tail + 1) {
+                break;
+            }
+            out[n++] = slot.record;
+            slot.seq.store(_tail + _mask + 1, std::memory_order_release);
+            ++_tail;
+        }
+        return n;
+    }
+
+    bool drained() const {
+        return _tail == _head.load(std::memory_order_acquire);
+    }
+};
+
+
+// Turns records back into their text lines. Strings are defined by an
+// EVENT_STRING record and its payload records, which may come in any batch.
+class LogDecoder {
+
+private:
+    std::deque<std::string> _strings;
+    std::string _pending;       // the payload of a string being defined
+    int _pending_id, _pending_length, _pending_records;
+
+    void _define() {
+        _pending.resize(_pending_length);
+        if (_pending_id >= (int)_strings.size()) {
+            _strings.resize(_pending_id + 1);
+        }
+        _strings[_pending_id].swap(_pending);
+        _pending.clear();
+    }
+
+public:
+    LogDecoder(): _pending_id(0), _pending_length(0), _pending_records(0) { }
+
+    void Feed(const LogRecord& r, std::ostream& os) {
+        if (_pending_records > 0) {
+            _pending.append(reinterpret_cast<const char*>(&r), sizeof(r));
+            if (--_pending_records == 0) {
+                _define();
+            }
+        } else if (r.event == EVENT_STRING) {
+            _pending_id = r.arg[0];
+            _pending_length = r.arg[1];
+            _pending_records = (_pending_length + sizeof(LogRecord) - 1) / sizeof(LogRecord);
+            if (_pending_records == 0) {
+                _define();
+            }
+        } else {
+            FormatRecord(r, _strings, os);
+        }
+    }
+
+    // Whether the records ended in the middle of a string
+    bool truncated() const { return _pending_records > 0; }
+};
+
+
+// The log of one simulation. Events are pushed into a ring that a background
+// thread drains, so the simulating threads never format or write them.
+// Without a file, the writer formats them as text into the given stream, i.e.
+// into the log_file. With one, it writes them to that file in binary form, 
+// which the spatialsim_logdecode tool turns back into text. Whoever else
+// writes into the text stream calls Flush() first to keep the lines in order,
+// and text logs that are interleaved with traces as they're written aren't
+// put in the background at all.
+class EventLog : public LogSink {
+
+private:
+    static const int RING_LOG2_CAPACITY = 16;
+    static const int WRITE_BATCH = 1024;
+    static const int MAX_IDLE_US = 4096;      // the ring holds far more than is logged meanwhile
+
+    uint32_t _mask;
+
+    std::mutex _mutex, _write_mutex;
+    std::unordered_map<std::string, int> _ids;
+
+    std::ostream* _text;
+    LogDecoder _decoder;
+    std::unique_ptr<LogRing> _ring;
+    std::ofstream _file;
+    std::thread _writer;
+    std::atomic<bool> _stop;
+    std::atomic<uint64_t> _flush_requests, _flushes;
+    std::mutex _wake_mutex;
+    std::condition_variable _wake, _flushed;
+
+    std::ostream& _output() {
+        return _file.is_open() ? static_cast<std::ostream&>(_file) : *_text;
+    }
+
+    void _write(const LogRecord* records, int n) {
+        if (_file.is_open()) {
+            _file.write(reinterpret_cast<const char*>(records), n * sizeof(LogRecord));
+            return;
+        }
+        for (int i = 0; i < n; ++i) {
+            _decoder.Feed(records[i], *_text);
+        }
+    }
+
+    void _push(const LogRecord* records, int n) {
+        if (_ring) {
+            _ring->push(records, n);
+        } else {
+            std::lock_guard<std::mutex> lock(_write_mutex);
+            _write(records, n);
+        }
+    }
+
+    void _acknowledge(uint64_t requests) {
+        _output().flush();
+        _flushes.store(requests, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(_wake_mutex);
+        _flushed.notify_all();
+    }
+
+    // Requests are read before popping: whatever was pushed before a request
+    // is then guaranteed to be written before it's acknowledged. The writer 
+    // only keeps going while there are full batches to write, and otherwise 
+    // sleeps longer and longer so that it doesn't steal the simulation's cores.
+    // Flush and Close wake it up right away.
+    void _drain() {
+        std::vector<LogRecord> batch(WRITE_BATCH);
+        int idle_us = 1;
+        while (true) {
+            bool stop = _stop.load(std::memory_order_acquire);
+            uint64_t requests = _flush_requests.load(std::memory_order_acquire);
+            int n = _ring->pop(batch.data(), WRITE_BATCH);
+            if (n > 0) {
+                _write(batch.data(), n);
+                if (n == WRITE_BATCH) {
+                    idle_us = 1;
+                    continue;
+                }
+            } else if (stop && _ring->drained()) {
+                break;
+            } else if (_flushes.load(std::memory_order_relaxed) < requests) {
+                _acknowledge(requests);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(_wake_mutex);
+            _wake.wait_for(lock, std::chrono::microseconds(idle_us), [&]() {
+                return _stop.load(std::memory_order_acquire) || 
+                    _flush_requests.load(std::memory_order_acquire) > _flushes.load(std::memory_order_relaxed);
+            });
+            idle_us = std::min(idle_us * 2, MAX_IDLE_US);
+        }
+        _acknowledge(_flush_requests.load());
+    }
+
+public:
+    EventLog(int level = LOG_TRACE, int categories = LOG_ALL, const std::string& file = "",
+             std::ostream& text = std::cout, bool background = true)
+        : _mask(0), _text(&text), _stop(false), _flush_requests(0), _flushes(0)
+    {
+        for (int e = 1; e < NUM_EVENTS; ++e) {
+            if (EventLevel(e) <= level && (EventCategory(e) & categories)) {
+                _mask |= 1u << e;
+            }
+        }
+        if (file != "") {
+            _file.open(file, std::ios::out | std::ios::binary);
+            if (!_file) {
+                throw "Can not open the event log " + file;
+            }
+            LogFileHeader header;
+            memcpy(header.magic, LOG_MAGIC, sizeof(LOG_MAGIC));
+            header.version = LOG_VERSION;
+            header.record_size = sizeof(LogRecord);
+            _file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+        if (background || _file.is_open()) {
+            _ring.reset(new LogRing(RING_LOG2_CAPACITY));
+            _writer = std::thread(&EventLog::_drain, this);
+        }
+    }
+
+    ~EventLog() { Close(); }
+
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+
+    // Write out everything logged so far and stop the writer
+    void Close() {
+        if (_writer.joinable()) {
+            _stop.store(true, std::memory_order_release);
+            {
+                std::lock_guard<std::mutex> lock(_wake_mutex);
+                _wake.notify_one();
+            }
+            _writer.join();
+        }
+    }
+
+    // Wait until everything logged so far is written out
+    void Flush() {
+        if (!_writer.joinable()) {
+            std::lock_guard<std::mutex> lock(_write_mutex);
+            _output().flush();
+            return;
+        }
+        uint64_t request = _flush_requests.fetch_add(1, std::memory_order_acq_rel) + 1;
+        std::unique_lock<std::mutex> lock(_wake_mutex);
+        _wake.notify_one();
+        _flushed.wait(lock, [&]() { return _flushes.load(std::memory_order_acquire) >= request; });
+    }
+
+    bool binary() const { return _file.is_open(); }
+
+    virtual bool Enabled(int event) const override {
+        return _mask & (1u << event);
+    }
+
+    virtual void Emit(const LogRecord& r) override {
+        _push(&r, 1);
+    }
+
+    // The id of a string, defined in the log the first time it's seen
+    virtual int Intern(const std::string& s) override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto iter = _ids.find(s);
+        if (iter != _ids.end()) {
+            return iter->second;
+        }
+        int id = _ids.size();
+        _ids[s] = id;
+
+        int payload = (s.size() + sizeof(LogRecord) - 1) / sizeof(LogRecord);
+        std::vector<LogRecord> records(1 + payload);
+        records[0] = MakeRecord(EVENT_STRING, -1, id, s.size());
+        memcpy(records.data() + 1, s.data(), s.size());
+        _push(records.data(), records.size());
+        return id;
+    }
+
+    static int ParseLevel(const std::string& level) {
+        const char* names[] = {"error", "warning", "info", "trace"};
+        for (int l = LOG_ERROR; l <= LOG_TRACE; ++l) {
+            if (level == names[l]) {
+                return l;
+            }
+        }
+        throw "Unknown log level " + level;
+    }
+
+    static int ParseCategories(const std::vector<std::string>& categories) {
+        int mask = 0;
+        for (const std::string& c: categories) {
+            if (c == "all") {
+                mask |= LOG_ALL;
+            } else if (c == "core") {
+                mask |= LOG_CORE;
+            } else if (c == "ni") {
+                mask |= LOG_NI;
+            } else if (c == "noc") {
+                mask |= LOG_NOC;
+            } else {
+                throw "Unknown log category " + c;
+            }
+        }
+        return mask;
+    }
+
+    // The text-mode log of components that aren't attached to a simulation
+    static EventLog& Default() {
+        static EventLog log;
+        return log;
+    }
+};
+
+
+// Holds the events of one core during a parallel step, so that they reach the
+// simulation's log in core order.
+class LogBuffer : public LogSink {
+
+private:
+    LogSink* _log;
+    std::vector<LogRecord> _records;
+
+public:
+    explicit LogBuffer(LogSink* log): _log(log) { }
+
+    virtual bool Enabled(int event) const override { return _log->Enabled(event); }
+    virtual void Emit(const LogRecord& r) override { _records.push_back(r); }
+    virtual int Intern(const std::string& s) override { return _log->Intern(s); }
+
+    void Flush() {
+        for (const LogRecord& r: _records) {
+            _log->Emit(r);
+        }
+        _records.clear();
+    }
+};
+
+};
+
+#endif
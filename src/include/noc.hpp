@@ -10,26 +10,86 @@
 
 namespace spatial {
 
+// The network between the cores: it takes the packets out of the send queues
+// and puts them into the receive queues of their destinations. `noc_model`
+// selects how: booksim for the cycle-accurate network, analytic for a
+// packet-level estimate (see analytic_noc.hpp).
 class NoC {
 
+public:
+    static NoC* New(BookSimConfig config, PCNInterfaceSet send_queues_, PCNInterfaceSet receive_queues_, LogSink* log);
+    virtual ~NoC() { }
+
+    virtual void step(clock_t clock) = 0;
+    // Skip `cycles` cycles starting from `clock`, before next_event()
+    virtual void skip(clock_t clock, int cycles) = 0;
+    virtual bool idle() const = 0;
+    virtual bool traffic_drained() = 0;
+    // The first cycle from `clock` on at which the network has to be stepped,
+    // or UINT_MAX if it won't change until something is sent into it
+    virtual unsigned int next_event(clock_t clock) = 0;
+
+    virtual void DisplayStats(std::ostream & os = std::cout) = 0;
+    virtual void DisplayPoolStats(std::ostream & os = std::cout) = 0;
+    virtual std::vector<double> router_conflict_factors(bool window) = 0;
+
+    // Telemetry readings, one value per link, router or node
+    virtual int num_links() = 0;
+    virtual int num_routers() = 0;
+    virtual void read_link_flits(uint64_t* flits) = 0;          // sent through each link since the network was built
+    virtual void read_router_occupancy(uint64_t* flits) = 0;    // in the input buffers of each router
+    virtual void read_waiting_flits(uint64_t* flits) = 0;       // of the packets queued or being injected at each node
+    virtual int in_flight_flits() const = 0;
+    // Grows whenever flits move, so that a draining network isn't taken for a deadlock
+    virtual unsigned long progress() = 0;
+    virtual int router_port_conflicts(std::vector<unsigned long>& requests, std::vector<unsigned long>& grants) = 0;
+    virtual void Checkpoint(StateArchive& ar) = 0;
+};
+
+
+// The cycle-accurate network, simulated by booksim
+class BookSimNoC: public NoC {
+
 private:
     TrafficManager* _traffic_manager = NULL;
+    std::vector<Network*> _networks;
     BookSimConfig _config;
+    PCNInterfaceSet _send_queues;
+
+    static int ParallelNoCThreads(const BookSimConfig& config);
 
 public:
-    void step(clock_t clock);
-    bool traffic_drained() {
+    void step(clock_t clock) override;
+    void skip(clock_t clock, int cycles) override;
+    bool idle() const override {
+        return _traffic_manager->Idle();
+    }
+    bool traffic_drained() override {
         return _traffic_manager->flitsDrained();
     }
+    unsigned int next_event(clock_t clock) override;
+
+    void DisplayStats(std::ostream & os = std::cout) override;
+    void DisplayPoolStats(std::ostream & os = std::cout) override;
+    std::vector<double> router_conflict_factors(bool window) override;
 
-    void DisplayStats(std::ostream & os = std::cout);
-    std::vector<double> router_conflict_factors();
+    int num_links() override;
+    int num_routers() override;
+    void read_link_flits(uint64_t* flits) override;
+    void read_router_occupancy(uint64_t* flits) override;
+    void read_waiting_flits(uint64_t* flits) override;
+    int in_flight_flits() const override { return _traffic_manager->InFlightFlits(); }
+    unsigned long progress() override;
+    int router_port_conflicts(std::vector<unsigned long>& requests, std::vector<unsigned long>& grants) override;
+    void Checkpoint(StateArchive& ar) override {
+        _traffic_manager->Checkpoint(ar);
+    }
 
-    NoC(BookSimConfig config, PCNInterfaceSet send_queues_, PCNInterfaceSet receive_queues_);
-    ~NoC() { delete _traffic_manager; };
+    BookSimNoC(BookSimConfig config, PCNInterfaceSet send_queues_, PCNInterfaceSet receive_queues_, LogSink* log);
+    ~BookSimNoC();
 };
 
 
 };
 
-#endif  
\ No newline at end of file
+#endif
@@ -1,11 +1,16 @@
 #ifndef __PATH_HPP__
 #define __PATH_HPP__
 
+#include <assert.h>
+#include <cstdint>
+#include <iostream>
+#include <string>
 #include <vector>
 #include <set>
 #include <map>
 #include <memory>
 #include <queue>
+#include "state_archive.hpp"
 
 using namespace std;
 
@@ -13,6 +18,128 @@ typedef pair<int, int> Segment;
 const int TREESTART = -2;
 const int INVALID = -3;
 
+class MCTree;
+
+// The multicast trees of a routing board compiled into flat arrays, indexed
+// by tree: their segments, the intermediate nodes of each segment (hops) and
+// a bitset of the destination nodes of each tree (leaves). A board never
+// changes once built, so packets refer to a tree of it and their flits keep
+// a cursor into its segments and hops. Segments of a tree are in breadth-
+// first order from its root segment, so the segments that succeed one are a
+// contiguous range. The arrays are held in vectors, or are those of a board
+// file written by save() and mapped into memory by load().
+class RoutingBoard {
+public:
+    struct Seg {
+        int32_t start, end;
+        int32_t hop_begin, hop_end;     // its intermediate nodes in hops
+        int32_t child_begin, child_end; // its succeeding segments in segs
+        int32_t eject;                  // end is a destination node
+    };
+    struct Tree {
+        int32_t tid;
+        int32_t seg_begin, seg_end;     // the first is its root segment
+        int32_t leaf_begin, leaf_end;   // the words of its leaf bitset
+    };
+
+    RoutingBoard();
+    ~RoutingBoard();
+    RoutingBoard(const RoutingBoard&) = delete;
+    RoutingBoard& operator=(const RoutingBoard&) = delete;
+
+    int size() const { return _num_trees; }
+    const Tree& tree(int t) const { return _trees[t]; }
+    const Seg& seg(int s) const { return _segs[s]; }
+    int hop(int h) const { return _hops[h]; }
+
+    // The tree of tensor tid, -1 if there is none
+    int find(int tid) const {
+        int lo = 0, hi = _num_trees;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (_trees[mid].tid < tid) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return (lo < _num_trees && _trees[lo].tid == tid) ? lo : -1;
+    }
+
+    // The segment of tree t from seg.first to seg.second, -1 if there is none
+    int findSeg(int t, Segment seg) const {
+        for (int i = _trees[t].seg_begin; i < _trees[t].seg_end; ++i) {
+            if (_segs[i].start == seg.first && _segs[i].end == seg.second) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    bool isDestNode(int t, int nid) const {
+        int word = _trees[t].leaf_begin + nid / 64;
+        return nid >= 0 && word < _trees[t].leaf_end && ((_leaves[word] >> (nid % 64)) & 1);
+    }
+
+    // The destination nodes of tree t in increasing order
+    vector<int> getDestNodes(int t) const {
+        vector<int> dests;
+        for (int w = _trees[t].leaf_begin; w < _trees[t].leaf_end; ++w) {
+            for (uint64_t bits = _leaves[w]; bits != 0; bits &= bits - 1) {
+                dests.push_back((w - _trees[t].leaf_begin) * 64 + __builtin_ctzll(bits));
+            }
+        }
+        return dests;
+    }
+
+    // Appends a tree; trees are added in increasing order of tid
+    int add(int tid, MCTree& tree);
+
+    // Writes the board into a file for load(), throws a std::string on failure
+    void save(const std::string& file) const;
+    // Whether the file starts like one written by save()
+    static bool isBoardFile(const std::string& file);
+    // Maps a file written by save() into memory. Throws a std::string if it
+    // is damaged or of another version.
+    static shared_ptr<const RoutingBoard> load(const std::string& file);
+
+    // Only met through the flits and packets in flight. A board restored from
+    // a checkpoint holds its arrays in vectors, whatever the saved one did.
+    void Checkpoint(spatial::StateArchive& ar) {
+        vector<Tree> trees(_trees, _trees + _num_trees);
+        vector<Seg> segs(_segs, _segs + _num_segs);
+        vector<int32_t> hops(_hops, _hops + _num_hops);
+        vector<uint64_t> leaves(_leaves, _leaves + _num_leaves);
+        ar & trees & segs & hops & leaves;
+        if (ar.loading()) {
+            _tree_store.swap(trees);
+            _seg_store.swap(segs);
+            _hop_store.swap(hops);
+            _leaf_store.swap(leaves);
+            _view();
+        }
+    }
+
+private:
+    const Tree* _trees;
+    const Seg* _segs;
+    const int32_t* _hops;
+    const uint64_t* _leaves;
+    int _num_trees, _num_segs, _num_hops, _num_leaves;
+
+    // The arrays of a board that was built or restored from a checkpoint
+    vector<Tree> _tree_store;
+    vector<Seg> _seg_store;
+    vector<int32_t> _hop_store;
+    vector<uint64_t> _leaf_store;
+    // The file of a mapped board
+    void* _map;
+    size_t _map_size;
+
+    // Points the arrays at the vectors
+    void _view();
+};
+
 // The tree-based multicast path. It enables individual non-optimal
 // routing for each edge within the tree. 
 class MCTree {
@@ -21,8 +148,6 @@ public:
     multimap<int, int> _tree;                       // branch tree: start-end
     set<int> _leafs;                                // destination nodes
 
-public:
-
     int root() {
         assert(_tree.count(TREESTART) == 1);
         return _tree.find(TREESTART)->second;
@@ -95,6 +220,7 @@ public:
         }
     }
 
+    MCTree() { }
     MCTree(int root) { 
         _tree.insert(make_pair(TREESTART, root));
         _path.insert(make_pair(make_pair(TREESTART, root), make_shared<queue<int>>()));
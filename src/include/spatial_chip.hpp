@@ -1,15 +1,22 @@
 #ifndef __SPATIAL_CHIP_H__
 #define __SPATIAL_CHIP_H__
 
+#include <climits>
+#include <map>
 #include <queue>
 #include <vector>
 #include <fstream>
 #include <string>
 #include <memory>
 #include "config_utils.hpp"
+#include "spatial_config.hpp"
 #include "bridge.hpp"
 #include "noc.hpp"
 #include "core_array.hpp"
+#include "event_log.hpp"
+#include "globals.hpp"
+#include "state_archive.hpp"
+#include "telemetry.hpp"
 
 
 namespace spatial {
@@ -17,35 +24,87 @@ namespace spatial {
 class NoC;
 class CoreArray;
 
-// The top module of our simulator
+// The top module of our simulator. Chips share no mutable state, so several
+// of them may be simulated at once, each on its own thread.
 class SpatialChip {
 
 private:
+    // Everything the NoC used to keep in globals; bound to the calling thread
+    // whenever the chip is used. Declared first so that it outlives the rest.
+    std::unique_ptr<SimContext> _context;
+
     unsigned int _clock;
-    Configuration _config;
+    SpatialSimConfig _config;
 
     PCNInterfaceSet _send_queues;      // the interface between core and noc: send packets
     PCNInterfaceSet _received_queues;  // the interface between core and noc: receive packets
     std::shared_ptr<std::vector<bool> > _credit_board;
 
     std::ostream* _log_file;
+    std::shared_ptr<EventLog> _event_log;
 
     // Two hardware components, interacting with each other only via the queeue pair
     std::shared_ptr<NoC> noc;
     std::shared_ptr<CoreArray> core_array;
+    unsigned long _noc_epoch;   // noc->progress() at the last check_deadlock()
+
+    // The state of the chip as built, which reset() loads back
+    std::string _initial_state;
+
+    // Null unless telemetry_interval is set
+    std::unique_ptr<Telemetry> _telemetry;
+
+    static SpatialSimConfig _parseSpec(const std::string& spatial_chip_spec);
+    SpatialChip(const SpatialSimConfig& config, const CoreArray& parent_cores);
+    void _build(const CoreArray* parent_cores);
+    void _teardown();
+    void _checkpoint(StateArchive& ar);
+    void _saveInitialState();
+    void _setupTelemetry();
+    void _readTelemetry();
 
 public:
+    // Rewinds the chip to cycle 0, keeping the compiled tasks and the network
     void reset();
-    unsigned int run();
+    // Resets the chip with other NoC parameters or micro-instruction latencies,
+    // e.g. {"num_vcs": "8"} or {"micro_instr_latency": "..."}. Only the NoC is
+    // rebuilt. Parameters the cores are built from (k, n, tasks, routing_board
+    // ...) need a new chip. Throws a std::string if a parameter can't be set or
+    // the NoC can't be built, keeping the old network and config.
+    void reconfigure(const std::map<std::string, std::string>& parameters);
+    // Simulates until the tasks are finished or the clock reaches `until`, 
+    // and returns the clock. Calling it again resumes the simulation.
+    unsigned int run(unsigned int until = UINT_MAX);
     bool task_finished(int _clock);
+    unsigned int next_event();
     bool check_deadlock();
     void display_stats(std::ostream& os = std::cout);
     std::vector<int> compute_cycles();
     std::vector<int> communicate_cycles();
-    std::vector<double> router_conflict_factors();
+    // The share of allocation requests each router denied since the chip was
+    // built or reset. With `window`, the share since the previous call with
+    // `window` instead, and a new window starts.
+    std::vector<double> router_conflict_factors(bool window = false);
+    // The samples taken so far, null if telemetry_interval is 0. They start
+    // over whenever the chip is reset or a checkpoint is loaded.
+    const Telemetry* telemetry() const { return _telemetry.get(); }
+    // Requests to and grants of each output port of each router, row-major by
+    // router. Returns the number of ports of a router.
+    int router_port_conflicts(std::vector<unsigned long>& requests, std::vector<unsigned long>& grants);
+
+    // The state of the simulation at the current clock, to be loaded into a 
+    // chip built from the same specification. Loading throws a std::string if
+    // the checkpoint doesn't fit, after which the chip can't be used.
+    void save_checkpoint(const std::string& path);
+    void load_checkpoint(const std::string& path);
+    // A new chip in the state of this one, which logs into `log_file` and
+    // writes no event log. Both continue independently.
+    std::unique_ptr<SpatialChip> fork(const std::string& log_file = "-");
 
+    // Throws a std::string if the chip can't be built from the specification
     SpatialChip(std::string spatial_chip_spec);
-    ~SpatialChip() { }
+    explicit SpatialChip(const SpatialSimConfig& config);
+    ~SpatialChip();
 };
 
 };
@@ -12,9 +12,22 @@ public:
 
         AddStrField("log_file", "log.txt");
 
+        // simulation events: filters, and a binary file to write them to instead of log_file
+        AddStrField("log_level", "trace");          // error, warning, info or trace
+        AddStrField("log_categories", "all");       // any of core, ni, noc, e.g. {core,noc}
+        AddStrField("event_log", "");
+
+        // telemetry: samples every telemetry_interval cycles, 0 to disable or at least
+        // 100, of which the last telemetry_samples are kept and written into
+        // telemetry_file if given
+        _int_map["telemetry_interval"] = 0;
+        _int_map["telemetry_samples"] = 4096;
+        AddStrField("telemetry_file", "");
+
         // tasks
         AddStrField("tasks", "");
         AddStrField("working_directory", "tasks");
+        AddStrField("workload_cache", "");         // a directory to keep compiled task files in, none if empty
 
         // micro-instruction latencies
         AddStrField("micro_instr_latency", "runfiles/micro_instr_latency");
@@ -22,9 +35,17 @@ public:
         // routing-boards
         AddStrField("routing_board", "routing_board");
 
+        // the network: booksim for the cycle-accurate one, analytic for a packet-level estimate
+        AddStrField("noc_model", "booksim");
+        _int_map["analytic_buffer"] = 14;   // Flits a router holds of a blocked packet in the analytic model, fitted to booksim
+
         _int_map["threshold"] = 2;      // When to reject accepting packets
         _int_map["array_size"] = 16;    // The size of core array, FIXME: Deprecated now
         _int_map["deadlock_check_freq"] = 1000;     // How much cycles do we check deadlocks
+        _int_map["load_threads"] = 0;   // Threads that compile the task files, 0 for one per hardware thread
+        _int_map["core_threads"] = 1;   // Threads that tick the cores in parallel, 1 for serial stepping
+        _int_map["noc_threads"] = 1;    // Threads that evaluate the routers in parallel, 1 for serial evaluation
+        _int_map["fast_forward"] = 0;   // Jump over cycles where all cores are busy and the network is idle
 
     }
 
@@ -0,0 +1,359 @@
+#ifndef __STATE_ARCHIVE_HPP__
+#define __STATE_ARCHIVE_HPP__
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace spatial {
+
+class StateArchive;
+
+// Whether T has a member void Checkpoint(StateArchive&)
+template <class T>
+class HasCheckpoint {
+    template <class U>
+    static char test(decltype(std::declval<U&>().Checkpoint(std::declval<StateArchive&>()))*);
+    template <class U>
+    static long test(...);
+public:
+    static const bool value = sizeof(test<T>(0)) == sizeof(char);
+};
+
+// The dynamic state of a simulation as one flat binary image. Each stateful
+// class has a Checkpoint(StateArchive&) which either saves its fields into
+// the archive or loads them back, so that both directions visit the same
+// fields in the same order:
+//
+//     void VC::Checkpoint(StateArchive& ar) { ar & _buffer & _state & _pri; }
+//
+// Plain values and structs are copied bytewise, containers element by element.
+// Objects reached through pointers (flits, credits, routing trees and plans)
+// are written where they are first met and referred to by index afterwards,
+// so a loaded simulation shares them exactly as the saved one did.
+//
+// Configuration is not part of the image: it is loaded into a simulation
+// built from the same specification, which only takes the state over.
+class StateArchive {
+
+public:
+    // Saves into an empty image
+    StateArchive(): _loading(false), _pos(0) { }
+    // Loads from the image
+    explicit StateArchive(const std::string& image): _loading(true), _image(image), _pos(0) { }
+
+    bool loading() const { return _loading; }
+    const std::string& image() const { return _image; }
+    bool exhausted() const { return _pos == _image.size(); }
+
+    template <class T>
+    StateArchive& operator&(T& v) {
+        _Item(v);
+        return *this;
+    }
+
+    // Sizes that the loading simulation must share with the saved one, such
+    // as the number of routers or of VCs per port
+    template <class T>
+    void Check(const T& v, const char* what) {
+        T saved = v;
+        _Item(saved);
+        if (_loading && !(saved == v)) {
+            throw std::string("The checkpoint doesn't match this simulation: ") + what + " differs";
+        }
+    }
+
+private:
+    static const int NULL_REF = -1;
+    static const int NEW_REF = -2;
+
+    bool _loading;
+    std::string _image;
+    size_t _pos;
+
+    // pointer -> index, while saving
+    std::unordered_map<const void*, int> _raw_ids;
+    std::unordered_map<const void*, int> _shared_ids;
+    // index -> object, while loading
+    std::vector<void*> _raw;
+    std::vector<std::shared_ptr<void> > _shared;
+
+    void _Bytes(void* p, size_t n) {
+        if (!_loading) {
+            _image.append(static_cast<const char*>(p), n);
+            return;
+        }
+        if (_image.size() - _pos < n) {
+            throw std::string("The checkpoint is truncated");
+        }
+        std::memcpy(p, _image.data() + _pos, n);
+        _pos += n;
+    }
+
+    size_t _Size(size_t n) {
+        uint32_t size = n;
+        _Bytes(&size, sizeof(size));
+        return size;
+    }
+
+    int _Ref(const void* p, std::unordered_map<const void*, int>& ids, bool& fresh) {
+        int ref = NULL_REF;
+        fresh = false;
+        if (p != NULL) {
+            auto iter = ids.find(p);
+            if (iter == ids.end()) {
+                ids.insert(std::make_pair(p, (int)ids.size()));
+                ref = NEW_REF;
+                fresh = true;
+            } else {
+                ref = iter->second;
+            }
+        }
+        _Bytes(&ref, sizeof(ref));
+        return ref;
+    }
+
+    static std::string _BadRef() {
+        return "The checkpoint refers to an object it doesn't contain";
+    }
+
+    // Values and structs
+    template <class T>
+    void _Item(T& v) {
+        _Value(v, std::integral_constant<bool, HasCheckpoint<T>::value>());
+    }
+
+    template <class T>
+    void _Value(T& v, std::true_type) {
+        v.Checkpoint(*this);
+    }
+
+    template <class T>
+    void _Value(T& v, std::false_type) {
+        static_assert(std::is_trivially_copyable<T>::value, "T needs a Checkpoint member");
+        _Bytes(&v, sizeof(T));
+    }
+
+    template <class T, size_t N>
+    void _Item(T (&a)[N]) {
+        for (size_t i = 0; i < N; ++i) {
+            _Item(a[i]);
+        }
+    }
+
+    // Objects of the slab pools, created with T::New() when loaded
+    template <class T>
+    void _Item(T*& p) {
+        bool fresh;
+        int ref = _Ref(p, _raw_ids, fresh);
+        if (!_loading) {
+            if (fresh) {
+                _Item(*p);
+            }
+        } else if (ref == NULL_REF) {
+            p = NULL;
+        } else if (ref == NEW_REF) {
+            p = T::New();
+            _raw.push_back(p);
+            _Item(*p);
+        } else if (ref < (int)_raw.size()) {
+            p = static_cast<T*>(_raw[ref]);
+        } else {
+            throw _BadRef();
+        }
+    }
+
+    template <class T>
+    void _Item(std::shared_ptr<T>& p) {
+        typedef typename std::remove_const<T>::type U;
+        bool fresh;
+        int ref = _Ref(p.get(), _shared_ids, fresh);
+        if (!_loading) {
+            if (fresh) {
+                _Item(const_cast<U&>(*p));
+            }
+        } else if (ref == NULL_REF) {
+            p.reset();
+        } else if (ref == NEW_REF) {
+            std::shared_ptr<U> obj = std::make_shared<U>();
+            _shared.push_back(obj);
+            _Item(*obj);
+            p = obj;
+        } else if (ref < (int)_shared.size()) {
+            p = std::static_pointer_cast<U>(_shared[ref]);
+        } else {
+            throw _BadRef();
+        }
+    }
+
+    void _Item(std::string& s) {
+        size_t n = _Size(s.size());
+        if (_loading) {
+            s.resize(n);
+        }
+        if (n > 0) {
+            _Bytes(&s[0], n);
+        }
+    }
+
+    template <class A, class B>
+    void _Item(std::pair<A, B>& p) {
+        _Item(p.first);
+        _Item(p.second);
+    }
+
+    void _Item(std::vector<bool>& v) {
+        size_t n = _Size(v.size());
+        if (_loading) {
+            v.resize(n);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            char b = v[i];
+            _Bytes(&b, 1);
+            v[i] = b;
+        }
+    }
+
+    template <class T>
+    void _Item(std::vector<T>& v) {
+        _Sequence(v);
+    }
+
+    template <class T>
+    void _Item(std::deque<T>& v) {
+        _Sequence(v);
+    }
+
+    template <class T>
+    void _Item(std::list<T>& v) {
+        _Sequence(v);
+    }
+
+    template <class C>
+    void _Sequence(C& c) {
+        size_t n = _Size(c.size());
+        if (_loading) {
+            c.clear();
+            c.resize(n);
+        }
+        for (auto& e: c) {
+            _Item(e);
+        }
+    }
+
+    template <class T>
+    void _Item(std::queue<T>& q) {
+        size_t n = _Size(q.size());
+        if (!_loading) {
+            std::queue<T> copy = q;
+            for (; !copy.empty(); copy.pop()) {
+                _Item(copy.front());
+            }
+            return;
+        }
+        q = std::queue<T>();
+        for (size_t i = 0; i < n; ++i) {
+            T e = T();
+            _Item(e);
+            q.push(e);
+        }
+    }
+
+    template <class T, class L>
+    void _Item(std::set<T, L>& s) {
+        _Associative(s);
+    }
+
+    template <class K, class V, class L>
+    void _Item(std::map<K, V, L>& m) {
+        _Associative(m);
+    }
+
+    template <class K, class V, class L>
+    void _Item(std::multimap<K, V, L>& m) {
+        _Associative(m);
+    }
+
+    template <class K, class V>
+    void _Item(std::unordered_map<K, V>& m) {
+        _Associative(m);
+    }
+
+    // Keys are const in the container, but saving doesn't write to them
+    template <class C>
+    void _Associative(C& c) {
+        typedef typename C::value_type E;
+        typedef typename std::remove_const<typename C::key_type>::type K;
+        size_t n = _Size(c.size());
+        if (!_loading) {
+            for (auto& e: c) {
+                _Element(const_cast<E&>(e), static_cast<K*>(NULL));
+            }
+            return;
+        }
+        c.clear();
+        for (size_t i = 0; i < n; ++i) {
+            E e = _Load(static_cast<E*>(NULL), static_cast<K*>(NULL));
+            c.insert(c.end(), e);
+        }
+    }
+
+    template <class K>
+    void _Element(K& key, K*) {
+        _Item(key);
+    }
+
+    template <class K, class V>
+    void _Element(std::pair<const K, V>& kv, K*) {
+        _Item(const_cast<K&>(kv.first));
+        _Item(kv.second);
+    }
+
+    template <class K>
+    K _Load(K*, K*) {
+        K key = K();
+        _Item(key);
+        return key;
+    }
+
+    template <class K, class V>
+    std::pair<const K, V> _Load(std::pair<const K, V>*, K*) {
+        K key = K();
+        V value = V();
+        _Item(key);
+        _Item(value);
+        return std::pair<const K, V>(key, value);
+    }
+
+    template <class U, U a, U c, U m>
+    void _Item(std::linear_congruential_engine<U, a, c, m>& rng) {
+        std::string text;
+        if (!_loading) {
+            std::ostringstream os;
+            os << rng;
+            text = os.str();
+        }
+        _Item(text);
+        if (_loading) {
+            std::istringstream is(text);
+            is >> rng;
+        }
+    }
+
+};
+
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef __TELEMETRY_HPP__
+#define __TELEMETRY_HPP__
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace spatial {
+
+static const char TELEMETRY_MAGIC[8] = {'S', 'P', 'T', 'E', 'L', 'E', 'M', '\0'};
+static const uint32_t TELEMETRY_VERSION = 1;
+// A sample reads every link, router and core, which costs about a cycle of
+// simulation, so sampling more often than this slows runs down by over 1%
+static const int TELEMETRY_MIN_INTERVAL = 100;
+
+// Time series of the chip, sampled every `interval` cycles into ring buffers
+// allocated up front, so that taking a sample never allocates. A column holds
+// `width` values per sample, one per link, router or core. Gauges are sampled
+// as they are, counters as what they grew by since the previous sample. Once
+// `capacity` samples are taken, each new one replaces the oldest.
+class Telemetry {
+public:
+    struct Column {
+        std::string name;
+        int width;
+        bool counter;
+    };
+
+    Telemetry(int interval, int capacity, const std::vector<Column>& columns)
+        : _interval(interval), _capacity(capacity), _columns(columns), _taken(0) {
+        for (const Column& c: _columns) {
+            _readings.push_back(std::vector<uint64_t>(c.width, 0));
+            _previous.push_back(std::vector<uint64_t>(c.width, 0));
+            _rings.push_back(std::vector<uint32_t>((size_t)c.width * capacity, 0));
+        }
+    }
+
+    int interval() const { return _interval; }
+    int columns() const { return _columns.size(); }
+    const Column& column(int c) const { return _columns[c]; }
+    // Samples kept, at most the capacity
+    int samples() const { return (int)std::min<uint64_t>(_taken, _capacity); }
+
+    // Where the current values of column c go before sample() or restart()
+    uint64_t* readings(int c) { return _readings[c].data(); }
+
+    // Takes the readings as the next sample
+    void sample() {
+        size_t slot = _taken % _capacity;
+        for (size_t c = 0; c < _columns.size(); ++c) {
+            const std::vector<uint64_t>& now = _readings[c];
+            std::vector<uint64_t>& previous = _previous[c];
+            uint32_t* row = &_rings[c][slot * _columns[c].width];
+            for (int i = 0; i < _columns[c].width; ++i) {
+                row[i] = _columns[c].counter ? now[i] - previous[i] : now[i];
+            }
+            previous = now;
+        }
+        ++_taken;
+    }
+
+    // Drops the samples and counts counters from the readings on, after the
+    // simulation was rewound or loaded
+    void restart() {
+        _previous = _readings;
+        _taken = 0;
+    }
+
+    // Column c from the oldest sample kept to the latest, samples() x width
+    void series(int c, uint32_t* out) const {
+        size_t width = _columns[c].width;
+        size_t first = _taken > (uint64_t)_capacity ? _taken % _capacity : 0;
+        for (int s = 0; s < samples(); ++s) {
+            size_t slot = (first + s) % _capacity;
+            memcpy(out + s * width, &_rings[c][slot * width], width * sizeof(uint32_t));
+        }
+    }
+
+    // Layout, all in host byte order: magic, version, interval, number of
+    // samples and of columns, then each column: name length and bytes, width,
+    // counter flag and its samples() x width values
+    bool dump(const std::string& file) const {
+        std::ofstream out(file, std::ios::out | std::ios::binary);
+        out.write(TELEMETRY_MAGIC, sizeof(TELEMETRY_MAGIC));
+        _put(out, TELEMETRY_VERSION);
+        _put(out, (uint32_t)_interval);
+        _put(out, (uint32_t)samples());
+        _put(out, (uint32_t)_columns.size());
+        std::vector<uint32_t> values;
+        for (size_t c = 0; c < _columns.size(); ++c) {
+            _put(out, (uint32_t)_columns[c].name.size());
+            out.write(_columns[c].name.data(), _columns[c].name.size());
+            _put(out, (uint32_t)_columns[c].width);
+            _put(out, (uint32_t)_columns[c].counter);
+            values.resize((size_t)samples() * _columns[c].width);
+            series(c, values.data());
+            out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(uint32_t));
+        }
+        out.close();
+        return (bool)out;
+    }
+
+private:
+    int _interval;
+    int _capacity;
+    std::vector<Column> _columns;
+    std::vector<std::vector<uint64_t> > _readings;
+    std::vector<std::vector<uint64_t> > _previous;
+    std::vector<std::vector<uint32_t> > _rings;     // capacity x width per column
+    uint64_t _taken;
+
+    static void _put(std::ofstream& out, uint32_t v) {
+        out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef __WORKER_POOL_HPP__
+#define __WORKER_POOL_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace spatial {
+
+// A persistent pool of worker threads that runs one job per partition and
+// returns only when every partition has finished, i.e. each call to run()
+// is a barrier. The calling thread always takes partition 0, so a pool of
+// size 1 spawns no thread at all.
+//
+// Workers spin for a short while before sleeping, since the simulator hands
+// out a new job every cycle.
+class WorkerPool {
+
+private:
+    static const int SPIN_LIMIT = 4096;
+
+    int _size;
+    std::vector<std::thread> _workers;
+
+    const std::function<void(int)>* _job;
+    std::atomic<unsigned long> _generation;
+    std::atomic<int> _pending;
+    std::atomic<bool> _stop;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::exception_ptr _error;
+
+    void _loop(int partition) {
+        unsigned long seen = 0;
+        while (true) {
+            unsigned long gen = _generation.load(std::memory_order_acquire);
+            for (int spin = 0; gen == seen && spin < SPIN_LIMIT; ++spin) {
+                std::this_thread::yield();
+                gen = _generation.load(std::memory_order_acquire);
+            }
+            if (gen == seen) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait(lock, [this, seen] { return _generation.load() != seen; });
+                gen = _generation.load(std::memory_order_acquire);
+            }
+            seen = gen;
+            if (_stop.load(std::memory_order_acquire)) {
+                return;
+            }
+            _execute(partition);
+            _pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    void _execute(int partition) {
+        try {
+            (*_job)(partition);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_error) {
+                _error = std::current_exception();
+            }
+        }
+    }
+
+public:
+    explicit WorkerPool(int size)
+        : _size(size < 1 ? 1 : size), _job(nullptr), _generation(0), _pending(0), _stop(false)
+    {
+        for (int p = 1; p < _size; ++p) {
+            _workers.push_back(std::thread(&WorkerPool::_loop, this, p));
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop.store(true, std::memory_order_release);
+            _generation.fetch_add(1, std::memory_order_release);
+        }
+        _wake.notify_all();
+        for (std::thread& t: _workers) {
+            t.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    int size() const { return _size; }
+
+    // Run job(p) for every partition p in [0, size()) and wait for all of them.
+    // The first exception thrown by any partition is rethrown here.
+    void run(const std::function<void(int)>& job) {
+        if (_size == 1) {
+            job(0);
+            return;
+        }
+        _job = &job;
+        _pending.store(_size - 1, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _generation.fetch_add(1, std::memory_order_release);
+        }
+        _wake.notify_all();
+
+        _execute(0);
+        while (_pending.load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+        _job = nullptr;
+
+        if (_error) {
+            std::exception_ptr error = _error;
+            _error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    // The half-open range [begin, end) of n items owned by the given partition.
+    void range(int partition, int n, int& begin, int& end) const {
+        begin = (int)((long long)n * partition / _size);
+        end = (int)((long long)n * (partition + 1) / _size);
+    }
+};
+
+};
+
+#endif
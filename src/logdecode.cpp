@@ -0,0 +1,42 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include "event_log.hpp"
+
+// Turns a binary event log back into the text lines the simulator prints
+// into log_file when no event_log is given.
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " event_log" << std::endl;
+        return -1;
+    }
+
+    std::ifstream in(argv[1], std::ios::in | std::ios::binary);
+    if (!in) {
+        std::cerr << "Can not open the event log " << argv[1] << std::endl;
+        return -1;
+    }
+
+    spatial::LogFileHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || memcmp(header.magic, spatial::LOG_MAGIC, sizeof(spatial::LOG_MAGIC)) != 0) {
+        std::cerr << argv[1] << " is not an event log" << std::endl;
+        return -1;
+    }
+    if (header.version != spatial::LOG_VERSION || header.record_size != sizeof(spatial::LogRecord)) {
+        std::cerr << "Unsupported event log version " << header.version << std::endl;
+        return -1;
+    }
+
+    spatial::LogDecoder decoder;
+    spatial::LogRecord r;
+    while (in.read(reinterpret_cast<char*>(&r), sizeof(r))) {
+        decoder.Feed(r, std::cout);
+    }
+    if (decoder.truncated()) {
+        std::cerr << "The event log is truncated" << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -1,4 +1,5 @@
 
+#include <climits>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -6,6 +7,7 @@
 #include <string>
 #include <string.h>
 #include "noc.hpp"
+#include "analytic_noc.hpp"
 
 // Booksim:main.cpp dependency
 #include "booksim.hpp"
@@ -19,24 +21,22 @@
 #include "power_module.hpp"
 #include "globals.hpp"
 #include "flit.hpp"
+#include "credit.hpp"
 #include "router.hpp"
 #include "mc_router.hpp"
 
-/* printing activity factor*/
-bool gPrintActivity;
-int gK; //radix
-int gN; //dimension
-int gC; //concentration
-int gNodes;
-//generate nocviewer trace
-bool gTrace;
-ostream * gWatchOut;
-
-// Well ... old troublesomes from booksim2
-TrafficManager* trafficManager = NULL;
+spatial::NoC* spatial::NoC::New(BookSimConfig config, PCNInterfaceSet send_queues_, PCNInterfaceSet receive_queues_, LogSink* log) {
+    string model = config.GetStr("noc_model");
+    if (model == "booksim") {
+        return new BookSimNoC(config, send_queues_, receive_queues_, log);
+    } else if (model == "analytic") {
+        return new AnalyticNoC(config, send_queues_, receive_queues_, log);
+    }
+    throw "Unknown noc_model, it is either booksim or analytic !!";
+}
 
 
-spatial::NoC::NoC(BookSimConfig config, PCNInterfaceSet send_queues_, PCNInterfaceSet receive_queues_) {
+spatial::BookSimNoC::BookSimNoC(BookSimConfig config, PCNInterfaceSet send_queues_, PCNInterfaceSet receive_queues_, LogSink* log) {
     /*initialize routing, traffic, injection functions
    */
 
@@ -46,14 +46,7 @@ spatial::NoC::NoC(BookSimConfig config, PCNInterfaceSet send_queues_, PCNInterfa
     gPrintActivity = (config.GetInt("print_activity") > 0);
     gTrace = (config.GetInt("viewer_trace") > 0);
     
-    string watch_out_file = config.GetStr( "watch_out" );
-    if(watch_out_file == "") {
-        gWatchOut = NULL;
-    } else if(watch_out_file == "-") {
-        gWatchOut = &cout;
-    } else {
-        gWatchOut = new ofstream(watch_out_file.c_str());
-    }
+    spatial::SimContext::Current()->SetWatchOut(config.GetStr("watch_out"));
 
     // Setup Nets
     vector<Network *> net;
@@ -72,26 +65,91 @@ spatial::NoC::NoC(BookSimConfig config, PCNInterfaceSet send_queues_, PCNInterfa
         net[i] = Network::New( config, name.str() );
     }
 
+    int noc_threads = ParallelNoCThreads(config);
+    for (int i = 0; i < subnets; ++i) {
+        net[i]->SetThreads(noc_threads);
+    }
+
     _traffic_manager = TrafficManager::New(config, net);
+    _traffic_manager->SetEventLog(log);
     _traffic_manager->SetupSim(send_queues_, receive_queues_);
+    _send_queues = send_queues_;
     trafficManager = _traffic_manager;
+    _networks = net;
 }
 
 
-void spatial::NoC::step(clock_t clock) {
+// The traffic manager goes first, it drains the networks. Routers would dump
+// their activity monitors on destruction, which isn't part of our logs.
+spatial::BookSimNoC::~BookSimNoC() {
+    gPrintActivity = false;
+    delete _traffic_manager;
+    for (Network* net: _networks) {
+        delete net;
+    }
+}
+
+
+// Routers are evaluated in parallel only when it's bit-identical to the serial 
+// run: flit traces would interleave, and randomized routing functions and
+// allocators draw from the shared booksim RNG in evaluation order.
+int spatial::BookSimNoC::ParallelNoCThreads(const BookSimConfig& config) {
+    int threads = config.GetInt("noc_threads");
+    if (threads <= 1) {
+        return 1;
+    }
+
+    string reason = "";
+    string routing = config.GetStr("routing_function");
+    if (gWatchOut || gTrace) {
+        reason = "watch_out or viewer_trace is set";
+    } else if (config.GetStr("router") != "mc") {
+        reason = "router is not mc";
+    } else if (routing != "src_routing" && routing != "dim_order" && routing != "dor") {
+        reason = "routing function " + routing + " is randomized";
+    } else if (config.GetStr("vc_allocator") == "pim" || config.GetStr("sw_allocator") == "pim") {
+        reason = "pim allocators are randomized";
+    }
+
+    if (reason != "") {
+        std::cerr << "WARNING: noc_threads is ignored because " << reason 
+                  << ", the network is evaluated serially." << std::endl;
+        return 1;
+    }
+    return threads;
+}
+
+
+void spatial::BookSimNoC::step(clock_t /* clock */) {
     _traffic_manager->_Step();
+}
+
+// Skip `cycles` idle cycles starting from `clock`, which must leave the network
+// exactly as stepping through them would
+void spatial::BookSimNoC::skip(clock_t /* clock */, int cycles) {
+    _traffic_manager->_Skip(cycles);
+}
 
-    // Frequently clean the garbage flits
-    if (clock % 20000 == 0) {
-        Flit::GC();
+// Nothing happens in the network until something is sent into it once it is
+// drained and idle
+unsigned int spatial::BookSimNoC::next_event(clock_t clock) {
+    if (!traffic_drained() || !idle()) {
+        return clock;
     }
+    return UINT_MAX;
 }
 
-void spatial::NoC::DisplayStats(std::ostream & os) {
+void spatial::BookSimNoC::DisplayStats(std::ostream & os) {
     _traffic_manager->_DisplayRemaining(os);
+    DisplayPoolStats(os);
 }
 
-std::vector<double> spatial::NoC::router_conflict_factors() {
+void spatial::BookSimNoC::DisplayPoolStats(std::ostream & os) {
+    Flit::DisplayPoolStats(os);
+    Credit::DisplayPoolStats(os);
+}
+
+std::vector<double> spatial::BookSimNoC::router_conflict_factors(bool window) {
 
     // We assume only one net
     vector<vector<Router*> > routers = dynamic_cast<SpatialTrafficManager*>(_traffic_manager)->getRouters();
@@ -100,7 +158,92 @@ std::vector<double> spatial::NoC::router_conflict_factors() {
 
     std::vector<double> ret(first_net_routers.size());
     for (int i = 0; i < first_net_routers.size(); ++i) {
-        ret[i] = dynamic_cast<MCRouter*>(first_net_routers[i])->ConflictFactor();
+        MCRouter* router = dynamic_cast<MCRouter*>(first_net_routers[i]);
+        ret[i] = router->ConflictFactor(window);
+        if (window) {
+            router->StartConflictWindow();
+        }
     }
     return ret;
+}
+
+int spatial::BookSimNoC::num_links() {
+    int links = 0;
+    for (Network* net: _networks) {
+        links += net->GetChannels().size();
+    }
+    return links;
+}
+
+int spatial::BookSimNoC::num_routers() {
+    int routers = 0;
+    for (Network* net: _networks) {
+        routers += net->GetRouters().size();
+    }
+    return routers;
+}
+
+void spatial::BookSimNoC::read_link_flits(uint64_t* flits) {
+    for (Network* net: _networks) {
+        for (FlitChannel* chan: net->GetChannels()) {
+            uint64_t sent = 0;
+            for (int active: chan->GetActivity()) {
+                sent += active;
+            }
+            *flits++ = sent;
+        }
+    }
+}
+
+void spatial::BookSimNoC::read_router_occupancy(uint64_t* flits) {
+    for (Network* net: _networks) {
+        for (Router* r: net->GetRouters()) {
+            uint64_t buffered = 0;
+            for (int i = 0; i < r->NumInputs(); ++i) {
+                buffered += r->GetBufferOccupancy(i);
+            }
+            *flits++ = buffered;
+        }
+    }
+}
+
+void spatial::BookSimNoC::read_waiting_flits(uint64_t* flits) {
+    for (int n = 0; n < _traffic_manager->NumNodes(); ++n) {
+        flits[n] = QueuedFlits::of(*(*_send_queues)[n]) + _traffic_manager->WaitingFlits(n);
+    }
+}
+
+// The flits sent over any channel, injection and ejection ones included
+unsigned long spatial::BookSimNoC::progress() {
+    unsigned long sent = 0;
+    for (Network* net: _networks) {
+        for (const std::vector<FlitChannel*>* chans: {&net->GetInject(), &net->GetChannels(), &net->GetEject()}) {
+            for (FlitChannel* chan: *chans) {
+                for (int active: chan->GetActivity()) {
+                    sent += active;
+                }
+            }
+        }
+    }
+    return sent;
+}
+
+// Row-major by router, returns the number of output ports of each
+int spatial::BookSimNoC::router_port_conflicts(std::vector<unsigned long>& requests, std::vector<unsigned long>& grants) {
+    vector<vector<Router*> > routers = dynamic_cast<SpatialTrafficManager*>(_traffic_manager)->getRouters();
+    assert(routers.size() == 1);
+    vector<Router*> first_net_routers = routers.front();
+
+    int ports = 0;
+    requests.clear();
+    grants.clear();
+    for (Router* r: first_net_routers) {
+        std::vector<unsigned long> router_requests, router_grants;
+        dynamic_cast<MCRouter*>(r)->PortConflicts(router_requests, router_grants);
+        assert(ports == 0 || ports == (int)router_requests.size());
+        ports = router_requests.size();
+        requests.insert(requests.end(), router_requests.begin(), router_requests.end());
+        grants.insert(grants.end(), router_grants.begin(), router_grants.end());
+    }
+    return ports;
 }
\ No newline at end of file
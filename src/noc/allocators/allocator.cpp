@@ -54,6 +54,8 @@ Allocator::Allocator(Module *parent, const string &name,
 {
   _inmatch.resize(_inputs, -1);
   _outmatch.resize(_outputs, -1);
+  _requests.resize(_outputs, 0);
+  _grants.resize(_outputs, 0);
 }
 
 void Allocator::Clear()
@@ -76,6 +78,16 @@ void Allocator::AddRequest(int in, int out, int label, int in_pri,
   _dirty = true;
 }
 
+void Allocator::CountGrants()
+{
+  for (int out = 0; out < _outputs; ++out)
+  {
+    _requests[out] += NumOutputRequests(out);
+    if (_outmatch[out] >= 0)
+      ++_grants[out];
+  }
+}
+
 int Allocator::OutputAssigned(int in) const
 {
   assert((in >= 0) && (in < _inputs));
@@ -90,6 +102,13 @@ int Allocator::InputAssigned(int out) const
   return _outmatch[out];
 }
 
+void Allocator::Checkpoint(spatial::StateArchive &ar)
+{
+  ar.Check(_inputs, "the number of allocator inputs");
+  ar.Check(_outputs, "the number of allocator outputs");
+  ar & _dirty & _inmatch & _outmatch & _requests & _grants;
+}
+
 void Allocator::PrintGrants(ostream *os) const
 {
   if (!os)
@@ -232,6 +251,12 @@ int DenseAllocator::NumOutputRequests(int out) const
   return result;
 }
 
+void DenseAllocator::Checkpoint(spatial::StateArchive &ar)
+{
+  Allocator::Checkpoint(ar);
+  ar & _request;
+}
+
 void DenseAllocator::PrintRequests(ostream *os) const
 {
   if (!os)
@@ -422,6 +447,23 @@ int SparseAllocator::NumOutputRequests(int out) const
   return _out_occ.count(out);
 }
 
+// Only the outputs requested this round
+void SparseAllocator::CountGrants()
+{
+  for (int out : _out_occ)
+  {
+    _requests[out] += _out_req[out].size();
+    if (_outmatch[out] >= 0)
+      ++_grants[out];
+  }
+}
+
+void SparseAllocator::Checkpoint(spatial::StateArchive &ar)
+{
+  Allocator::Checkpoint(ar);
+  ar & _in_occ & _out_occ & _in_req & _out_req;
+}
+
 void SparseAllocator::PrintRequests(ostream *os) const
 {
   map<int, sRequest>::const_iterator iter;
@@ -535,7 +577,7 @@ Allocator *Allocator::NewAllocator(Module *parent, const string &name,
   }
   else if (alloc_name == "mc")
   {
-    a = new MultiOutputSparseAllocator(parent, name, inputs, outputs);
+    a = new MultiOutputAllocator(parent, name, inputs, outputs);
   }
 
   //==================================================
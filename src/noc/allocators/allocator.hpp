@@ -35,6 +35,7 @@
 
 #include "module.hpp"
 #include "config_utils.hpp"
+#include "state_archive.hpp"
 
 class Allocator : public Module {
 protected:
@@ -46,6 +47,10 @@ protected:
   vector<int> _inmatch;
   vector<int> _outmatch;
 
+  // Per output: requests made to it and the ones granted, since built
+  vector<unsigned long> _requests;
+  vector<unsigned long> _grants;
+
 public:
 
   struct sRequest {
@@ -69,6 +74,12 @@ public:
   
   virtual void Allocate( ) = 0;
 
+  // Counts the requests of this round and the grants Allocate() made
+  virtual void CountGrants( );
+  unsigned long Requests( int out ) const { return _requests[out]; }
+  unsigned long Grants( int out ) const { return _grants[out]; }
+  int NumOutputs( ) const { return _outputs; }
+
   int OutputAssigned( int in ) const;
   int InputAssigned( int out ) const;
 
@@ -81,6 +92,8 @@ public:
   virtual void PrintRequests( ostream * os = NULL ) const = 0;
   void PrintGrants( ostream * os = NULL ) const;
 
+  virtual void Checkpoint( spatial::StateArchive & ar );
+
   static Allocator *NewAllocator( Module *parent, const string& name,
 				  const string &alloc_type, 
 				  int inputs, int outputs, 
@@ -117,6 +130,8 @@ public:
 
   void PrintRequests( ostream * os = NULL ) const;
 
+  virtual void Checkpoint( spatial::StateArchive & ar );
+
 };
 
 //==================================================
@@ -151,8 +166,12 @@ public:
   int NumOutputRequests( int out ) const;
   int NumInputRequests( int in ) const;
 
+  virtual void CountGrants( );
+
   void PrintRequests( ostream * os = NULL ) const;
 
+  virtual void Checkpoint( spatial::StateArchive & ar );
+
 };
 
 
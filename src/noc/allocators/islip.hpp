@@ -43,6 +43,11 @@ public:
 		int inputs, int outputs, int iters );
 
   void Allocate( );
+
+  void Checkpoint( spatial::StateArchive & ar ) {
+    SparseAllocator::Checkpoint(ar);
+    ar & _gptrs & _aptrs;
+  }
 };
 
 #endif 
@@ -44,6 +44,11 @@ public:
        int inputs, int outputs );
 
   void Allocate( );
+
+  void Checkpoint( spatial::StateArchive & ar ) {
+    DenseAllocator::Checkpoint(ar);
+    ar & _rptr & _gptr;
+  }
 };
 
 #endif
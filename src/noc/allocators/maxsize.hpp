@@ -46,6 +46,11 @@ public:
   ~MaxSizeMatch( );
   
   void Allocate( );
+
+  void Checkpoint( spatial::StateArchive & ar ) {
+    DenseAllocator::Checkpoint(ar);
+    ar & _prio;
+  }
 };
 
 #endif 
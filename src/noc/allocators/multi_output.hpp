@@ -1,112 +1,202 @@
-
 #ifndef __MULTI_OUTPUT_HPP__
 #define __MULTI_OUTPUT_HPP__
 
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 
 #include "allocator.hpp"
 #include "wavefront.hpp"
 
 //==================================================
-// A multi-output sparse allocator allocate as much
+// A multi-output allocator allocate as much
 // as possible for the selected input_and_vc
 //==================================================
 
 
-class MultiOutputSparseAllocator : public SparseAllocator {
+class MultiOutputAllocator : public Allocator {
 
 protected:
-  vector<map<int, int>> _multi_inmatch;
-  vector<map<int, int>> _multi_outmatch;
+  // Requests and grants are bitmasks of one word per 64 outputs (inputs), and
+  // the requests themselves a matrix allocated once, so that a round only ANDs
+  // and ORs words and never touches the heap. A request exists iff its bit is
+  // set in _in_mask, the matrix entries are left over otherwise.
+  const int _out_words;
+  const int _in_words;
+
+  vector<sRequest> _request;      // _inputs x _outputs
+  vector<uint64_t> _in_mask;      // _inputs x _out_words, the outputs each input requests
+  vector<uint64_t> _in_occ;       // inputs with requests
+  vector<uint64_t> _out_occ;      // outputs with requests
+  vector<uint64_t> _out_taken;    // outputs granted in this round
+  vector<uint64_t> _in_granted;   // inputs granted in this round
+
+  static bool _Bit( const vector<uint64_t>& mask, int i ) {
+    return (mask[i / 64] >> (i % 64)) & 1;
+  }
+
+  // Calls f(i) for every bit i set in words [begin, begin + n), in ascending order
+  template <class F>
+  static void _ForEachBit( const uint64_t* begin, int n, F f ) {
+    for (int w = 0; w < n; ++w) {
+      for (uint64_t bits = begin[w]; bits != 0; bits &= bits - 1) {
+        f(w * 64 + __builtin_ctzll(bits));
+      }
+    }
+  }
+
+  const uint64_t* _InMask( int in ) const {
+    return &_in_mask[in * _out_words];
+  }
 
 public:
-  vector<int> MultiOutputAssigned( int in ) {
+  bool MultiOutputGranted( int in ) const {
     assert(in >= 0 && in < _inputs);
-    assert(_in_occ.count(in) > 0 && _multi_inmatch[in].size() > 0);
-    // return _multi_inmatch[in];
-    vector<int> ret;
-    for (auto it: _multi_inmatch[in]) {
-      ret.push_back(it.second);
+    return _Bit(_in_granted, in);
+  }
+
+  // Writes the outputs granted to input in into outs, in ascending order, and
+  // returns how many there are
+  int MultiOutputAssigned( int in, int *outs ) const {
+    assert(MultiOutputGranted(in));
+    int n = 0;
+    _ForEachBit(_InMask(in), _out_words, [outs, &n](int out) { outs[n++] = out; });
+    return n;
+  }
+
+  int ReadRequest( int in, int out ) const override {
+    sRequest r;
+    return ReadRequest(r, in, out) ? r.label : -1;
+  }
+
+  bool ReadRequest( sRequest &req, int in, int out ) const override {
+    assert((in >= 0) && (in < _inputs));
+    assert((out >= 0) && (out < _outputs));
+    if (!((_InMask(in)[out / 64] >> (out % 64)) & 1)) {
+      return false;
     }
-    return ret;
+    req = _request[in * _outputs + out];
+    return true;
   }
 
-  virtual void Allocate( ) override {
-    // Initialize the outputs
-    for (int in: _in_occ) {
-      for (auto it = _in_req[in].begin(); it != _in_req[in].end(); ++it) {
-        int out = it->first;
-        _multi_inmatch[in][out] = -1;
-        _multi_outmatch[out][in] = -1;
-      }
+  // A repeated request replaces the previous one
+  void AddRequest( int in, int out, int label = 1,
+                   int in_pri = 0, int out_pri = 0 ) override {
+    Allocator::AddRequest(in, out, label, in_pri, out_pri);
+    sRequest& req = _request[in * _outputs + out];
+    req.port = out;
+    req.label = label;
+    req.in_pri = in_pri;
+    req.out_pri = out_pri;
+    _in_mask[in * _out_words + out / 64] |= 1ULL << (out % 64);
+    _in_occ[in / 64] |= 1ULL << (in % 64);
+    _out_occ[out / 64] |= 1ULL << (out % 64);
+  }
+
+  void RemoveRequest( int in, int out, int label = 1 ) override {
+    assert(ReadRequest(in, out) == label);
+    _in_mask[in * _out_words + out / 64] &= ~(1ULL << (out % 64));
+    if (!InputHasRequests(in)) {
+      _in_occ[in / 64] &= ~(1ULL << (in % 64));
+    }
+    if (NumOutputRequests(out) == 0) {
+      _out_occ[out / 64] &= ~(1ULL << (out % 64));
     }
+  }
 
-    // Allocate outputs based on the order of _in_occ set 
-    for (int in: _in_occ) {
-      bool all_grant_succeed = true;
-      for (auto it = _in_req[in].begin(); it != _in_req[in].end(); ++it) {
-        int out = it->first;
-        for (auto check_iter = _multi_outmatch[out].begin(); check_iter != _multi_outmatch[out].end(); ++check_iter) {
-          all_grant_succeed &= check_iter->second == -1;
-        }
+  bool InputHasRequests( int in ) const override {
+    const uint64_t* mask = _InMask(in);
+    return any_of(mask, mask + _out_words, [](uint64_t w) { return w != 0; });
+  }
+
+  bool OutputHasRequests( int out ) const override {
+    return _Bit(_out_occ, out);
+  }
+
+  int NumInputRequests( int in ) const override {
+    int n = 0;
+    const uint64_t* mask = _InMask(in);
+    for (int w = 0; w < _out_words; ++w) {
+      n += __builtin_popcountll(mask[w]);
+    }
+    return n;
+  }
+
+  int NumOutputRequests( int out ) const override {
+    int n = 0;
+    for (int in = 0; in < _inputs; ++in) {
+      n += (_InMask(in)[out / 64] >> (out % 64)) & 1;
+    }
+    return n;
+  }
+
+  // Inputs are served in ascending order, each granted all the outputs it
+  // requests if none of them is granted yet, or none of them
+  virtual void Allocate( ) override {
+    _ForEachBit(_in_occ.data(), _in_words, [this](int in) {
+      const uint64_t* mask = _InMask(in);
+      uint64_t conflict = 0;
+      for (int w = 0; w < _out_words; ++w) {
+        conflict |= mask[w] & _out_taken[w];
       }
-      if (all_grant_succeed) {
-        for (auto it = _in_req[in].begin(); it != _in_req[in].end(); ++it) {
-          int out = it->first;
-          _multi_inmatch[in][out] = out;
-          _multi_outmatch[out][in] = out;
+      if (!conflict) {
+        for (int w = 0; w < _out_words; ++w) {
+          _out_taken[w] |= mask[w];
         }
+        _in_granted[in / 64] |= 1ULL << (in % 64);
       }
-    }
+    });
+  }
+
+  // A granted output went to exactly one of the inputs requesting it
+  virtual void CountGrants( ) override {
+    _ForEachBit(_in_occ.data(), _in_words, [this](int in) {
+      bool granted = MultiOutputGranted(in);
+      _ForEachBit(_InMask(in), _out_words, [this, granted](int out) {
+        ++_requests[out];
+        _grants[out] += granted;
+      });
+    });
   }
 
   virtual void Clear( ) override {
-    SparseAllocator::Clear();
-    for (auto it = _multi_inmatch.begin(); it != _multi_inmatch.end(); ++it) {
-      it->clear();
-    }
-    for (auto it = _multi_outmatch.begin(); it != _multi_outmatch.end(); ++it) {
-      it->clear();
-    }
+    _ForEachBit(_in_occ.data(), _in_words, [this](int in) {
+      fill(&_in_mask[in * _out_words], &_in_mask[(in + 1) * _out_words], 0);
+    });
+    fill(_in_occ.begin(), _in_occ.end(), 0);
+    fill(_out_occ.begin(), _out_occ.end(), 0);
+    fill(_out_taken.begin(), _out_taken.end(), 0);
+    fill(_in_granted.begin(), _in_granted.end(), 0);
+    Allocator::Clear();
   }
 
 
-  void PrintRequests(ostream *os) const override
+  void PrintRequests( ostream *os = NULL ) const override
   {
-    map<int, sRequest>::const_iterator iter;
-
     if (!os)
       os = &cout;
 
     *os << "Input requests = [ ";
-    for (int input = 0; input < _inputs; ++input)
-    {
-      if (!_in_req[input].empty())
-      {
-        *os << input << " -> [ ";
-        for (iter = _in_req[input].begin();
-            iter != _in_req[input].end(); iter++)
-        {
-          *os << iter->second.port << "@" << iter->second.label << "@" << iter->second.in_pri << " ";
-        }
-        *os << "]  ";
-      }
-    }
+    _ForEachBit(_in_occ.data(), _in_words, [this, os](int input) {
+      *os << input << " -> [ ";
+      _ForEachBit(_InMask(input), _out_words, [this, os, input](int output) {
+        const sRequest& req = _request[input * _outputs + output];
+        *os << output << "@" << req.label << "@" << req.in_pri << " ";
+      });
+      *os << "]  ";
+    });
     *os << "], output requests = [ ";
-    for (int output = 0; output < _outputs; ++output)
-    {
-      if (!_out_req[output].empty())
-      {
-        *os << output << " -> ";
-        *os << "[ ";
-        for (iter = _out_req[output].begin();
-            iter != _out_req[output].end(); iter++)
-        {
-          *os << iter->second.port << "@" << iter->second.label << "@" << iter->second.out_pri << " ";
+    _ForEachBit(_out_occ.data(), _out_words, [this, os](int output) {
+      *os << output << " -> ";
+      *os << "[ ";
+      _ForEachBit(_in_occ.data(), _in_words, [this, os, output](int input) {
+        if ((_InMask(input)[output / 64] >> (output % 64)) & 1) {
+          const sRequest& req = _request[input * _outputs + output];
+          *os << input << "@" << req.label << "@" << req.out_pri << " ";
         }
-        *os << "]  ";
-      }
-    }
+      });
+      *os << "]  ";
+    });
     *os << "]." << endl;
   }
 
@@ -115,40 +205,45 @@ public:
       os = &cout;
 
     *os << "Input grants = [ ";
-    for (int input = 0; input < _inputs; ++input)
-    {
-      if (_multi_inmatch[input].size() > 0)
-      {
-        *os << input << " -> [ ";
-        for (auto match: _multi_inmatch[input]) {
-          *os << match.first << "-" << match.second << " ";
-        }
-        *os << "] ";
-      }
-    }
+    _ForEachBit(_in_occ.data(), _in_words, [this, os](int input) {
+      bool granted = MultiOutputGranted(input);
+      *os << input << " -> [ ";
+      _ForEachBit(_InMask(input), _out_words, [os, granted](int output) {
+        *os << output << "-" << (granted ? output : -1) << " ";
+      });
+      *os << "] ";
+    });
     *os << "], output grants = [ ";
-    for (int output = 0; output < _outputs; ++output)
-    {
-      if (_multi_outmatch[output].size() > 0)
-      {
-        *os << output << " -> [ ";
-        for (auto match: _multi_outmatch[output]) {
-          *os << match.first << "-" << match.second << " ";
+    _ForEachBit(_out_occ.data(), _out_words, [this, os](int output) {
+      *os << output << " -> [ ";
+      _ForEachBit(_in_occ.data(), _in_words, [this, os, output](int input) {
+        if ((_InMask(input)[output / 64] >> (output % 64)) & 1) {
+          *os << input << "-" << (MultiOutputGranted(input) ? output : -1) << " ";
         }
-        *os << "] ";
-      }
-    }
+      });
+      *os << "] ";
+    });
     *os << "]." << endl;
   }
 
-  MultiOutputSparseAllocator( Module *parent, const string& name, int inputs, int outputs )
-    : SparseAllocator(parent, name, inputs, outputs)
-  { 
-    _multi_inmatch.resize(inputs);
-    _multi_outmatch.resize(outputs);    
+  virtual void Checkpoint( spatial::StateArchive & ar ) override {
+    Allocator::Checkpoint(ar);
+    ar & _request & _in_mask & _in_occ & _out_occ & _out_taken & _in_granted;
+  }
+
+  MultiOutputAllocator( Module *parent, const string& name, int inputs, int outputs )
+    : Allocator(parent, name, inputs, outputs),
+      _out_words((outputs + 63) / 64), _in_words((inputs + 63) / 64)
+  {
+    _request.resize(inputs * outputs);
+    _in_mask.resize(inputs * _out_words, 0);
+    _in_occ.resize(_in_words, 0);
+    _out_occ.resize(_out_words, 0);
+    _out_taken.resize(_out_words, 0);
+    _in_granted.resize(_in_words, 0);
   };
 
 };
 
 
-#endif
\ No newline at end of file
+#endif
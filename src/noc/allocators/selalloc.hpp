@@ -50,6 +50,11 @@ public:
 
   virtual void PrintRequests( ostream * os = NULL ) const;
 
+  void Checkpoint( spatial::StateArchive & ar ) {
+    SparseAllocator::Checkpoint(ar);
+    ar & _aptrs & _gptrs & _outmask;
+  }
+
 };
 
 #endif 
@@ -84,3 +84,13 @@ void SeparableAllocator::Clear() {
   }
   SparseAllocator::Clear();
 }
+
+void SeparableAllocator::Checkpoint( spatial::StateArchive & ar ) {
+  SparseAllocator::Checkpoint(ar);
+  for ( int i = 0 ; i < _inputs ; i++ ) {
+    _input_arb[i]->Checkpoint(ar);
+  }
+  for ( int o = 0; o < _outputs; o++ ) {
+    _output_arb[o]->Checkpoint(ar);
+  }
+}
@@ -56,6 +56,8 @@ public:
 
   virtual void Clear() ;
 
+  virtual void Checkpoint( spatial::StateArchive & ar ) ;
+
 } ;
 
 #endif
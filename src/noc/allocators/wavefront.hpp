@@ -52,6 +52,11 @@ public:
   virtual void AddRequest( int in, int out, int label = 1, 
 			   int in_pri = 0, int out_pri = 0 );
   virtual void Allocate( );
+
+  virtual void Checkpoint( spatial::StateArchive & ar ) {
+    DenseAllocator::Checkpoint(ar);
+    ar & _last_in & _last_out & _priorities & _pri & _num_requests;
+  }
 };
 
 #endif
@@ -37,6 +37,7 @@
 #include <vector>
 
 #include "module.hpp"
+#include "state_archive.hpp"
 
 class Arbiter : public Module {
 
@@ -79,6 +80,11 @@ public:
     return _selected;
   }
 
+  virtual void Checkpoint( spatial::StateArchive & ar ) {
+    ar.Check(_size, "the size of an arbiter");
+    ar & _request & _selected & _highest_pri & _best_input & _num_reqs;
+  }
+
   static Arbiter *NewArbiter( Module *parent, const string &name,
 			      const string &arb_type, int size );
 } ;
@@ -66,6 +66,11 @@ public:
 
   virtual void Clear();
 
+  virtual void Checkpoint( spatial::StateArchive & ar ) {
+    Arbiter::Checkpoint(ar);
+    ar & _matrix & _last_req;
+  }
+
 } ;
 
 #endif
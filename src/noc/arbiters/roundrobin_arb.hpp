@@ -60,6 +60,11 @@ public:
 
   virtual void Clear();
 
+  virtual void Checkpoint( spatial::StateArchive & ar ) {
+    Arbiter::Checkpoint(ar);
+    ar & _pointer;
+  }
+
   static inline bool Supersedes(int input1, int pri1, int input2, int pri2, int offset, int size)
   {
     // in a round-robin scheme with the given number of positions and current 
@@ -66,6 +66,15 @@ public:
 
   virtual void Clear();
 
+  virtual void Checkpoint( spatial::StateArchive & ar ) {
+    Arbiter::Checkpoint(ar);
+    for ( size_t i = 0; i < _group_arbiters.size(); ++i ) {
+      _group_arbiters[i]->Checkpoint(ar);
+    }
+    _global_arbiter->Checkpoint(ar);
+    ar & _group_reqs;
+  }
+
 } ;
 
 #endif
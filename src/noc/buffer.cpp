@@ -78,6 +78,19 @@ void Buffer::AddFlit(int vc, Flit *f)
 #endif
 }
 
+void Buffer::Checkpoint(spatial::StateArchive &ar)
+{
+  ar.Check((int)_vc.size(), "the number of VCs");
+  ar & _occupancy;
+  for (vector<VC *>::iterator i = _vc.begin(); i != _vc.end(); ++i)
+  {
+    (*i)->Checkpoint(ar);
+  }
+#ifdef TRACK_BUFFERS
+  ar & _class_occupancy;
+#endif
+}
+
 void Buffer::Display(ostream &os) const
 {
   for (vector<VC *>::const_iterator i = _vc.begin(); i != _vc.end(); ++i)
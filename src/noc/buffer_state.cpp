@@ -663,6 +663,16 @@ void BufferState::TakeBuffer( int vc, int tag )
   _buffer_policy->TakeBuffer(vc);
 }
 
+void BufferState::Checkpoint( spatial::StateArchive & ar )
+{
+  ar.Check(_vcs, "the number of VCs");
+  ar & _occupancy & _vc_occupancy & _in_use_by & _tail_sent & _last_id & _last_pid;
+#ifdef TRACK_BUFFERS
+  ar & _outstanding_classes & _class_occupancy;
+#endif
+  _buffer_policy->Checkpoint(ar);
+}
+
 void BufferState::Display( ostream & os ) const
 {
   os << FullName() << " :" << endl;
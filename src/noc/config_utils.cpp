@@ -36,10 +36,15 @@
 #include <sstream>
 #include <fstream>
 #include <cstdlib>
+#include <mutex>
 
 #include "config_utils.hpp"
 
-Configuration *Configuration::theConfig = 0;
+thread_local Configuration *Configuration::theConfig = 0;
+
+// The generated parser keeps its state in globals, so configurations are
+// parsed one at a time
+static std::mutex parser_lock;
 
 Configuration::Configuration()
 {
@@ -152,7 +157,10 @@ void Configuration::ParseFile(string const & filename)
     exit(-1);
   }
 
-  yyparse();
+  {
+    std::lock_guard<std::mutex> guard(parser_lock);
+    yyparse();
+  }
 
   fclose(_config_file);
   _config_file = 0;
@@ -161,7 +169,10 @@ void Configuration::ParseFile(string const & filename)
 void Configuration::ParseString(string const & str)
 {
   _config_string = str + ';';
-  yyparse();
+  {
+    std::lock_guard<std::mutex> guard(parser_lock);
+    yyparse();
+  }
   _config_string = "";
 }
 
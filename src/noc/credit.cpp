@@ -32,9 +32,13 @@
 
 #include "booksim.hpp"
 #include "credit.hpp"
+#include "globals.hpp"
+#include "slab_pool.hpp"
 
-stack<Credit *> Credit::_all;
-stack<Credit *> Credit::_free;
+// Every simulation recycles its own credits
+static SlabPool<Credit> & CreditPool() {
+  return spatial::SimContext::Current()->credit_pool;
+}
 
 Credit::Credit()
 {
@@ -50,30 +54,22 @@ void Credit::Reset()
 }
 
 Credit * Credit::New() {
-  Credit * c;
-  if(_free.empty()) {
-    c = new Credit();
-    _all.push(c);
-  } else {
-    c = _free.top();
-    c->Reset();
-    _free.pop();
-  }
-  return c;
+  return CreditPool().New();
 }
 
 void Credit::Free() {
-  _free.push(this);
+  CreditPool().Free(this);
 }
 
 void Credit::FreeAll() {
-  while(!_all.empty()) {
-    delete _all.top();
-    _all.pop();
-  }
+  CreditPool().Clear();
 }
 
 
 int Credit::OutStanding(){
-  return _all.size()-_free.size();
+  return CreditPool().Outstanding();
+}
+
+void Credit::DisplayPoolStats( ostream & os ) {
+  CreditPool().DisplayStats("Credit", os);
 }
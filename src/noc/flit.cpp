@@ -37,9 +37,12 @@
 #include "booksim.hpp"
 #include "globals.hpp"
 #include "flit.hpp"
+#include "slab_pool.hpp"
 
-stack<Flit *> Flit::_all;
-stack<Flit *> Flit::_free;
+// Every simulation recycles its own flits
+static SlabPool<FocusFlit> & FlitPool() {
+  return spatial::SimContext::Current()->flit_pool;
+}
 
 ostream& operator<<( ostream& os, const Flit& f )
 {
@@ -83,148 +86,136 @@ void Flit::Reset()
   data = 0;
 }
 
+void Flit::Checkpoint( spatial::StateArchive & ar )
+{
+  ar & type & vc & cl & head & tail & ctime & itime & atime & id & pid 
+     & record & src & dest & pri & hops & watch & subnetwork & intm & ph
+     & la_route_set;
+}
+
 Flit *Flit::New() {
-  return new FocusFlit();
-}
-
-// Flit * Flit::New() {
-//   Flit * f;
-//   if(_free.empty()) {
-//     f = new FocusFlit();
-//     // f = new Flit;
-//     // _all.push(f);
-//   } else {
-//     f = _free.top();
-//     f->Reset();
-//     _free.pop();
-//   }
-//   return f;
-// }
+  return FlitPool().New();
+}
 
 void Flit::Free() {
-  _free.push(this);
+  FlitPool().Free(static_cast<FocusFlit *>(this));
 }
 
 void Flit::FreeAll() {
-  while(!_all.empty()) {
-    delete _all.top();
-    _all.pop();
-  }
+  FlitPool().Clear();
 }
 
-void Flit::GC() {
-  while (!_free.empty()) {
-    delete _free.top();
-    _free.pop();
-  }
+int Flit::OutStanding() {
+  return FlitPool().Outstanding();
+}
+
+void Flit::DisplayPoolStats( ostream & os ) {
+  FlitPool().DisplayStats("Flit", os);
 }
 
 void FocusFlit::Reset() {
   Flit::Reset();
-  head_flit = nullptr;
   pkt = spatial::Packet();
-  seg = Segment(make_pair(-1, -1));
-  path = nullptr;
-  while (im_nodes.empty()) {
-    im_nodes.pop();
+  board = nullptr;
+  seg = -1;
+  hop = -1;
+  child = nullptr;
+  sibling = nullptr;
+}
+
+// The flits of the succeeding segments come from the pool like any other
+void FocusFlit::Checkpoint( spatial::StateArchive & ar ) {
+  Flit::Checkpoint(ar);
+  ar & board & seg & hop & pkt;
+  Flit * c = child;
+  Flit * s = sibling;
+  ar & c & s;
+  child = static_cast<FocusFlit *>(c);
+  sibling = static_cast<FocusFlit *>(s);
+}
+
+// Where the flit heads for after router rid on its own segment
+int FocusFlit::_NextHop(int rid) {
+  const RoutingBoard::Seg& s = _Seg();
+  while (hop < s.hop_end && board->hop(hop) == rid) {
+    ++hop;
   }
-  childs.clear();
+  return hop < s.hop_end ? board->hop(hop) : s.end;
 }
 
-vector<int> FocusFlit::GetFanoutFlitTargets(int rid) {
-  std::vector<int> targets;
+int FocusFlit::GetFanoutFlitTargets(int rid, int targets[MAX_FANOUT]) {
+  int n = 0;
   // This flit reach the end
-  if (seg.second == rid) {
-    if (path->isDestNode(rid)) {
-      targets.push_back(rid);
+  if (_Seg().end == rid) {
+    if (_Seg().eject) {
+      targets[n++] = rid;
     }
-    for (auto f: childs) {
-      std::vector<int> child_first_hop = f->GetFanoutFlitTargets(rid);
-      assert(child_first_hop.size() == 1);  // splitted flits mush take at least one unicast step after initialized
-      targets.push_back(child_first_hop[0]);
+    // splitted flits mush take at least one unicast step after initialized
+    for (FocusFlit* f = child; f; f = f->sibling) {
+      assert(f->_Seg().start == rid);
+      targets[n++] = f->_NextHop(rid);
     }
   } else {
-    while (!im_nodes.empty() && im_nodes.front() == rid) {
-      im_nodes.pop();
-    }
-    if (im_nodes.empty()) {
-      targets.push_back(seg.second);
-    } else {
-      targets.push_back(im_nodes.front());
-    }
+    targets[n++] = _NextHop(rid);
   }
-  return targets;
+  return n;
 }
 
-vector<FocusFlit*> FocusFlit::GetFanoutFlits(int rid) {
+int FocusFlit::GetFanoutFlits(int rid, FocusFlit* flits[MAX_FANOUT]) {
   int time = GetSimTime();
-  vector<FocusFlit*> ret;
-  if (seg.second != rid) {   // On the way to segment destination
-    ret.push_back(this);
+  int n = 0;
+  if (_Seg().end != rid) {   // On the way to segment destination
+    flits[n++] = this;
   } else {    // We have reached the segment destination
-    if (path->isDestNode(seg.second)) {
-      ret.push_back(this);
+    if (_Seg().eject) {
+      flits[n++] = this;
     }
-    for (FocusFlit* f: childs) {
-      ret.push_back(f);
+    for (FocusFlit* f = child; f; f = f->sibling) {
+      flits[n++] = f;
       f->ctime = time;
     }
   }
-  return ret;
+  return n;
 }
 
 int FocusFlit::GetFanoutFlitNum(int rid) {
-  if (seg.second == rid) {
-    return childs.size() + (path->isDestNode(rid) ? 1 : 0);
+  if (_Seg().end == rid) {
+    return _Seg().child_end - _Seg().child_begin + (_Seg().eject ? 1 : 0);
   } else {
     return 1;
   }
 }
 
 bool FocusFlit::IsRetired(int rid) {
-  return im_nodes.empty() && rid == seg.second;
+  return hop == _Seg().hop_end && rid == _Seg().end;
 }
 
 bool FocusFlit::IsRealFlit() {
-  return path->isDestNode(seg.second); 
+  return _Seg().eject; 
 }
 
 int FocusFlit::SegEnd() {
-  return seg.second;
+  return _Seg().end;
 }
 
 int FocusFlit::SegStart() {
-  return seg.first;
+  return _Seg().start;
 }
 
-FocusFlit* FocusFlit::NewFlitTree(shared_ptr<MCTree> path, Segment seg) {
-  assert(seg.first != seg.second);
+FocusFlit* FocusFlit::NewFlitTree(const shared_ptr<const RoutingBoard>& board, int seg) {
+  const RoutingBoard::Seg& s = board->seg(seg);
+  assert(s.start != s.end);
   // Source
   FocusFlit* flit = static_cast<FocusFlit*>(Flit::New());
   
+  flit->board = board;
   flit->seg = seg;
-  flit->path = path;
-  flit->im_nodes = *(path->intermediateNodes(seg));
+  flit->hop = s.hop_begin;
   
-  vector<Segment> succeeds = path->segmentStartedWith(seg.second);
-  for (Segment s: succeeds) {
-    flit->childs.push_back(NewFlitTree(path, s));
+  FocusFlit** link = &flit->child;
+  for (int c = s.child_begin; c < s.child_end; ++c) {
+    *link = NewFlitTree(board, c);
+    link = &(*link)->sibling;
   }
   return flit;
 }
-
-vector<FocusFlit*> FocusFlit::GetChilds() {
-  return childs;
-}
-
-
-void FocusFlit::SyncWithHeadFlit(FocusFlit* header) {
-  assert(header->head);
-  assert(header->seg == this->seg);
-  head_flit = header;
-
-  assert(header->childs.size() == this->childs.size());
-  for (int i = 0; i < childs.size(); ++i) {
-    childs[i]->SyncWithHeadFlit(header->childs[i]);
-  }
-}
\ No newline at end of file
@@ -70,22 +70,15 @@ void FlitChannel::Send(Flit * f) {
   Channel<Flit>::Send(f);
 }
 
-void FlitChannel::ReadInputs() {
-  Flit const * const & f = _input;
-  if(f && f->watch) {
-    *gWatchOut << GetSimTime() << " | " << FullName() << " | "
-	       << "Beginning channel traversal for flit " << f->id
-	       << " with delay " << _delay
-	       << "." << endl;
-  }
-  Channel<Flit>::ReadInputs();
+void FlitChannel::_WatchAccept() const {
+  *gWatchOut << GetSimTime() << " | " << FullName() << " | "
+	     << "Beginning channel traversal for flit " << _input->id
+	     << " with delay " << _delay
+	     << "." << endl;
 }
 
-void FlitChannel::WriteOutputs() {
-  Channel<Flit>::WriteOutputs();
-  if(_output && _output->watch) {
-    *gWatchOut << GetSimTime() << " | " << FullName() << " | "
-	       << "Completed channel traversal for flit " << _output->id
-	       << "." << endl;
-  }
+void FlitChannel::_WatchDeliver() const {
+  *gWatchOut << GetSimTime() << " | " << FullName() << " | "
+	     << "Completed channel traversal for flit " << _output->id
+	     << "." << endl;
 }
@@ -0,0 +1,71 @@
+#include <fstream>
+#include <mutex>
+
+#include "globals.hpp"
+#include "flit.hpp"
+#include "credit.hpp"
+
+namespace spatial {
+
+thread_local SimContext * SimContext::_current = NULL;
+
+// Booksim prints its traces and debug output to std::cout. Rather than point
+// std::cout at one simulation's log, which would be shared by every thread,
+// it forwards to the log of the context bound to the writing thread, and to
+// the original stdout otherwise.
+class ContextBuf : public std::streambuf {
+  std::streambuf * _stdout;
+
+  std::streambuf * _Target( ) {
+    SimContext * context = SimContext::Current();
+    if ( context && context->log && context->log->rdbuf() != this ) {
+      return context->log->rdbuf();
+    }
+    return _stdout;
+  }
+
+protected:
+  virtual int overflow( int ch ) {
+    return ( ch == EOF ) ? 0 : _Target()->sputc(ch);
+  }
+  virtual std::streamsize xsputn( const char * s, std::streamsize n ) {
+    return _Target()->sputn(s, n);
+  }
+  virtual int sync( ) {
+    return _Target()->pubsync();
+  }
+
+public:
+  explicit ContextBuf( std::streambuf * out ) : _stdout(out) { }
+};
+
+SimContext::SimContext( )
+  : print_activity(false), k(0), n(0), c(0), nodes(0), trace(false),
+    watch_out(NULL), log(&std::cout), p(0), a(0), g(0), num_vcs(0),
+    read_req_begin_vc(0), read_req_end_vc(0), write_req_begin_vc(0), write_req_end_vc(0),
+    read_reply_begin_vc(0), read_reply_end_vc(0), write_reply_begin_vc(0), write_reply_end_vc(0),
+    traffic_manager(NULL)
+{
+  // Never freed: std::cout may still be flushed at exit
+  static std::once_flag redirected;
+  std::call_once(redirected, []() { std::cout.rdbuf(new ContextBuf(std::cout.rdbuf())); });
+}
+
+// The pools destroy the flits and credits still out, so nothing may use them
+// afterwards
+SimContext::~SimContext( ) {
+}
+
+void SimContext::SetWatchOut( const std::string & file ) {
+  _watch_file.reset();
+  if(file == "") {
+    watch_out = NULL;
+  } else if(file == "-") {
+    watch_out = log;
+  } else {
+    _watch_file.reset(new std::ofstream(file.c_str()));
+    watch_out = _watch_file.get();
+  }
+}
+
+}
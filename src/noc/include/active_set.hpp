@@ -0,0 +1,210 @@
+#ifndef _ACTIVE_SET_HPP_
+#define _ACTIVE_SET_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "timed_module.hpp"
+
+// The modules of a network that are stepped in a cycle. A module leaves the
+// set once it is Idle() at the start of a cycle, and is put back by Wake()
+// when something is sent to it, so that idle routers and channels cost
+// nothing. Each partition of the network keeps its modules in a bitmask, in
+// groups of one kind that the network steps in a pass each, and lists the
+// active ones of a group in the order they were registered, as if all were
+// stepped; modules that slept are Skip()ped over the cycles they missed when
+// they wake up.
+//
+// Wake() may be called by the worker of any partition, during any phase, so
+// each worker queues its wakes per partition and the partition takes them in
+// Collect() at the start of the next cycle, which only its own worker runs.
+class ActiveSet {
+
+public:
+  // The partition the calling thread is stepping
+  static int & Worker( ) {
+    static thread_local int worker = 0;
+    return worker;
+  }
+
+  // Registers the groups of modules of every partition and puts them all in
+  // the set
+  void Reset( std::vector<std::vector<std::vector<TimedModule *> > > const & partitions ) {
+    int const parts = partitions.size();
+    _modules.assign(parts, std::vector<TimedModule *>());
+    _group_end.assign(parts, std::vector<int>());
+    _active.assign(parts, std::vector<uint64_t>());
+    _asleep_since.assign(parts, std::vector<long long>());
+    _stepped.assign(parts, std::vector<std::vector<TimedModule *> >());
+    _woken.assign(parts, std::vector<std::vector<int> >(parts));
+    for ( int p = 0; p < parts; ++p ) {
+      for ( size_t g = 0; g < partitions[p].size(); ++g ) {
+        _modules[p].insert(_modules[p].end(), partitions[p][g].begin(), partitions[p][g].end());
+        _group_end[p].push_back(_modules[p].size());
+      }
+      _stepped[p].resize(partitions[p].size());
+      int const n = _modules[p].size();
+      for ( int i = 0; i < n; ++i ) {
+        TimedModule * const m = _modules[p][i];
+        m->_active_set = this;
+        m->_partition = p;
+        m->_slot = i;
+      }
+      _active[p].assign((n + 63) / 64, 0);
+      _asleep_since[p].assign(n, 0);
+    }
+    _cycle = 0;
+    WakeAll();
+  }
+
+  // After the modules were changed from outside, e.g. by loading a checkpoint.
+  // They are woken rather than only put in the set, since an idle router may
+  // still have to read what its channels hold.
+  void WakeAll( ) {
+    for ( size_t p = 0; p < _modules.size(); ++p ) {
+      int const n = _modules[p].size();
+      std::fill(_active[p].begin(), _active[p].end(), 0);
+      std::fill(_asleep_since[p].begin(), _asleep_since[p].end(), _cycle);
+      for ( size_t g = 0; g < _stepped[p].size(); ++g ) {
+        _stepped[p][g].clear();
+      }
+      for ( size_t w = 0; w < _woken.size(); ++w ) {
+        _woken[w][p].clear();
+      }
+      for ( int i = 0; i < n; ++i ) {
+        _woken[0][p].push_back(i);
+      }
+    }
+  }
+
+  void Wake( TimedModule * m ) {
+    assert(Worker() < (int)_woken.size());
+    _woken[Worker()][m->_partition].push_back(m->_slot);
+  }
+
+  // Drops the modules of partition p that went idle and adds those woken
+  // since the previous cycle, at the start of a cycle
+  void Collect( int p ) {
+    std::vector<TimedModule *> const & modules = _modules[p];
+    std::vector<uint64_t> & active = _active[p];
+    for ( size_t w = 0; w < active.size(); ++w ) {
+      for ( uint64_t bits = active[w]; bits != 0; bits &= bits - 1 ) {
+        int const i = w * 64 + __builtin_ctzll(bits);
+        if ( modules[i]->Idle( ) ) {
+          active[w] &= ~(1ULL << (i % 64));
+          _asleep_since[p][i] = _cycle;
+        }
+      }
+    }
+    for ( size_t w = 0; w < _woken.size(); ++w ) {
+      for ( int i : _woken[w][p] ) {
+        uint64_t const bit = 1ULL << (i % 64);
+        if ( !(active[i / 64] & bit) ) {
+          active[i / 64] |= bit;
+          if ( _cycle > _asleep_since[p][i] ) {
+            modules[i]->Skip(_cycle - _asleep_since[p][i]);
+          }
+        }
+      }
+      _woken[w][p].clear();
+    }
+    _Gather(p);
+  }
+
+  // The modules of group g in partition p stepped in this cycle
+  std::vector<TimedModule *> const & Stepped( int p, int g ) const {
+    return _stepped[p][g];
+  }
+
+  // Whether every module in the set, or woken into it, is idle
+  bool Idle( ) const {
+    for ( size_t p = 0; p < _modules.size(); ++p ) {
+      for ( size_t g = 0; g < _stepped[p].size(); ++g ) {
+        for ( TimedModule const * m : _stepped[p][g] ) {
+          if ( !m->Idle( ) ) {
+            return false;
+          }
+        }
+      }
+      for ( size_t w = 0; w < _woken.size(); ++w ) {
+        for ( int i : _woken[w][p] ) {
+          if ( !_modules[p][i]->Idle( ) ) {
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  // Brings the modules out of the set up to the current cycle, before their
+  // state is read as a whole
+  void CatchUp( ) {
+    for ( size_t p = 0; p < _modules.size(); ++p ) {
+      for ( size_t i = 0; i < _modules[p].size(); ++i ) {
+        if ( !((_active[p][i / 64] >> (i % 64)) & 1) && _cycle > _asleep_since[p][i] ) {
+          _modules[p][i]->Skip(_cycle - _asleep_since[p][i]);
+          _asleep_since[p][i] = _cycle;
+        }
+      }
+    }
+  }
+
+  // Ends a cycle
+  void Step( ) {
+    ++_cycle;
+  }
+
+  // Skips cycles over which every module is idle; they all sleep through
+  // them and catch up when they are woken
+  void Skip( int cycles ) {
+    for ( size_t p = 0; p < _modules.size(); ++p ) {
+      for ( size_t g = 0; g < _stepped[p].size(); ++g ) {
+        for ( TimedModule * m : _stepped[p][g] ) {
+          _asleep_since[p][m->_slot] = _cycle;
+        }
+        _stepped[p][g].clear();
+      }
+      std::fill(_active[p].begin(), _active[p].end(), 0);
+    }
+    _cycle += cycles;
+  }
+
+private:
+  std::vector<std::vector<TimedModule *> > _modules;        // per partition, group after group
+  std::vector<std::vector<int> > _group_end;                // per partition, where each group ends
+  std::vector<std::vector<uint64_t> > _active;              // per partition, a bit per module
+  std::vector<std::vector<long long> > _asleep_since;       // per partition, the cycle each module left the set
+  std::vector<std::vector<std::vector<TimedModule *> > > _stepped;  // per partition and group, the active modules
+  std::vector<std::vector<std::vector<int> > > _woken;      // per worker and partition, slots woken
+  long long _cycle;
+
+  void _Gather( int p ) {
+    std::vector<uint64_t> const & active = _active[p];
+    std::vector<int> const & group_end = _group_end[p];
+    for ( size_t g = 0; g < _stepped[p].size(); ++g ) {
+      _stepped[p][g].clear();
+    }
+    size_t g = 0;
+    for ( size_t w = 0; w < active.size(); ++w ) {
+      for ( uint64_t bits = active[w]; bits != 0; bits &= bits - 1 ) {
+        int const i = w * 64 + __builtin_ctzll(bits);
+        while ( i >= group_end[g] ) {
+          ++g;
+        }
+        _stepped[p][g].push_back(_modules[p][i]);
+      }
+    }
+  }
+};
+
+inline void TimedModule::Wake( )
+{
+  if ( _active_set ) {
+    _active_set->Wake(this);
+  }
+}
+
+#endif
@@ -158,6 +158,8 @@ public:
 #endif
 
   void Display( ostream & os = cout ) const;
+
+  void Checkpoint( spatial::StateArchive & ar );
 };
 
 
@@ -187,17 +189,13 @@ public:
     static_cast<MCVC*>(_vc[vc])->clearOutputs();
   }
 
-  inline map<int, int> getMultiOutputs(int vc) {
-    vector<pair<int, int>> output_pairs = static_cast<MCVC*>(_vc[vc])->getMultiOutputs();
-    map<int, int> ret;
-    for (pair<int, int> p: output_pairs) {
-      ret.insert(p);
-    }
-    return ret;
+  // <out_port, out_vc> in ascending order of output ports
+  inline const vector<pair<int, int> > & getMultiOutputs(int vc) const {
+    return static_cast<const MCVC*>(_vc[vc])->getMultiOutputs();
   }
 
-  const map<int, int> getPortTargetMap(int vc) {
-    return static_cast<MCVC*>(_vc[vc])->getPortTargetMap();
+  int getPortTarget(int vc, int out_port) const {
+    return static_cast<const MCVC*>(_vc[vc])->getPortTarget(out_port);
   }
 
 };
@@ -51,6 +51,7 @@ class BufferState : public Module {
     virtual bool IsFullFor(int vc = 0) const = 0;
     virtual int AvailableFor(int vc = 0) const = 0;
     virtual int LimitFor(int vc = 0) const = 0;
+    virtual void Checkpoint(spatial::StateArchive & /* ar */) {}
 
     static BufferPolicy * New(Configuration const & config, 
 			      BufferState * parent, const string & name);
@@ -86,6 +87,9 @@ class BufferState : public Module {
     virtual bool IsFullFor(int vc = 0) const;
     virtual int AvailableFor(int vc = 0) const;
     virtual int LimitFor(int vc = 0) const;
+    virtual void Checkpoint(spatial::StateArchive & ar) {
+      ar & _private_buf_occupancy & _shared_buf_occupancy & _reserved_slots;
+    }
   };
 
   class LimitedSharedBufferPolicy : public SharedBufferPolicy {
@@ -102,6 +106,10 @@ class BufferState : public Module {
     virtual bool IsFullFor(int vc = 0) const;
     virtual int AvailableFor(int vc = 0) const;
     virtual int LimitFor(int vc = 0) const;
+    virtual void Checkpoint(spatial::StateArchive & ar) {
+      SharedBufferPolicy::Checkpoint(ar);
+      ar & _active_vcs & _max_held_slots;
+    }
   };
     
   class DynamicLimitedSharedBufferPolicy : public LimitedSharedBufferPolicy {
@@ -144,6 +152,11 @@ class BufferState : public Module {
     virtual bool IsFullFor(int vc = 0) const;
     virtual int AvailableFor(int vc = 0) const;
     virtual int LimitFor(int vc = 0) const;
+    virtual void Checkpoint(spatial::StateArchive & ar) {
+      SharedBufferPolicy::Checkpoint(ar);
+      ar & _occupancy_limit & _round_trip_time & _flit_sent_time 
+	 & _min_latency & _total_mapped_size;
+    }
   };
   
   class SimpleFeedbackSharedBufferPolicy : public FeedbackSharedBufferPolicy {
@@ -154,6 +167,10 @@ class BufferState : public Module {
 				     BufferState * parent, const string & name);
     virtual void SendingFlit(Flit const * const f);
     virtual void FreeSlotFor(int vc = 0);
+    virtual void Checkpoint(spatial::StateArchive & ar) {
+      FeedbackSharedBufferPolicy::Checkpoint(ar);
+      ar & _pending_credits;
+    }
   };
   
   bool _wait_for_tail_credit;
@@ -234,6 +251,8 @@ public:
 #endif
 
   void Display( ostream & os = cout ) const;
+
+  void Checkpoint( spatial::StateArchive & ar );
 };
 
 #endif 
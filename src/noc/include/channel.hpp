@@ -37,15 +37,22 @@
 #ifndef _CHANNEL_HPP
 #define _CHANNEL_HPP
 
-#include <queue>
+#include <algorithm>
 #include <cassert>
+#include <vector>
 
 #include "globals.hpp"
 #include "module.hpp"
 #include "timed_module.hpp"
+#include "active_set.hpp"
+#include "state_archive.hpp"
 
 using namespace std;
 
+// In-flight data sits in a ring of slots indexed by the cycle it comes out,
+// as at most one item enters per cycle and each stays exactly the latency.
+// The network advances its channels with Accept() and Deliver() in bulk;
+// ReadInputs() and WriteOutputs() do the same for a single channel.
 template<typename T>
 class Channel : public TimedModule {
 public:
@@ -55,6 +62,9 @@ public:
   // Physical Parameters
   void SetLatency(int cycles);
   int GetLatency() const { return _delay ; }
+
+  // The module receiving the data, woken whenever some comes out
+  void SetReader(TimedModule * reader) { _reader = reader; }
   
   // Send data 
   virtual void Send(T * data);
@@ -62,21 +72,77 @@ public:
   // Receive data
   virtual T * Receive(); 
   
-  virtual void ReadInputs();
+  virtual void ReadInputs() { Accept(GetSimTime()); }
   virtual void Evaluate() {}
-  virtual void WriteOutputs();
+  virtual void WriteOutputs() { Deliver(GetSimTime()); }
+
+  // Takes the data sent in cycle now into the ring
+  inline void Accept(int now) {
+    if(_input) {
+      T * & slot = _ring[(now + _delay - 1) & (_ring.size() - 1)];
+      assert(!slot);
+      slot = _input;
+      _input = 0;
+      ++_in_flight;
+    }
+  }
+
+  // Puts out the data due in cycle now, if any
+  inline void Deliver(int now) {
+    _output = 0;
+    if(_in_flight == 0) {
+      return;
+    }
+    T * & slot = _ring[now & (_ring.size() - 1)];
+    if(!slot) {
+      return;
+    }
+    _output = slot;
+    slot = 0;
+    --_in_flight;
+    if(_reader) {
+      _reader->Wake();
+    }
+  }
+
+  virtual bool Idle() const { return !_input && !_output && _in_flight == 0; }
+
+  // The ring goes as the (cycle, data) pairs in flight, in order
+  virtual void Checkpoint(spatial::StateArchive & ar) {
+    ar & _input & _output;
+    int const now = GetSimTime();
+    vector<pair<int, T *> > in_flight;
+    for(size_t i = 0; i < _ring.size(); ++i) {
+      T * const data = _ring[(now + i) & (_ring.size() - 1)];
+      if(data) {
+        in_flight.push_back(make_pair(now + (int)i, data));
+      }
+    }
+    ar & in_flight;
+    if(ar.loading()) {
+      fill(_ring.begin(), _ring.end(), (T *)0);
+      for(size_t i = 0; i < in_flight.size(); ++i) {
+        assert(in_flight[i].first >= now && in_flight[i].first < now + _delay);
+        _ring[in_flight[i].first & (_ring.size() - 1)] = in_flight[i].second;
+      }
+      _in_flight = in_flight.size();
+    }
+  }
 
 protected:
   int _delay;
+  TimedModule * _reader;
   T * _input;
   T * _output;
-  queue<pair<int, T *> > _wait_queue;
+  vector<T *> _ring;
+  int _in_flight;
 
 };
 
 template<typename T>
 Channel<T>::Channel(Module * parent, string const & name)
-  : TimedModule(parent, name), _delay(1), _input(0), _output(0) {
+  : TimedModule(parent, name), _delay(1), _reader(0), _input(0), _output(0),
+    _ring(1, (T *)0), _in_flight(0) {
 }
 
 template<typename T>
@@ -84,12 +150,21 @@ void Channel<T>::SetLatency(int cycles) {
   if(cycles <= 0) {
     Error("Channel must have positive delay.");
   }
+  assert(_in_flight == 0);
   _delay = cycles ;
+  size_t size = 1;
+  while(size < (size_t)cycles) {
+    size *= 2;
+  }
+  _ring.assign(size, (T *)0);
 }
 
 template<typename T>
 void Channel<T>::Send(T * data) {
   _input = data;
+  if(data) {
+    Wake();
+  }
 }
 
 template<typename T>
@@ -97,29 +172,4 @@ T * Channel<T>::Receive() {
   return _output;
 }
 
-template<typename T>
-void Channel<T>::ReadInputs() {
-  if(_input) {
-    _wait_queue.push(make_pair(GetSimTime() + _delay - 1, _input));
-    _input = 0;
-  }
-}
-
-template<typename T>
-void Channel<T>::WriteOutputs() {
-  _output = 0;
-  if(_wait_queue.empty()) {
-    return;
-  }
-  pair<int, T *> const & item = _wait_queue.front();
-  int const & time = item.first;
-  if(GetSimTime() < time) {
-    return;
-  }
-  assert(GetSimTime() == time);
-  _output = item.second;
-  assert(_output);
-  _wait_queue.pop();
-}
-
 #endif
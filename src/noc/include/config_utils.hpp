@@ -50,7 +50,7 @@ using namespace std;
 extern "C" int yyparse();
 
 class Configuration {
-  static Configuration * theConfig;
+  static thread_local Configuration * theConfig;    // the one being parsed by this thread
   FILE * _config_file;
   string _config_string;
 
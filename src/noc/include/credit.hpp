@@ -29,7 +29,11 @@
 #define _CREDIT_HPP_
 
 #include <set>
-#include <stack>
+#include <ostream>
+
+#include "state_archive.hpp"
+
+template <class T> class SlabPool;
 
 class Credit {
 
@@ -42,15 +46,17 @@ public:
   int  id;
 
   void Reset();
+  void Checkpoint( spatial::StateArchive & ar ) { ar & vc & head & tail & id; }
   
+  // Credits come from a slab pool and are recycled by Free()
   static Credit * New();
   void Free();
   static void FreeAll();
   static int OutStanding();
+  static void DisplayPoolStats( ostream & os );
 private:
 
-  static stack<Credit *> _all;
-  static stack<Credit *> _free;
+  friend class SlabPool<Credit>;
 
   Credit();
   ~Credit() {}
@@ -0,0 +1,70 @@
+#ifndef _FLIGHT_COUNTER_HPP_
+#define _FLIGHT_COUNTER_HPP_
+
+#include <cassert>
+#include <set>
+
+#include "flit.hpp"
+#include "state_archive.hpp"
+
+// The flits of a traffic class that were generated and not retired yet. Only
+// how many there are is kept, and the sum of their creation times for the
+// latency estimates, so that generating and retiring a flit is a pair of
+// additions. Building with TRACK_IN_FLIGHT_FLITS also keeps their ids, which
+// are checked on retirement and listed by _DisplayRemaining(); checkpoints then
+// hold the ids too.
+class FlightCounter {
+
+public:
+  FlightCounter( ) : _count(0), _ctime_sum(0) { }
+
+  bool empty( ) const { return _count == 0; }
+  int size( ) const { return _count; }
+
+  void Insert( Flit const * f ) {
+    ++_count;
+    _ctime_sum += f->ctime;
+#ifdef TRACK_IN_FLIGHT_FLITS
+    bool const fresh = _ids.insert(f->id).second;
+    assert(fresh);
+#endif
+  }
+
+  void Erase( Flit const * f ) {
+    assert(_count > 0);
+    --_count;
+    _ctime_sum -= f->ctime;
+#ifdef TRACK_IN_FLIGHT_FLITS
+    bool const found = _ids.erase(f->id) > 0;
+    assert(found);
+#endif
+  }
+
+  // Cycles spent in the network so far by all of them together. Multicast
+  // flits get a new creation time when they fork, which leaves the sum off
+  // afterwards; it is only read by the convergence checks of synthetic
+  // traffic, whose flits never fork.
+  long long Age( int now ) const {
+    return (long long)now * _count - _ctime_sum;
+  }
+
+#ifdef TRACK_IN_FLIGHT_FLITS
+  std::set<int> const & Ids( ) const { return _ids; }
+#endif
+
+  void Checkpoint( spatial::StateArchive & ar ) {
+    ar & _count & _ctime_sum;
+#ifdef TRACK_IN_FLIGHT_FLITS
+    ar & _ids;
+#endif
+  }
+
+private:
+  int _count;
+  long long _ctime_sum;
+#ifdef TRACK_IN_FLIGHT_FLITS
+  std::set<int> _ids;
+#endif
+};
+
+#endif
@@ -29,7 +29,6 @@
 #define _FLIT_HPP_
 
 #include <iostream>
-#include <stack>
 
 #include "booksim.hpp"
 #include "outputset.hpp"
@@ -86,20 +85,20 @@ public:
   OutputSet la_route_set;
 
   virtual void Reset();
+  virtual void Checkpoint( spatial::StateArchive & ar );
 
+  // Flits come from a slab pool and are recycled by Free()
   static Flit * New();
-  static void GC();
   void Free();
   static void FreeAll();
+  static int OutStanding();
+  static void DisplayPoolStats( ostream & os );
 
 protected:
 
   Flit();
   ~Flit() {}
 
-  static stack<Flit *> _all;
-  static stack<Flit *> _free;
-
 };
 
 ostream& operator<<( ostream& os, const Flit& f );
@@ -109,37 +108,42 @@ class FocusFlit: public Flit {
 
 protected:
 
-  std::shared_ptr<MCTree> path;           // The full path it accords
-
-  // source routing field
-  Segment seg;                            // What segment it resides
-  std::queue<int> im_nodes;
+  // source routing field, a cursor into the routing board of the packet
+  std::shared_ptr<const RoutingBoard> board;
+  int seg;                                // What segment it resides
+  int hop;                                // Next intermediate node of the segment in board->hop()
 
-  // tree-based multicast field
-  std::vector<FocusFlit*> childs;
+  // tree-based multicast field: the flits of the succeeding segments
+  FocusFlit* child;
+  FocusFlit* sibling;
 
+  const RoutingBoard::Seg& _Seg() const { return board->seg(seg); }
+  int _NextHop(int rid);
 
 public:
-  Flit* head_flit;
+  // A flit ejects and forks into at most 4 succeeding segments at a router
+  static const int MAX_FANOUT = 5;
+
   // fields shared by a packet
   spatial::Packet pkt;   // The packet this flit belongs to  
   virtual void Reset() override;
+  virtual void Checkpoint( spatial::StateArchive & ar ) override;
+
+  FocusFlit* FirstChild() const { return child; }
+  FocusFlit* NextSibling() const { return sibling; }
 
   // Their returns follow the same order: [eject][child0][child1]...
-  std::vector<FocusFlit*> GetChilds();
-  std::vector<FocusFlit*> GetFanoutFlits(int rid);
-  std::vector<int> GetFanoutFlitTargets(int rid);
+  int GetFanoutFlits(int rid, FocusFlit* flits[MAX_FANOUT]);
+  int GetFanoutFlitTargets(int rid, int targets[MAX_FANOUT]);
   int GetFanoutFlitNum(int rid);
   bool IsRetired(int rid);
 
-  void SyncWithHeadFlit(FocusFlit* head_flit);
-
   int SegEnd();
   int SegStart();
   bool IsRealFlit();
 
-  // New flits with the given path, these flits are only set seg, im_nodes, childs
-  static FocusFlit* NewFlitTree(shared_ptr<MCTree> path, Segment seg);
+  // New flits for the given segment of the board and the ones succeeding it
+  static FocusFlit* NewFlitTree(const std::shared_ptr<const RoutingBoard>& board, int seg);
 
   FocusFlit() {
     Reset();
@@ -75,8 +75,27 @@ public:
   // Send flit 
   virtual void Send(Flit * flit);
 
-  virtual void ReadInputs();
-  virtual void WriteOutputs();
+  virtual void ReadInputs() { Accept(GetSimTime()); }
+  virtual void WriteOutputs() { Deliver(GetSimTime()); }
+
+  inline void Accept(int now) {
+    if(_input && _input->watch) {
+      _WatchAccept();
+    }
+    Channel<Flit>::Accept(now);
+  }
+
+  inline void Deliver(int now) {
+    Channel<Flit>::Deliver(now);
+    if(_output && _output->watch) {
+      _WatchDeliver();
+    }
+  }
+
+  virtual void Checkpoint(spatial::StateArchive & ar) {
+    Channel<Flit>::Checkpoint(ar);
+    ar & _active & _idle;
+  }
 
 private:
   
@@ -94,6 +113,9 @@ private:
   // Statistics for Activity Factors
   vector<int> _active;
   int _idle;
+
+  void _WatchAccept() const;
+  void _WatchDeliver() const;
 };
 
 #endif
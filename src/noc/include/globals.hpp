@@ -30,6 +30,79 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <memory>
+
+#include "random_utils.hpp"
+#include "slab_pool.hpp"
+
+class TrafficManager;
+class FocusFlit;
+class Credit;
+
+namespace spatial {
+
+// Everything booksim used to keep in process-wide globals, gathered per
+// simulation so that several simulations can run at once in one process.
+// SpatialChip owns one and binds it to its own thread and to the workers
+// evaluating its routers; the g* names below resolve against the context 
+// bound to the calling thread.
+class SimContext {
+
+public:
+  /* printing activity factor*/
+  bool print_activity;
+  int k; //radix
+  int n; //dimension
+  int c; //concentration
+  int nodes;
+  //generate nocviewer trace
+  bool trace;
+  std::ostream * watch_out;
+  std::ostream * log;           // the text log, std::cout included while bound
+
+  int p, a, g;                  // dragonfly
+
+  int num_vcs;
+  int read_req_begin_vc, read_req_end_vc;
+  int write_req_begin_vc, write_req_end_vc;
+  int read_reply_begin_vc, read_reply_end_vc;
+  int write_reply_begin_vc, write_reply_end_vc;
+  std::vector<unsigned char> mesh_next_port;   // dor_next_mesh() per router and destination
+
+  TrafficManager * traffic_manager;
+  RandomState random;
+  SlabPool<FocusFlit> flit_pool;
+  SlabPool<Credit> credit_pool;
+
+  SimContext( );
+  ~SimContext( );
+
+  SimContext( const SimContext & ) = delete;
+  SimContext & operator=( const SimContext & ) = delete;
+
+  // Watch into the given file, into the log for "-", or nowhere for ""
+  void SetWatchOut( const std::string & file );
+
+  static SimContext * Current( ) { return _current; }
+
+  // Binds a context to the calling thread for the lifetime of the scope
+  class Scope {
+    SimContext * _saved;
+  public:
+    explicit Scope( SimContext * context ) : _saved(_current) { _current = context; }
+    ~Scope( ) { _current = _saved; }
+    Scope( const Scope & ) = delete;
+    Scope & operator=( const Scope & ) = delete;
+  };
+
+private:
+  std::unique_ptr<std::ostream> _watch_file;
+
+  static thread_local SimContext * _current;
+
+};
+
+}
 
 /*all declared in main.cpp*/
 
@@ -38,16 +111,16 @@ int GetSimTime();
 class Stats;
 Stats * GetStats(const std::string & name);
 
-extern bool gPrintActivity;
+#define gPrintActivity (spatial::SimContext::Current()->print_activity)
 
-extern int gK;
-extern int gN;
-extern int gC;
+#define gK (spatial::SimContext::Current()->k)
+#define gN (spatial::SimContext::Current()->n)
+#define gC (spatial::SimContext::Current()->c)
 
-extern int gNodes;
+#define gNodes (spatial::SimContext::Current()->nodes)
 
-extern bool gTrace;
+#define gTrace (spatial::SimContext::Current()->trace)
 
-extern std::ostream * gWatchOut;
+#define gWatchOut (spatial::SimContext::Current()->watch_out)
 
 #endif
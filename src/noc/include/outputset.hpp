@@ -28,8 +28,9 @@
 #ifndef _OUTPUTSET_HPP_
 #define _OUTPUTSET_HPP_
 
-#include <set>
-#include <map>
+#include <vector>
+
+#include "state_archive.hpp"
 
 class OutputSet {
 
@@ -51,13 +52,19 @@ public:
   bool OutputEmpty( int output_port ) const;
   int NumVCs( int output_port ) const;
   
-  const set<sSetElement> & GetSet() const;
-  const map<int, int> getPortTargetMap() const;
+  const vector<sSetElement> & GetSet() const;
+  int getPortTarget( int output_port ) const;
   
   int  GetVC( int output_port,  int vc_index, int *pri = 0 ) const;
   bool GetPortVC( int *out_port, int *out_vc ) const;
+
+  void Checkpoint( spatial::StateArchive & ar ) { ar & _outputs; }
 private:
-  set<sSetElement> _outputs;
+  // Sorted and free of duplicates like a set, but kept in a vector so that a
+  // set routed into over and over doesn't allocate once it has grown
+  vector<sSetElement> _outputs;
+
+  void _Insert( sSetElement const & s );
 };
 
 inline bool operator<(const OutputSet::sSetElement & se1, 
@@ -30,6 +30,32 @@
 
 #include <vector>
 
+#include "state_archive.hpp"
+
+// The state of Knuth's RANARRAY generators, which rng.c and rng-double.c
+// used to keep in globals. Each simulation owns one (see SimContext), and the
+// generators below draw from the one of the current simulation.
+struct RandomState {
+  static const int LONG_LAG = 100;    // KK in rng.c
+  static const int BUFFER_SIZE = 1009; // QUALITY in rng.c
+
+  long x[LONG_LAG];
+  long arr_buf[BUFFER_SIZE];
+  long arr_dummy, arr_started;
+  long * arr_ptr;                     // into arr_buf or at one of the sentinels
+
+  double u[LONG_LAG];
+  double farr_buf[BUFFER_SIZE];
+  double farr_dummy, farr_started;
+  double * farr_ptr;
+
+  RandomState( );
+  RandomState( RandomState const & other ) { *this = other; }
+  RandomState & operator=( RandomState const & other );
+
+  void Checkpoint( spatial::StateArchive & ar );
+};
+
 // interface to Knuth's RANARRAY RNG
 void   ran_start(long seed);
 long   ran_next( );
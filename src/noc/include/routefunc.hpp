@@ -32,6 +32,7 @@
 #include "router.hpp"
 #include "outputset.hpp"
 #include "config_utils.hpp"
+#include "globals.hpp"
 
 typedef void (*tRoutingFunction)( const Router *, const Flit *, int in_channel, OutputSet *, bool );
 
@@ -39,10 +40,20 @@ void InitializeRoutingMap( const Configuration & config );
 
 extern map<string, tRoutingFunction> gRoutingFunctionMap;
 
-extern int gNumVCs;
-extern int gReadReqBeginVC, gReadReqEndVC;
-extern int gWriteReqBeginVC, gWriteReqEndVC;
-extern int gReadReplyBeginVC, gReadReplyEndVC;
-extern int gWriteReplyBeginVC, gWriteReplyEndVC;
+// The output port towards dest at router cur of dimension-order routing on a
+// mesh, ejection if cur is dest
+int dor_next_mesh( int cur, int dest, bool descending = false );
+
+// Kept in the context of the simulation, see globals.hpp
+#define gNumVCs (spatial::SimContext::Current()->num_vcs)
+#define gReadReqBeginVC (spatial::SimContext::Current()->read_req_begin_vc)
+#define gReadReqEndVC (spatial::SimContext::Current()->read_req_end_vc)
+#define gWriteReqBeginVC (spatial::SimContext::Current()->write_req_begin_vc)
+#define gWriteReqEndVC (spatial::SimContext::Current()->write_req_end_vc)
+#define gReadReplyBeginVC (spatial::SimContext::Current()->read_reply_begin_vc)
+#define gReadReplyEndVC (spatial::SimContext::Current()->read_reply_end_vc)
+#define gWriteReplyBeginVC (spatial::SimContext::Current()->write_reply_begin_vc)
+#define gWriteReplyEndVC (spatial::SimContext::Current()->write_reply_end_vc)
+#define gMeshNextPort (spatial::SimContext::Current()->mesh_next_port)
 
 #endif
@@ -0,0 +1,116 @@
+#ifndef _SLAB_POOL_HPP_
+#define _SLAB_POOL_HPP_
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <vector>
+
+// Recycles the objects of one class (one size class per pool), so that the
+// millions of flits and credits of a run only cost a heap allocation per
+// slab. Objects are constructed the first time they are handed out and are
+// Reset() when they are reused; nothing goes back to the heap before Clear().
+// Routers evaluated in parallel may allocate and free concurrently, so New()
+// and Free() lock once SetShared(true) says the pool is used that way.
+template <class T>
+class SlabPool {
+
+public:
+  struct Stats {
+    size_t requests;      // calls to New()
+    size_t objects;       // objects ever constructed
+    size_t slabs;
+    size_t in_use;
+    size_t peak_in_use;
+  };
+
+  explicit SlabPool( size_t slab_objects = 1024 )
+    : _slab_objects(slab_objects), _constructed(0), _shared(false) {
+    _stats = Stats();
+  }
+  ~SlabPool() { Clear(); }
+
+  void SetShared( bool shared ) { _shared = shared; }
+
+  T * New() {
+    std::unique_lock<std::mutex> guard(_lock, std::defer_lock);
+    if ( _shared ) {
+      guard.lock();
+    }
+    T * p;
+    if ( !_free.empty() ) {
+      p = _free.back();
+      _free.pop_back();
+      p->Reset();
+    } else {
+      if ( _constructed == _slab_objects || _slabs.empty() ) {
+        _slabs.push_back(static_cast<T *>(::operator new(_slab_objects * sizeof(T))));
+        _constructed = 0;
+        _stats.slabs++;
+      }
+      p = new (_slabs.back() + _constructed++) T();
+      _stats.objects++;
+    }
+    _stats.requests++;
+    if ( ++_stats.in_use > _stats.peak_in_use ) {
+      _stats.peak_in_use = _stats.in_use;
+    }
+    return p;
+  }
+
+  void Free( T * p ) {
+    std::unique_lock<std::mutex> guard(_lock, std::defer_lock);
+    if ( _shared ) {
+      guard.lock();
+    }
+    _free.push_back(p);
+    _stats.in_use--;
+  }
+
+  // Destroys every object, including the ones still in use
+  void Clear() {
+    std::lock_guard<std::mutex> guard(_lock);
+    for ( size_t s = 0; s < _slabs.size(); ++s ) {
+      size_t n = ( s + 1 == _slabs.size() ) ? _constructed : _slab_objects;
+      for ( size_t i = 0; i < n; ++i ) {
+        _slabs[s][i].~T();
+      }
+      ::operator delete(_slabs[s]);
+    }
+    _slabs.clear();
+    _free.clear();
+    _constructed = 0;
+    _stats.in_use = 0;
+  }
+
+  size_t Outstanding() const {
+    std::lock_guard<std::mutex> guard(_lock);
+    return _stats.in_use;
+  }
+
+  Stats GetStats() const {
+    std::lock_guard<std::mutex> guard(_lock);
+    return _stats;
+  }
+
+  void DisplayStats( const char * name, std::ostream & os ) const {
+    Stats s = GetStats();
+    os << name << " pool: " << s.requests << " allocations served by "
+       << s.objects << " objects in " << s.slabs << " slabs, peak "
+       << s.peak_in_use << " in use ("
+       << s.slabs * _slab_objects * sizeof(T) / 1024 << " KB)" << std::endl;
+  }
+
+private:
+  const size_t _slab_objects;
+  std::vector<T *> _slabs;
+  size_t _constructed;        // objects constructed in the last slab
+  std::vector<T *> _free;
+  Stats _stats;
+  bool _shared;               // by threads evaluating the network in parallel
+  mutable std::mutex _lock;
+
+};
+
+#endif
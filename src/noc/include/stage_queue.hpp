@@ -0,0 +1,179 @@
+#ifndef _STAGE_QUEUE_HPP_
+#define _STAGE_QUEUE_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "state_archive.hpp"
+
+// A FIFO ring allocated up front. Routers size their rings to what a stage can
+// hold at once, so pushing and popping never touch the heap; a ring that turns
+// out too small doubles rather than failing.
+template <class T>
+class RingQueue {
+
+public:
+  explicit RingQueue( int capacity = 1 ) : _head(0), _size(0) {
+    _items.resize(_Round(capacity));
+  }
+
+  bool empty() const { return _size == 0; }
+  int size() const { return _size; }
+
+  // i-th entry from the front
+  T & operator[]( int i ) { return _items[(_head + i) & (_items.size() - 1)]; }
+  T const & operator[]( int i ) const { return _items[(_head + i) & (_items.size() - 1)]; }
+  T & front() { return (*this)[0]; }
+
+  void push_back( T const & item ) {
+    if ( _size == (int)_items.size() ) {
+      _Grow();
+    }
+    (*this)[_size++] = item;
+  }
+
+  void pop_front() {
+    assert(_size > 0);
+    _head = (_head + 1) & (_items.size() - 1);
+    --_size;
+  }
+
+  void Checkpoint( spatial::StateArchive & ar ) {
+    int n = _size;
+    ar & n;
+    if ( ar.loading() ) {
+      _head = 0;
+      _size = 0;
+      while ( (int)_items.size() < n ) {
+        _Grow();
+      }
+      _size = n;
+    }
+    for ( int i = 0; i < _size; ++i ) {
+      ar & (*this)[i];
+    }
+  }
+
+protected:
+  std::vector<T> _items;
+  int _head;
+  int _size;
+
+  static int _Round( int capacity ) {
+    int n = 1;
+    while ( n < capacity ) {
+      n *= 2;
+    }
+    return n;
+  }
+
+  // Only when full (or empty), so that the ring unrolls by rotating it
+  void _Grow() {
+    std::rotate(_items.begin(), _items.begin() + _head, _items.end());
+    _items.resize(_items.size() * 2);
+    _head = 0;
+  }
+};
+
+// The VCs waiting in one stage of a router pipeline, in arrival order, with
+// each field in an array of its own. Every entry holds the cycle its stage
+// completes (-1 until it is evaluated), its input and VC, and what the stage
+// granted: -1 before, a STALL_* code if it failed, otherwise an output and VC
+// for unicast flits, or the number of outputs granted for multicast flits,
+// whose ports are set in `ports`.
+class StageQueue {
+
+public:
+  explicit StageQueue( int capacity = 1 ) : _head(0), _size(0), _capacity(0) {
+    _Resize(_Round(capacity));
+  }
+
+  bool empty() const { return _size == 0; }
+  int size() const { return _size; }
+
+  // Fields of the i-th entry from the front
+  int & time( int i ) { return _time[_Slot(i)]; }
+  int input( int i ) const { return _input[_Slot(i)]; }
+  int vc( int i ) const { return _vc[_Slot(i)]; }
+  int & grant( int i ) { return _grant[_Slot(i)]; }
+  uint64_t & ports( int i ) { return _ports[_Slot(i)]; }
+
+  void push_back( int input, int vc ) {
+    if ( _size == _capacity ) {
+      _Grow();
+    }
+    int const slot = _Slot(_size++);
+    _time[slot] = -1;
+    _input[slot] = input;
+    _vc[slot] = vc;
+    _grant[slot] = -1;
+    _ports[slot] = 0;
+  }
+
+  void pop_front() {
+    assert(_size > 0);
+    _head = (_head + 1) & (_capacity - 1);
+    --_size;
+  }
+
+  void Checkpoint( spatial::StateArchive & ar ) {
+    int n = _size;
+    ar & n;
+    if ( ar.loading() ) {
+      _head = 0;
+      _size = 0;
+      while ( _capacity < n ) {
+        _Grow();
+      }
+      _size = n;
+    }
+    for ( int i = 0; i < _size; ++i ) {
+      int const slot = _Slot(i);
+      ar & _time[slot] & _input[slot] & _vc[slot] & _grant[slot] & _ports[slot];
+    }
+  }
+
+private:
+  std::vector<int> _time;
+  std::vector<int> _input;
+  std::vector<int> _vc;
+  std::vector<int> _grant;
+  std::vector<uint64_t> _ports;
+  int _head;
+  int _size;
+  int _capacity;
+
+  int _Slot( int i ) const { return (_head + i) & (_capacity - 1); }
+
+  static int _Round( int capacity ) {
+    int n = 1;
+    while ( n < capacity ) {
+      n *= 2;
+    }
+    return n;
+  }
+
+  void _Resize( int capacity ) {
+    _time.resize(capacity);
+    _input.resize(capacity);
+    _vc.resize(capacity);
+    _grant.resize(capacity);
+    _ports.resize(capacity);
+    _capacity = capacity;
+  }
+
+  // Only when full (or empty), so that the ring unrolls by rotating it
+  void _Grow() {
+    std::rotate(_time.begin(), _time.begin() + _head, _time.end());
+    std::rotate(_input.begin(), _input.begin() + _head, _input.end());
+    std::rotate(_vc.begin(), _vc.begin() + _head, _vc.end());
+    std::rotate(_grant.begin(), _grant.begin() + _head, _grant.end());
+    std::rotate(_ports.begin(), _ports.begin() + _head, _ports.end());
+    _head = 0;
+    _Resize(_capacity * 2);
+  }
+};
+
+#endif
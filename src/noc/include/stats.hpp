@@ -29,6 +29,7 @@
 #define _STATS_HPP_
 
 #include "module.hpp"
+#include "state_archive.hpp"
 
 const int MAX_NODES = 1500;
 
@@ -88,6 +89,8 @@ public:
   void Display( ostream & os = cout ) const;
   void Dump();
 
+  void Checkpoint( spatial::StateArchive & ar );
+
   friend ostream & operator<<(ostream & os, const Stats & s);
 
 };
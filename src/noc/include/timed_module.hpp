@@ -30,15 +30,34 @@
 
 #include "module.hpp"
 
+class ActiveSet;
+
 class TimedModule : public Module {
 
+  friend class ActiveSet;
+
+  // Where the module is registered to be stepped, if anywhere
+  ActiveSet * _active_set;
+  int _partition;
+  int _slot;
+
 public:
-  TimedModule(Module * parent, string const & name) : Module(parent, name) {}
+  TimedModule(Module * parent, string const & name)
+    : Module(parent, name), _active_set(0), _partition(0), _slot(0) {}
   virtual ~TimedModule() {}
   
   virtual void ReadInputs() = 0;
   virtual void Evaluate() = 0;
   virtual void WriteOutputs() = 0;
+
+  // Idle modules do nothing when stepped until something is sent to them, so
+  // the simulator may Skip() over those cycles instead of stepping them.
+  virtual bool Idle() const { return false; }
+  virtual void Skip(int /* cycles */) {}
+
+  // Steps the module from the next cycle on, for whoever sends it something
+  // (defined in active_set.hpp)
+  inline void Wake();
 };
 
 #endif
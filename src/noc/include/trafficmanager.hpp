@@ -39,6 +39,7 @@
 #include "config_utils.hpp"
 #include "network.hpp"
 #include "flit.hpp"
+#include "flight_counter.hpp"
 #include "buffer_state.hpp"
 #include "stats.hpp"
 #include "traffic.hpp"
@@ -46,6 +47,7 @@
 #include "outputset.hpp"
 #include "injection.hpp"
 #include "bridge.hpp"
+#include "event_log.hpp"
 
 //register the requests to a node
 class PacketReplyInfo;
@@ -118,8 +120,8 @@ protected:
   vector<vector<bool> > _qdrained;
   vector<vector<list<Flit *> > > _partial_packets;
 
-  vector<map<int, Flit *> > _total_in_flight_flits;
-  vector<map<int, Flit *> > _measured_in_flight_flits;
+  vector<FlightCounter> _total_in_flight_flits;
+  vector<FlightCounter> _measured_in_flight_flits;
   vector<map<int, Flit *> > _retired_packets;
   bool _empty_network;
 
@@ -131,6 +133,10 @@ protected:
 
   vector<int> _subnet;
 
+  // The flit ejected at each node of each subnet in the current cycle, or
+  // NULL; taken back out before the cycle ends
+  vector<vector<Flit *> > _ejected;
+
   // ============ deadlock ==========
 
   int _deadlock_timer;
@@ -241,6 +247,8 @@ protected:
   set<int> _flits_to_watch;
   set<int> _packets_to_watch;
 
+  spatial::LogSink * _event_log;
+
   bool _print_csv_results;
 
   //flits to watch
@@ -296,6 +304,29 @@ protected:
 public:
   void _DisplayRemaining( ostream & os = cout ) const;
   void _Step( );
+  void _Skip( int cycles );
+  bool Idle( ) const;
+
+  int NumNodes() const {
+    return _nodes;
+  }
+
+  // Flits of the packets waiting to be injected at a node, and flits in the network
+  int WaitingFlits(int node) const {
+    int flits = 0;
+    for (int c = 0; c < _classes; ++c) {
+      flits += _partial_packets[node][c].size();
+    }
+    return flits;
+  }
+  int InFlightFlits() const {
+    int flits = 0;
+    for (int c = 0; c < _classes; ++c) {
+      flits += _total_in_flight_flits[c].size();
+    }
+    return flits;
+  }
+
   static TrafficManager * New(Configuration const & config, 
 			      vector<Network *> const & net);
 
@@ -311,7 +342,12 @@ public:
   virtual void DisplayOverallStatsCSV( ostream & os = cout ) const ;
   virtual bool flitsDrained() { return true; };
 
+  // Saves or loads the queues, the flits in flight and the statistics, then
+  // the networks
+  virtual void Checkpoint( spatial::StateArchive & ar );
+
   inline int getTime() { return _time;}
+  void SetEventLog(spatial::LogSink * log) { _event_log = log; }
   Stats * getStats(const string & name) { return _stats[name]; }
 
 };
@@ -335,8 +371,7 @@ public:
     _deadlock_timer = 0;
     FocusFlit* ff = static_cast<FocusFlit*>(f);
     assert(ff->IsRealFlit());
-    assert(_total_in_flight_flits[f->cl].count(f->id) > 0);
-    _total_in_flight_flits[f->cl].erase(f->id);
+    _total_in_flight_flits[f->cl].Erase(f);
 
     if ( f->watch ) { 
       *gWatchOut << GetSimTime() << " | "
@@ -360,13 +395,16 @@ public:
       err << "Flit " << f->id << " arrived at incorrect output " << dest;
       Error( err.str( ) );
     }
+
+    // Nothing refers to a retired flit any more (the measured set only keeps 
+    // its id for the stats), so it goes straight back to the pool
+    f->Free();
   }
 
   // Get routers from the network
   const vector<vector<Router*> >& getRouters() const {
     return _router;
   }
-
 };
 
 template<class T>
@@ -379,6 +417,7 @@ ostream & operator<<(ostream & os, const vector<T> & v) {
 }
 
 
-extern TrafficManager* trafficManager;
+// the traffic manager of the current simulation
+#define trafficManager (spatial::SimContext::Current()->traffic_manager)
 
 #endif
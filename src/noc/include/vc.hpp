@@ -133,6 +133,8 @@ public:
   void SetWatch( bool watch = true );
   bool IsWatched( ) const;
   virtual void Display( ostream & os = cout );
+
+  virtual void Checkpoint( spatial::StateArchive & ar );
 };
 
 
@@ -154,12 +156,18 @@ public:
     _multi_outputs.clear();
   }
 
-  inline std::vector<pair<int, int>> getMultiOutputs() {
+  // Added in ascending order of output ports
+  inline const std::vector<pair<int, int> > & getMultiOutputs() const {
     return _multi_outputs;
-  }  
+  }
+
+  int getPortTarget(int out_port) const {
+    return _route_set->getPortTarget(out_port);
+  }
 
-  const map<int, int> getPortTargetMap() {
-    return _route_set->getPortTargetMap();
+  virtual void Checkpoint( spatial::StateArchive & ar ) override {
+    VC::Checkpoint(ar);
+    ar & _multi_outputs;
   }
 
   virtual void Display( ostream & os = cout ) override {
@@ -37,7 +37,9 @@
 
 #define DRAGON_LATENCY
 
-int gP, gA, gG;
+#define gP (spatial::SimContext::Current()->p)
+#define gA (spatial::SimContext::Current()->a)
+#define gG (spatial::SimContext::Current()->g)
 
 //calculate the hop count between src and estination
 int dragonflynew_hopcnt(int src, int dest) 
@@ -121,6 +121,9 @@ Network * Network::New(const Configuration & config, const string & name)
   if ( n && ( config.GetInt( "link_failures" ) > 0 ) ) {
     n->InsertRandomFaults( config );
   }
+  if ( n ) {
+    n->SetThreads( 1 );
+  }
   return n;
 }
 
@@ -179,31 +182,183 @@ void Network::_Alloc( )
   }
 }
 
-void Network::ReadInputs( )
+// Runs a phase on every partition. The workers act on behalf of the 
+// simulation of the calling thread.
+void Network::_RunPartitions( void (Network::*phase)( int ) )
 {
-  for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
-      iter != _timed_modules.end();
-      ++iter) {
-    (*iter)->ReadInputs( );
+  if ( !_pool ) {
+    ActiveSet::Worker( ) = 0;
+    (this->*phase)( 0 );
+    return;
   }
+  spatial::SimContext * const context = spatial::SimContext::Current();
+  _pool->run([this, phase, context](int p) {
+    spatial::SimContext::Scope scope(context);
+    ActiveSet::Worker( ) = p;
+    (this->*phase)( p );
+  });
 }
 
-void Network::Evaluate( )
+// The active modules of the partition are collected at the start of a cycle
+void Network::_ReadInputs( int p )
 {
-  for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
-      iter != _timed_modules.end();
-      ++iter) {
-    (*iter)->Evaluate( );
+  _active_set.Collect(p);
+  for ( TimedModule * m : _active_set.Stepped(p, ROUTERS) ) {
+    m->ReadInputs( );
+  }
+  int const now = GetSimTime( );
+  for ( TimedModule * m : _active_set.Stepped(p, FLIT_CHANNELS) ) {
+    static_cast<FlitChannel *>(m)->Accept(now);
+  }
+  for ( TimedModule * m : _active_set.Stepped(p, CREDIT_CHANNELS) ) {
+    static_cast<CreditChannel *>(m)->Accept(now);
+  }
+}
+
+// Channels have nothing to evaluate
+void Network::_Evaluate( int p )
+{
+  for ( TimedModule * m : _active_set.Stepped(p, ROUTERS) ) {
+    m->Evaluate( );
+  }
+}
+
+void Network::_WriteOutputs( int p )
+{
+  for ( TimedModule * m : _active_set.Stepped(p, ROUTERS) ) {
+    m->WriteOutputs( );
+  }
+  int const now = GetSimTime( );
+  for ( TimedModule * m : _active_set.Stepped(p, FLIT_CHANNELS) ) {
+    static_cast<FlitChannel *>(m)->Deliver(now);
+  }
+  for ( TimedModule * m : _active_set.Stepped(p, CREDIT_CHANNELS) ) {
+    static_cast<CreditChannel *>(m)->Deliver(now);
   }
 }
 
+void Network::ReadInputs( )
+{
+  _RunPartitions(&Network::_ReadInputs);
+}
+
+void Network::Evaluate( )
+{
+  _RunPartitions(&Network::_Evaluate);
+}
+
 void Network::WriteOutputs( )
 {
-  for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
-      iter != _timed_modules.end();
-      ++iter) {
-    (*iter)->WriteOutputs( );
+  _RunPartitions(&Network::_WriteOutputs);
+  _active_set.Step( );
+}
+
+bool Network::Idle( ) const
+{
+  return _active_set.Idle( );
+}
+
+void Network::Skip( int cycles )
+{
+  _active_set.Skip( cycles );
+}
+
+template<class T>
+static void CheckpointChannels( spatial::StateArchive & ar, vector<T *> & channels )
+{
+  ar.Check((int)channels.size(), "the number of channels");
+  for ( size_t c = 0; c < channels.size(); ++c ) {
+    channels[c]->Checkpoint(ar);
+  }
+}
+
+void Network::Checkpoint( spatial::StateArchive & ar )
+{
+  _active_set.CatchUp( );
+  ar.Check(_size, "the number of routers");
+  for ( int r = 0; r < _size; ++r ) {
+    _routers[r]->Checkpoint(ar);
+  }
+  CheckpointChannels(ar, _inject);
+  CheckpointChannels(ar, _inject_cred);
+  CheckpointChannels(ar, _eject);
+  CheckpointChannels(ar, _eject_cred);
+  CheckpointChannels(ar, _chan);
+  CheckpointChannels(ar, _chan_cred);
+  if ( ar.loading() ) {
+    _active_set.WakeAll( );
+  }
+}
+
+void Network::SetThreads( int threads )
+{
+  threads = min(threads, _size);
+  if ( threads <= 1 ) {
+    _pool = nullptr;
+    _Partition(1);
+  } else {
+    _pool = make_shared<spatial::WorkerPool>(threads);
+    _Partition(threads);
+  }
+  _active_set.Reset(_partitions);
+  // Only partitions evaluated on several threads touch the pools at once
+  spatial::SimContext * const context = spatial::SimContext::Current();
+  context->flit_pool.SetShared(_pool != nullptr);
+  context->credit_pool.SetShared(_pool != nullptr);
+}
+
+/* Routers are split into contiguous id ranges, which are bands of rows for
+ * meshes and tori. A channel goes with the router driving it (the sink router
+ * for injection channels), and a credit channel goes with its flit channel.
+ */
+void Network::_Partition( int parts )
+{
+  vector<int> owner(_size, 0);
+  for ( int p = 0; p < parts && _pool; ++p ) {
+    int begin, end;
+    _pool->range(p, _size, begin, end);
+    for ( int r = begin; r < end; ++r ) {
+      owner[r] = p;
+    }
+  }
+
+  _partitions.assign(parts, vector<vector<TimedModule *> >(MODULE_GROUPS));
+  if ( parts == 1 ) {
+    // Routers go in the order the topology registered them, as always
+    for ( TimedModule * m : _timed_modules ) {
+      if ( dynamic_cast<Router *>(m) ) {
+        _partitions[0][ROUTERS].push_back(m);
+      }
+    }
+  } else {
+    for ( int r = 0; r < _size; ++r ) {
+      _partitions[owner[r]][ROUTERS].push_back(_routers[r]);
+    }
+  }
+  for ( int s = 0; s < _nodes; ++s ) {
+    int const p = owner[_inject[s]->GetSink()->GetID()];
+    _partitions[p][FLIT_CHANNELS].push_back(_inject[s]);
+    _partitions[p][CREDIT_CHANNELS].push_back(_inject_cred[s]);
+  }
+  for ( int d = 0; d < _nodes; ++d ) {
+    int const p = owner[_eject[d]->GetSource()->GetID()];
+    _partitions[p][FLIT_CHANNELS].push_back(_eject[d]);
+    _partitions[p][CREDIT_CHANNELS].push_back(_eject_cred[d]);
+  }
+  for ( int c = 0; c < _channels; ++c ) {
+    Router const * const source = _chan[c]->GetSource();
+    int const p = source ? owner[source->GetID()] : 0;
+    _partitions[p][FLIT_CHANNELS].push_back(_chan[c]);
+    _partitions[p][CREDIT_CHANNELS].push_back(_chan_cred[c]);
+  }
+
+  size_t total = 0;
+  for ( int p = 0; p < parts; ++p ) {
+    for ( int g = 0; g < MODULE_GROUPS; ++g ) {
+      total += _partitions[p][g].size();
+    }
   }
+  assert(total == _timed_modules.size());
 }
 
 void Network::WriteFlit( Flit *f, int source )
@@ -30,6 +30,7 @@
 
 #include <vector>
 #include <deque>
+#include <memory>
 
 #include "module.hpp"
 #include "flit.hpp"
@@ -37,10 +38,12 @@
 #include "router.hpp"
 #include "module.hpp"
 #include "timed_module.hpp"
+#include "active_set.hpp"
 #include "flitchannel.hpp"
 #include "channel.hpp"
 #include "config_utils.hpp"
 #include "globals.hpp"
+#include "worker_pool.hpp"
 
 typedef Channel<Credit> CreditChannel;
 
@@ -66,10 +69,27 @@ protected:
 
   deque<TimedModule *> _timed_modules;
 
+  // Parallel two-phase evaluation: each partition holds a region of routers 
+  // and the channels they drive. Modules of one phase touch disjoint state, 
+  // so the partitions are evaluated concurrently with a barrier in between.
+  // Without a pool, all modules are in a single partition.
+  shared_ptr<spatial::WorkerPool> _pool;
+
+  // Only the modules of each partition with something to do are stepped,
+  // the channels of a kind in a pass of direct calls
+  enum { ROUTERS, FLIT_CHANNELS, CREDIT_CHANNELS, MODULE_GROUPS };
+  vector<vector<vector<TimedModule *> > > _partitions;
+  ActiveSet _active_set;
+
   virtual void _ComputeSize( const Configuration &config ) = 0;
   virtual void _BuildNet( const Configuration &config ) = 0;
 
   void _Alloc( );
+  void _Partition( int parts );
+  void _RunPartitions( void (Network::*phase)( int ) );
+  void _ReadInputs( int p );
+  void _Evaluate( int p );
+  void _WriteOutputs( int p );
 
 public:
   Network( const Configuration &config, const string & name );
@@ -93,6 +113,14 @@ public:
   virtual void ReadInputs( );
   virtual void Evaluate( );
   virtual void WriteOutputs( );
+  virtual bool Idle( ) const;
+  virtual void Skip( int cycles );
+
+  void SetThreads( int threads );
+
+  // The routers, then every channel; the flits and credits in flight are 
+  // written with the first module holding them
+  void Checkpoint( spatial::StateArchive & ar );
 
   void Display( ostream & os = cout ) const;
   void DumpChannelMap( ostream & os = cout, string const & prefix = "" ) const;
@@ -155,6 +155,8 @@ int noc_main( int argc, char **argv )
 {
 
   BookSimConfig config;
+  spatial::SimContext context;
+  spatial::SimContext::Scope scope(&context);
   std::srand(1234);
 
   if ( !ParseArgs( &config, argc - 1, argv ) ) {
@@ -169,14 +171,7 @@ int noc_main( int argc, char **argv )
   gPrintActivity = (config.GetInt("print_activity") > 0);
   gTrace = (config.GetInt("viewer_trace") > 0);
   
-  string watch_out_file = config.GetStr( "watch_out" );
-  if(watch_out_file == "") {
-    gWatchOut = NULL;
-  } else if(watch_out_file == "-") {
-    gWatchOut = &cout;
-  } else {
-    gWatchOut = new ofstream(watch_out_file.c_str());
-  }
+  spatial::SimContext::Current()->SetWatchOut(config.GetStr( "watch_out" ));
   
 
   /*configure and run the simulator
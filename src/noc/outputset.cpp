@@ -33,8 +33,8 @@
  *
  */
 
+#include <algorithm>
 #include <cassert>
-#include <map>
 
 #include "booksim.hpp"
 #include "outputset.hpp"
@@ -58,7 +58,7 @@ void OutputSet::AddRange( int output_port, int vc_start, int vc_end, int pri )
   s.vc_end   = vc_end;
   s.pri      = pri;
   s.output_port = output_port;
-  _outputs.insert( s );
+  _Insert( s );
 }
 
 void OutputSet::AddRangeWithTarget( int target, int output_port, int vc_start, int vc_end, int pri)
@@ -70,14 +70,23 @@ void OutputSet::AddRangeWithTarget( int target, int output_port, int vc_start, i
   s.pri      = pri;
   s.output_port = output_port;
   s.target = target;
-  _outputs.insert( s );
+  _Insert( s );
+}
+
+// Elements usually come in order, so this mostly appends
+void OutputSet::_Insert( sSetElement const & s )
+{
+  vector<sSetElement>::iterator i = lower_bound( _outputs.begin( ), _outputs.end( ), s );
+  if ( ( i == _outputs.end( ) ) || ( s < *i ) ) {
+    _outputs.insert( i, s );
+  }
 }
 
 //legacy support, for performance, just use GetSet()
 int OutputSet::NumVCs( int output_port ) const
 {
   int total = 0;
-  set<sSetElement>::const_iterator i = _outputs.begin( );
+  vector<sSetElement>::const_iterator i = _outputs.begin( );
   while(i!=_outputs.end( )){
     if(i->output_port == output_port){
       total += (i->vc_end - i->vc_start + 1);
@@ -89,7 +98,7 @@ int OutputSet::NumVCs( int output_port ) const
 
 bool OutputSet::OutputEmpty( int output_port ) const
 {
-  set<sSetElement>::const_iterator i = _outputs.begin( );
+  vector<sSetElement>::const_iterator i = _outputs.begin( );
   while(i!=_outputs.end( )){
     if(i->output_port == output_port){
       return false;
@@ -100,18 +109,20 @@ bool OutputSet::OutputEmpty( int output_port ) const
 }
 
 
-const set<OutputSet::sSetElement> & OutputSet::GetSet() const{
+const vector<OutputSet::sSetElement> & OutputSet::GetSet() const{
   return _outputs;
 }
 
 // One destination, one output port 
-const map<int, int> OutputSet::getPortTargetMap() const {
-  map<int, int> ret;
+int OutputSet::getPortTarget( int output_port ) const {
   for (const sSetElement& s: _outputs) {
-    assert(s.target >= 0);
-    ret.insert(make_pair(s.output_port, s.target));
+    if (s.output_port == output_port) {
+      assert(s.target >= 0);
+      return s.target;
+    }
   }
-  return ret;
+  assert(false);
+  return -1;
 }
 
 //legacy support, for performance, just use GetSet()
@@ -124,7 +135,7 @@ int OutputSet::GetVC( int output_port, int vc_index, int *pri ) const
   
   if ( pri ) { *pri = -1; }
 
-  set<sSetElement>::const_iterator i = _outputs.begin( );
+  vector<sSetElement>::const_iterator i = _outputs.begin( );
   while(i!=_outputs.end( )){
     if(i->output_port == output_port){
       range = i->vc_end - i->vc_start + 1;
@@ -151,7 +162,7 @@ bool OutputSet::GetPortVC( int *out_port, int *out_vc ) const
   bool single_output = false;
   int  used_outputs  = 0;
 
-  set<sSetElement>::const_iterator i = _outputs.begin( );
+  vector<sSetElement>::const_iterator i = _outputs.begin( );
   if(i!=_outputs.end( )){
     used_outputs = i->output_port;
   }
@@ -31,6 +31,8 @@
 #include <vector>
 #include <iostream>
 
+#include "state_archive.hpp"
+
 using namespace std;
 
 class Flit;
@@ -60,6 +62,7 @@ public:
     return _classes;
   }
   void display(ostream & os) const;
+  void Checkpoint( spatial::StateArchive & ar ) { ar & _cycles & _reads & _writes; }
 
 } ;
 
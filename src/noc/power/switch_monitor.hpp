@@ -31,6 +31,8 @@
 #include <vector>
 #include <iostream>
 
+#include "state_archive.hpp"
+
 using namespace std;
 
 class Flit;
@@ -59,6 +61,7 @@ public:
   }
   void traversal( int input, int output, Flit const * f ) ;
   void display(ostream & os) const;
+  void Checkpoint( spatial::StateArchive & ar ) { ar & _cycles & _event; }
 } ;
 
 ostream & operator<<( ostream & os, SwitchMonitor const & obj ) ;
@@ -26,21 +26,80 @@
 */
 
 #include "random_utils.hpp"
+#include "globals.hpp"
 #include <algorithm>
 #include <cassert>
 
-extern long ran_x[];
-extern double ran_u[];
-#define KK 100
+// Until they are seeded, the generators point at their dummy sentinels, and
+// the first draw seeds them with Knuth's default
+RandomState::RandomState( ) {
+  std::fill(x, x + LONG_LAG, 0);
+  std::fill(u, u + LONG_LAG, 0.0);
+  arr_dummy = arr_started = -1;
+  farr_dummy = farr_started = -1.0;
+  arr_ptr = &arr_dummy;
+  farr_ptr = &farr_dummy;
+}
+
+// The cursors point into the state itself, so they're rebased onto the copy
+RandomState & RandomState::operator=( RandomState const & other ) {
+  std::copy(other.x, other.x + LONG_LAG, x);
+  std::copy(other.arr_buf, other.arr_buf + BUFFER_SIZE, arr_buf);
+  arr_dummy = other.arr_dummy;
+  arr_started = other.arr_started;
+  if ( other.arr_ptr == &other.arr_dummy ) {
+    arr_ptr = &arr_dummy;
+  } else if ( other.arr_ptr == &other.arr_started ) {
+    arr_ptr = &arr_started;
+  } else {
+    arr_ptr = arr_buf + (other.arr_ptr - other.arr_buf);
+  }
+
+  std::copy(other.u, other.u + LONG_LAG, u);
+  std::copy(other.farr_buf, other.farr_buf + BUFFER_SIZE, farr_buf);
+  farr_dummy = other.farr_dummy;
+  farr_started = other.farr_started;
+  if ( other.farr_ptr == &other.farr_dummy ) {
+    farr_ptr = &farr_dummy;
+  } else if ( other.farr_ptr == &other.farr_started ) {
+    farr_ptr = &farr_started;
+  } else {
+    farr_ptr = farr_buf + (other.farr_ptr - other.farr_buf);
+  }
+  return *this;
+}
+
+// Cursors are written as -1 for the dummy, -2 for the started sentinel, or
+// their offset into the buffer
+template<class T>
+static void CheckpointCursor( spatial::StateArchive & ar, T * & ptr, T * buf, T & dummy, T & started ) {
+  long offset = ( ptr == &dummy ) ? -1 : ( ptr == &started ) ? -2 : ( ptr - buf );
+  ar & offset;
+  if ( ar.loading() ) {
+    if ( offset < -2 || offset >= RandomState::BUFFER_SIZE ) {
+      throw std::string("The checkpoint has a corrupt random state");
+    }
+    ptr = ( offset == -1 ) ? &dummy : ( offset == -2 ) ? &started : ( buf + offset );
+  }
+}
+
+void RandomState::Checkpoint( spatial::StateArchive & ar ) {
+  ar & x & arr_buf & arr_dummy & arr_started;
+  CheckpointCursor(ar, arr_ptr, arr_buf, arr_dummy, arr_started);
+  ar & u & farr_buf & farr_dummy & farr_started;
+  CheckpointCursor(ar, farr_ptr, farr_buf, farr_dummy, farr_started);
+}
 
 void SaveRandomState( std::vector<long> & save_x, std::vector<double> & save_u ) {
-  save_x.assign(ran_x, ran_x + KK);
-  save_u.assign(ran_u, ran_u + KK);
+  RandomState const & state = spatial::SimContext::Current()->random;
+  save_x.assign(state.x, state.x + RandomState::LONG_LAG);
+  save_u.assign(state.u, state.u + RandomState::LONG_LAG);
 }
 
 void RestoreRandomState( std::vector<long> const & save_x, std::vector<double> const & save_u) {
-  assert(save_x.size() == KK);
-  std::copy(save_x.begin(), save_x.end(), ran_x);
-  assert(save_u.size() == KK);
-  std::copy(save_u.begin(), save_u.end(), ran_u);
+  RandomState & state = spatial::SimContext::Current()->random;
+  assert(save_x.size() == RandomState::LONG_LAG);
+  std::copy(save_x.begin(), save_x.end(), state.x);
+  assert(save_u.size() == RandomState::LONG_LAG);
+  std::copy(save_u.begin(), save_u.end(), state.u);
 }
@@ -21,7 +21,11 @@
 #define LL  37                     /* the short lag */
 #define mod_sum(x,y) (((x)+(y))-(int)((x)+(y)))   /* (x+y) mod 1.0 */
 
+#ifdef RAN_STATE                   /* booksim: kept per simulation, see RandomState */
+#define ran_u (RAN_STATE.u)
+#else
 double ran_u[KK];           /* the generator state */
+#endif
 
 #ifdef __STDC__
 void ranf_array(double aa[], int n)
@@ -42,9 +46,16 @@ void ranf_array(aa,n)    /* put n new random fractions in aa */
 /* after calling ranf_start, get new randoms by, e.g., "x=ranf_arr_next()" */
 
 #define QUALITY 1009 /* recommended quality level for high-res use */
+#ifdef RAN_STATE
+#define ranf_arr_buf (RAN_STATE.farr_buf)
+#define ranf_arr_dummy (RAN_STATE.farr_dummy)
+#define ranf_arr_started (RAN_STATE.farr_started)
+#define ranf_arr_ptr (RAN_STATE.farr_ptr)
+#else
 double ranf_arr_buf[QUALITY];
 double ranf_arr_dummy=-1.0, ranf_arr_started=-1.0;
 double *ranf_arr_ptr=&ranf_arr_dummy; /* the next random fraction, or -1 */
+#endif
 
 #define TT  70   /* guaranteed separation between streams */
 #define is_odd(s) ((s)&1)
@@ -25,6 +25,10 @@
  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include "globals.hpp"
+
+// Draw from the generators of the current simulation
+#define RAN_STATE (spatial::SimContext::Current()->random)
 #define main rng_double_main
 #include "rng-double.c"
 
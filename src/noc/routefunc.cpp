@@ -51,23 +51,17 @@
 #include "qtree.hpp"
 #include "cmesh.hpp"
 
-map<string, tRoutingFunction> gRoutingFunctionMap;
+#include <mutex>
 
-/* Global information used by routing functions */
+// Filled once per process, read by every simulation
+map<string, tRoutingFunction> gRoutingFunctionMap;
 
-int gNumVCs;
+/* Global information used by routing functions, kept per simulation */
 
 /* Add more functions here
  *
  */
 
-// ============================================================
-//  Balfour-Schultz
-int gReadReqBeginVC, gReadReqEndVC;
-int gWriteReqBeginVC, gWriteReqEndVC;
-int gReadReplyBeginVC, gReadReplyEndVC;
-int gWriteReplyBeginVC, gWriteReplyEndVC;
-
 // ============================================================
 //  QTree: Nearest Common Ancestor
 // ===
@@ -460,8 +454,6 @@ void fattree_anca(const Router *r, const Flit *f,
 //         pick xy or yx min routing adaptively at the source router
 // ===
 
-int dor_next_mesh(int cur, int dest, bool descending = false);
-
 void adaptive_xy_yx_mesh(const Router *r, const Flit *f,
                          int in_channel, OutputSet *outputs, bool inject)
 {
@@ -654,9 +646,11 @@ void src_routing_mesh(const Router* r, const Flit *f,
     outputs->AddRange(out_port, vcBegin, vcEnd);
   } else {
     FocusFlit* ff = static_cast<FocusFlit*>(const_cast<Flit*>(f));
-    vector<int> targets = ff->GetFanoutFlitTargets(r->GetID());
-    assert(targets.size() > 0 && targets.size() == ff->GetFanoutFlitNum(r->GetID()));
-    for (int t: targets) {
+    int targets[FocusFlit::MAX_FANOUT];
+    int target_num = ff->GetFanoutFlitTargets(r->GetID(), targets);
+    assert(target_num > 0 && target_num == ff->GetFanoutFlitNum(r->GetID()));
+    for (int i = 0; i < target_num; ++i) {
+      int t = targets[i];
       int out_port;
       int const available_vcs = (vcEnd - vcBegin + 1) / 2;
       // bool x_then_y = ((in_channel < 2 * gN) ? (f->vc < (vcBegin + available_vcs)) : (RandomInt(1) > 0));
@@ -676,7 +670,7 @@ void src_routing_mesh(const Router* r, const Flit *f,
       }
       outputs->AddRangeWithTarget(t, out_port, vcBegin + (x_then_y ? 0 : available_vcs), vcEnd + (x_then_y ? -available_vcs : 0));
     }
-    if (outputs->GetSet().size() != targets.size()) {
+    if (outputs->GetSet().size() != target_num) {
       std::cerr << "ERROR | The branching tree is constructed wrongly: the splitted flits at router " << r->GetID() \
                 << " have the same output port" << std::endl;
       // assert(false);
@@ -690,42 +684,43 @@ void src_routing_mesh(const Router* r, const Flit *f,
 
 //=============================================================
 
-int dor_next_mesh(int cur, int dest, bool descending)
+// Dimension-order routing on a k-ary n-mesh of the given number of nodes
+static int dor_next_mesh(int k, int n, int nodes, int cur, int dest, bool descending)
 {
   if (cur == dest)
   {
-    return 2 * gN; // Eject
+    return 2 * n; // Eject
   }
 
   int dim_left;
 
   if (descending)
   {
-    for (dim_left = (gN - 1); dim_left > 0; --dim_left)
+    for (dim_left = (n - 1); dim_left > 0; --dim_left)
     {
-      if ((cur * gK / gNodes) != (dest * gK / gNodes))
+      if ((cur * k / nodes) != (dest * k / nodes))
       {
         break;
       }
-      cur = (cur * gK) % gNodes;
-      dest = (dest * gK) % gNodes;
+      cur = (cur * k) % nodes;
+      dest = (dest * k) % nodes;
     }
-    cur = (cur * gK) / gNodes;
-    dest = (dest * gK) / gNodes;
+    cur = (cur * k) / nodes;
+    dest = (dest * k) / nodes;
   }
   else
   {
-    for (dim_left = 0; dim_left < (gN - 1); ++dim_left)
+    for (dim_left = 0; dim_left < (n - 1); ++dim_left)
     {
-      if ((cur % gK) != (dest % gK))
+      if ((cur % k) != (dest % k))
       {
         break;
       }
-      cur /= gK;
-      dest /= gK;
+      cur /= k;
+      dest /= k;
     }
-    cur %= gK;
-    dest %= gK;
+    cur %= k;
+    dest %= k;
   }
 
   if (cur < dest)
@@ -738,6 +733,21 @@ int dor_next_mesh(int cur, int dest, bool descending)
   }
 }
 
+// Ascending routes are looked up in the table InitializeRoutingMap built for
+// the mesh, if it did
+int dor_next_mesh(int cur, int dest, bool descending)
+{
+  vector<unsigned char> const &table = gMeshNextPort;
+  if (!descending && !table.empty())
+  {
+    int const nodes = gNodes;
+    assert(table.size() == (size_t)nodes * nodes);
+    assert((cur >= 0) && (cur < nodes) && (dest >= 0) && (dest < nodes));
+    return table[cur * nodes + dest];
+  }
+  return dor_next_mesh(gK, gN, gNodes, cur, dest, descending);
+}
+
 //=============================================================
 
 void dor_next_torus(int cur, int dest, int in_port,
@@ -2383,6 +2393,52 @@ void chaos_mesh(const Router *r, const Flit *f,
 
 //=============================================================
 
+static void RegisterRoutingFunctions()
+{
+  /* Register routing functions here */
+
+  // ===================================================
+  // Balfour-Schultz
+  gRoutingFunctionMap["nca_fattree"] = &fattree_nca;
+  gRoutingFunctionMap["anca_fattree"] = &fattree_anca;
+  gRoutingFunctionMap["nca_qtree"] = &qtree_nca;
+  gRoutingFunctionMap["nca_tree4"] = &tree4_nca;
+  gRoutingFunctionMap["anca_tree4"] = &tree4_anca;
+  gRoutingFunctionMap["dor_mesh"] = &dim_order_mesh;
+  gRoutingFunctionMap["xy_yx_mesh"] = &xy_yx_mesh;
+  gRoutingFunctionMap["adaptive_xy_yx_mesh"] = &adaptive_xy_yx_mesh;
+  gRoutingFunctionMap["src_routing_mesh"] = &src_routing_mesh;
+  // End Balfour-Schultz
+  // ===================================================
+
+  gRoutingFunctionMap["dim_order_mesh"] = &dim_order_mesh;
+  gRoutingFunctionMap["dim_order_ni_mesh"] = &dim_order_ni_mesh;
+  gRoutingFunctionMap["dim_order_pni_mesh"] = &dim_order_pni_mesh;
+  gRoutingFunctionMap["dim_order_torus"] = &dim_order_torus;
+  gRoutingFunctionMap["dim_order_ni_torus"] = &dim_order_ni_torus;
+  gRoutingFunctionMap["dim_order_bal_torus"] = &dim_order_bal_torus;
+
+  gRoutingFunctionMap["romm_mesh"] = &romm_mesh;
+  gRoutingFunctionMap["romm_ni_mesh"] = &romm_ni_mesh;
+
+  gRoutingFunctionMap["min_adapt_mesh"] = &min_adapt_mesh;
+  gRoutingFunctionMap["min_adapt_torus"] = &min_adapt_torus;
+
+  gRoutingFunctionMap["planar_adapt_mesh"] = &planar_adapt_mesh;
+
+  // FIXME: This is broken.
+  //  gRoutingFunctionMap["limited_adapt_mesh"] = &limited_adapt_mesh;
+
+  gRoutingFunctionMap["valiant_mesh"] = &valiant_mesh;
+  gRoutingFunctionMap["valiant_torus"] = &valiant_torus;
+  gRoutingFunctionMap["valiant_ni_torus"] = &valiant_ni_torus;
+
+  gRoutingFunctionMap["dest_tag_fly"] = &dest_tag_fly;
+
+  gRoutingFunctionMap["chaos_mesh"] = &chaos_mesh;
+  gRoutingFunctionMap["chaos_torus"] = &chaos_torus;
+}
+
 void InitializeRoutingMap(const Configuration &config)
 {
 
@@ -2432,46 +2488,29 @@ void InitializeRoutingMap(const Configuration &config)
     gWriteReplyEndVC = gNumVCs - 1;
   }
 
-  /* Register routing functions here */
-
-  // ===================================================
-  // Balfour-Schultz
-  gRoutingFunctionMap["nca_fattree"] = &fattree_nca;
-  gRoutingFunctionMap["anca_fattree"] = &fattree_anca;
-  gRoutingFunctionMap["nca_qtree"] = &qtree_nca;
-  gRoutingFunctionMap["nca_tree4"] = &tree4_nca;
-  gRoutingFunctionMap["anca_tree4"] = &tree4_anca;
-  gRoutingFunctionMap["dor_mesh"] = &dim_order_mesh;
-  gRoutingFunctionMap["xy_yx_mesh"] = &xy_yx_mesh;
-  gRoutingFunctionMap["adaptive_xy_yx_mesh"] = &adaptive_xy_yx_mesh;
-  gRoutingFunctionMap["src_routing_mesh"] = &src_routing_mesh;
-  // End Balfour-Schultz
-  // ===================================================
-
-  gRoutingFunctionMap["dim_order_mesh"] = &dim_order_mesh;
-  gRoutingFunctionMap["dim_order_ni_mesh"] = &dim_order_ni_mesh;
-  gRoutingFunctionMap["dim_order_pni_mesh"] = &dim_order_pni_mesh;
-  gRoutingFunctionMap["dim_order_torus"] = &dim_order_torus;
-  gRoutingFunctionMap["dim_order_ni_torus"] = &dim_order_ni_torus;
-  gRoutingFunctionMap["dim_order_bal_torus"] = &dim_order_bal_torus;
-
-  gRoutingFunctionMap["romm_mesh"] = &romm_mesh;
-  gRoutingFunctionMap["romm_ni_mesh"] = &romm_ni_mesh;
-
-  gRoutingFunctionMap["min_adapt_mesh"] = &min_adapt_mesh;
-  gRoutingFunctionMap["min_adapt_torus"] = &min_adapt_torus;
-
-  gRoutingFunctionMap["planar_adapt_mesh"] = &planar_adapt_mesh;
-
-  // FIXME: This is broken.
-  //  gRoutingFunctionMap["limited_adapt_mesh"] = &limited_adapt_mesh;
-
-  gRoutingFunctionMap["valiant_mesh"] = &valiant_mesh;
-  gRoutingFunctionMap["valiant_torus"] = &valiant_torus;
-  gRoutingFunctionMap["valiant_ni_torus"] = &valiant_ni_torus;
-
-  gRoutingFunctionMap["dest_tag_fly"] = &dest_tag_fly;
+  //
+  // next hops of dimension-order routing on a mesh, a byte per router and
+  // destination, for meshes of up to 4096 nodes (16 MB)
+  //
+  gMeshNextPort.clear();
+  if (config.GetStr("topology") == "mesh")
+  {
+    int const k = config.GetInt("k");
+    int const n = config.GetInt("n");
+    int const nodes = powi(k, n);
+    if ((nodes <= 4096) && (2 * n < 256))
+    {
+      gMeshNextPort.resize((size_t)nodes * nodes);
+      for (int cur = 0; cur < nodes; ++cur)
+      {
+        for (int dest = 0; dest < nodes; ++dest)
+        {
+          gMeshNextPort[cur * nodes + dest] = dor_next_mesh(k, n, nodes, cur, dest, false);
+        }
+      }
+    }
+  }
 
-  gRoutingFunctionMap["chaos_mesh"] = &chaos_mesh;
-  gRoutingFunctionMap["chaos_torus"] = &chaos_torus;
+  static std::once_flag registered;
+  std::call_once(registered, RegisterRoutingFunctions);
 }
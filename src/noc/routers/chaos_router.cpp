@@ -668,6 +668,11 @@ void ChaosRouter::_SendCredits( )
   }
 }
 
+void ChaosRouter::Checkpoint( spatial::StateArchive & /* ar */ )
+{
+  throw string("Checkpoints are not supported by the chaos router");
+}
+
 void ChaosRouter::Display( ostream & os ) const
 {
 }
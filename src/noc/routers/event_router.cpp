@@ -740,6 +740,11 @@ void EventRouter::_SendCredits( )
   }
 }
 
+void EventRouter::Checkpoint( spatial::StateArchive & /* ar */ )
+{
+  throw string("Checkpoints are not supported by the event router");
+}
+
 void EventRouter::Display( ostream & os ) const
 {
   for ( int input = 0; input < _inputs; ++input ) {
@@ -182,6 +182,7 @@ public:
   virtual vector<int> MaxCredits() const { return vector<int>(); }
 
   void Display( ostream & os = cout ) const;
+  virtual void Checkpoint( spatial::StateArchive & ar );
 };
 
 #endif
@@ -180,6 +180,16 @@ IQRouter::IQRouter(Configuration const &config, Module *parent,
   _output_buffer.resize(_outputs);
   _credit_buffer.resize(_inputs);
 
+  // Pipeline queues hold every VC at most once, plus the one an update
+  // requeues before popping its entry
+  int const stage_capacity = _inputs * _vcs + 1;
+  _route_vcs = StageQueue(stage_capacity);
+  _vc_alloc_vcs = StageQueue(stage_capacity);
+  _sw_hold_vcs = StageQueue(stage_capacity);
+  _sw_alloc_vcs = StageQueue(stage_capacity);
+  _proc_credits = RingQueue<pair<int, pair<Credit *, int> > >(_outputs * (_credit_delay + 1));
+  _crossbar_flits = RingQueue<pair<int, pair<Flit *, pair<int, int> > > >(_outputs * _output_speedup * (_crossbar_delay + 1));
+
   // Switch configuration (when held for multiple cycles)
   _hold_switch_for_packet = (config.GetInt("hold_switch_for_packet") > 0);
   _switch_hold_in.resize(_inputs * _input_speedup, -1);
@@ -318,6 +328,29 @@ void IQRouter::WriteOutputs()
   _SendCredits();
 }
 
+bool IQRouter::Idle() const
+{
+  if (_active || !_in_queue_flits.empty() || !_proc_credits.empty() || !_out_queue_credits.empty())
+  {
+    return false;
+  }
+  for (int output = 0; output < _outputs; ++output)
+  {
+    if (!_output_buffer[output].empty())
+    {
+      return false;
+    }
+  }
+  for (int input = 0; input < _inputs; ++input)
+  {
+    if (!_credit_buffer[input].empty())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
 //------------------------------------------------------------------------------
 // read inputs
 //------------------------------------------------------------------------------
@@ -424,7 +457,7 @@ void IQRouter::_InputQueuing()
       if (_routing_delay)
       {
         cur_buf->SetState(vc, VC::routing);
-        _route_vcs.push_back(make_pair(-1, make_pair(input, vc)));
+        _route_vcs.push_back(input, vc);
       }
       else
       {
@@ -440,13 +473,11 @@ void IQRouter::_InputQueuing()
         cur_buf->SetState(vc, VC::vc_alloc);
         if (_speculative)
         {
-          _sw_alloc_vcs.push_back(make_pair(-1, make_pair(make_pair(input, vc),
-                                                          -1)));
+          _sw_alloc_vcs.push_back(input, vc);
         }
         if (_vc_allocator)
         {
-          _vc_alloc_vcs.push_back(make_pair(-1, make_pair(make_pair(input, vc),
-                                                          -1)));
+          _vc_alloc_vcs.push_back(input, vc);
         }
         if (_noq)
         {
@@ -459,13 +490,11 @@ void IQRouter::_InputQueuing()
     {
       if (_switch_hold_vc[input * _input_speedup + vc % _input_speedup] == vc)
       {
-        _sw_hold_vcs.push_back(make_pair(-1, make_pair(make_pair(input, vc),
-                                                       -1)));
+        _sw_hold_vcs.push_back(input, vc);
       }
       else
       {
-        _sw_alloc_vcs.push_back(make_pair(-1, make_pair(make_pair(input, vc),
-                                                        -1)));
+        _sw_alloc_vcs.push_back(input, vc);
       }
     }
   }
@@ -516,21 +545,19 @@ void IQRouter::_RouteEvaluate()
 {
   assert(_routing_delay);
 
-  for (deque<pair<int, pair<int, int>>>::iterator iter = _route_vcs.begin();
-       iter != _route_vcs.end();
-       ++iter)
+  for (int i = 0; i < _route_vcs.size(); ++i)
   {
 
-    int const time = iter->first;
+    int const time = _route_vcs.time(i);
     if (time >= 0)
     {
       break;
     }
-    iter->first = GetSimTime() + _routing_delay - 1;
+    _route_vcs.time(i) = GetSimTime() + _routing_delay - 1;
 
-    int const input = iter->second.first;
+    int const input = _route_vcs.input(i);
     assert((input >= 0) && (input < _inputs));
-    int const vc = iter->second.second;
+    int const vc = _route_vcs.vc(i);
     assert((vc >= 0) && (vc < _vcs));
 
     Buffer const *const cur_buf = _buf[input];
@@ -560,18 +587,16 @@ void IQRouter::_RouteUpdate()
   while (!_route_vcs.empty())
   {
 
-    pair<int, pair<int, int>> const &item = _route_vcs.front();
-
-    int const time = item.first;
+    int const time = _route_vcs.time(0);
     if ((time < 0) || (GetSimTime() < time))
     {
       break;
     }
     assert(GetSimTime() == time);
 
-    int const input = item.second.first;
+    int const input = _route_vcs.input(0);
     assert((input >= 0) && (input < _inputs));
-    int const vc = item.second.second;
+    int const vc = _route_vcs.vc(0);
     assert((vc >= 0) && (vc < _vcs));
 
     Buffer *const cur_buf = _buf[input];
@@ -596,11 +621,11 @@ void IQRouter::_RouteUpdate()
     cur_buf->SetState(vc, VC::vc_alloc);
     if (_speculative)
     {
-      _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second, -1)));
+      _sw_alloc_vcs.push_back(input, vc);
     }
     if (_vc_allocator)
     {
-      _vc_alloc_vcs.push_back(make_pair(-1, make_pair(item.second, -1)));
+      _vc_alloc_vcs.push_back(input, vc);
     }
     // NOTE: No need to handle NOQ here, as it requires lookahead routing!
     _route_vcs.pop_front();
@@ -617,23 +642,21 @@ void IQRouter::_VCAllocEvaluate()
 
   bool watched = false;
 
-  for (deque<pair<int, pair<pair<int, int>, int>>>::iterator iter = _vc_alloc_vcs.begin();
-       iter != _vc_alloc_vcs.end();
-       ++iter)
+  for (int i = 0; i < _vc_alloc_vcs.size(); ++i)
   {
 
-    int const time = iter->first;
+    int const time = _vc_alloc_vcs.time(i);
     if (time >= 0)
     {
       break;
     }
 
-    int const input = iter->second.first.first;
+    int const input = _vc_alloc_vcs.input(i);
     assert((input >= 0) && (input < _inputs));
-    int const vc = iter->second.first.second;
+    int const vc = _vc_alloc_vcs.vc(i);
     assert((vc >= 0) && (vc < _vcs));
 
-    assert(iter->second.second == -1);
+    assert(_vc_alloc_vcs.grant(i) == -1);
 
     Buffer const *const cur_buf = _buf[input];
     assert(!cur_buf->Empty(vc));
@@ -658,7 +681,7 @@ void IQRouter::_VCAllocEvaluate()
     assert(route_set);
 
     int const out_priority = cur_buf->GetPriority(vc);
-    set<OutputSet::sSetElement> const setlist = route_set->GetSet();
+    vector<OutputSet::sSetElement> const &setlist = route_set->GetSet();
 
     bool elig = false;
     bool cred = false;
@@ -666,7 +689,7 @@ void IQRouter::_VCAllocEvaluate()
 
     assert(!_noq || (setlist.size() == 1));
 
-    for (set<OutputSet::sSetElement>::const_iterator iset = setlist.begin();
+    for (vector<OutputSet::sSetElement>::const_iterator iset = setlist.begin();
          iset != setlist.end();
          ++iset)
     {
@@ -769,11 +792,11 @@ void IQRouter::_VCAllocEvaluate()
     }
     if (!elig)
     {
-      iter->second.second = STALL_BUFFER_BUSY;
+      _vc_alloc_vcs.grant(i) = STALL_BUFFER_BUSY;
     }
     else if (_vc_busy_when_full && !cred)
     {
-      iter->second.second = reserved ? STALL_BUFFER_RESERVED : STALL_BUFFER_FULL;
+      _vc_alloc_vcs.grant(i) = reserved ? STALL_BUFFER_RESERVED : STALL_BUFFER_FULL;
     }
   }
 
@@ -784,6 +807,7 @@ void IQRouter::_VCAllocEvaluate()
   }
 
   _vc_allocator->Allocate();
+  _vc_allocator->CountGrants();
 
   if (watched)
   {
@@ -791,29 +815,27 @@ void IQRouter::_VCAllocEvaluate()
     _vc_allocator->PrintGrants(gWatchOut);
   }
 
-  for (deque<pair<int, pair<pair<int, int>, int>>>::iterator iter = _vc_alloc_vcs.begin();
-       iter != _vc_alloc_vcs.end();
-       ++iter)
+  for (int i = 0; i < _vc_alloc_vcs.size(); ++i)
   {
 
-    int const time = iter->first;
+    int const time = _vc_alloc_vcs.time(i);
     if (time >= 0)
     {
       break;
     }
-    iter->first = GetSimTime() + _vc_alloc_delay - 1;
+    _vc_alloc_vcs.time(i) = GetSimTime() + _vc_alloc_delay - 1;
 
-    int const input = iter->second.first.first;
+    int const input = _vc_alloc_vcs.input(i);
     assert((input >= 0) && (input < _inputs));
-    int const vc = iter->second.first.second;
+    int const vc = _vc_alloc_vcs.vc(i);
     assert((vc >= 0) && (vc < _vcs));
 
-    if (iter->second.second < -1)
+    if (_vc_alloc_vcs.grant(i) < -1)
     {
       continue;
     }
 
-    assert(iter->second.second == -1);
+    assert(_vc_alloc_vcs.grant(i) == -1);
 
     Buffer const *const cur_buf = _buf[input];
     assert(!cur_buf->Empty(vc));
@@ -845,7 +867,7 @@ void IQRouter::_VCAllocEvaluate()
                    << "." << endl;
       }
 
-      iter->second.second = output_and_vc;
+      _vc_alloc_vcs.grant(i) = output_and_vc;
     }
     else
     {
@@ -858,7 +880,7 @@ void IQRouter::_VCAllocEvaluate()
                    << "." << endl;
       }
 
-      iter->second.second = STALL_BUFFER_CONFLICT;
+      _vc_alloc_vcs.grant(i) = STALL_BUFFER_CONFLICT;
     }
   }
 
@@ -869,21 +891,19 @@ void IQRouter::_VCAllocEvaluate()
 
   // Additional STALL type when vc_allocate takes more than one cycle.
   // Commonly, these codes will not be touched.
-  for (deque<pair<int, pair<pair<int, int>, int>>>::iterator iter = _vc_alloc_vcs.begin();
-       iter != _vc_alloc_vcs.end();
-       ++iter)
+  for (int i = 0; i < _vc_alloc_vcs.size(); ++i)
   {
 
-    int const time = iter->first;
+    int const time = _vc_alloc_vcs.time(i);
     assert(time >= 0);
     if (GetSimTime() < time)
     {
       break;
     }
 
-    assert(iter->second.second != -1);
+    assert(_vc_alloc_vcs.grant(i) != -1);
 
-    int const output_and_vc = iter->second.second;
+    int const output_and_vc = _vc_alloc_vcs.grant(i);
 
     if (output_and_vc >= 0)
     {
@@ -895,9 +915,9 @@ void IQRouter::_VCAllocEvaluate()
 
       BufferState const *const dest_buf = _next_buf[match_output];
 
-      int const input = iter->second.first.first;
+      int const input = _vc_alloc_vcs.input(i);
       assert((input >= 0) && (input < _inputs));
-      int const vc = iter->second.first.second;
+      int const vc = _vc_alloc_vcs.vc(i);
       assert((vc >= 0) && (vc < _vcs));
 
       Buffer const *const cur_buf = _buf[input];
@@ -920,7 +940,7 @@ void IQRouter::_VCAllocEvaluate()
                      << " at output " << match_output
                      << " is no longer available." << endl;
         }
-        iter->second.second = STALL_BUFFER_BUSY;
+        _vc_alloc_vcs.grant(i) = STALL_BUFFER_BUSY;
       }
       else if (_vc_busy_when_full && dest_buf->IsFullFor(match_vc))
       {
@@ -933,7 +953,7 @@ void IQRouter::_VCAllocEvaluate()
                      << " at output " << match_output
                      << " has become full." << endl;
         }
-        iter->second.second = dest_buf->IsFull() ? STALL_BUFFER_FULL : STALL_BUFFER_RESERVED;
+        _vc_alloc_vcs.grant(i) = dest_buf->IsFull() ? STALL_BUFFER_FULL : STALL_BUFFER_RESERVED;
       }
     }
   }
@@ -946,21 +966,19 @@ void IQRouter::_VCAllocUpdate()
   while (!_vc_alloc_vcs.empty())
   {
 
-    pair<int, pair<pair<int, int>, int>> const &item = _vc_alloc_vcs.front();
-
-    int const time = item.first;
+    int const time = _vc_alloc_vcs.time(0);
     if ((time < 0) || (GetSimTime() < time))
     {
       break;
     }
     assert(GetSimTime() == time);
 
-    int const input = item.second.first.first;
+    int const input = _vc_alloc_vcs.input(0);
     assert((input >= 0) && (input < _inputs));
-    int const vc = item.second.first.second;
+    int const vc = _vc_alloc_vcs.vc(0);
     assert((vc >= 0) && (vc < _vcs));
 
-    assert(item.second.second != -1);
+    assert(_vc_alloc_vcs.grant(0) != -1);
 
     Buffer *const cur_buf = _buf[input];
     assert(!cur_buf->Empty(vc));
@@ -980,7 +998,7 @@ void IQRouter::_VCAllocUpdate()
                  << ")." << endl;
     }
 
-    int const output_and_vc = item.second.second;
+    int const output_and_vc = _vc_alloc_vcs.grant(0);
 
     // If all oav are larger than 0
     if (output_and_vc >= 0)
@@ -1008,7 +1026,7 @@ void IQRouter::_VCAllocUpdate()
       cur_buf->SetState(vc, VC::active);
       if (!_speculative)
       {
-        _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first, -1)));
+        _sw_alloc_vcs.push_back(input, vc);
       }
     }
     else
@@ -1033,7 +1051,7 @@ void IQRouter::_VCAllocUpdate()
 #endif
     
       // Come on, try again !!
-      _vc_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first, -1)));
+      _vc_alloc_vcs.push_back(input, vc);
     }
     _vc_alloc_vcs.pop_front();
   }
@@ -1047,24 +1065,22 @@ void IQRouter::_SWHoldEvaluate()
 {
   assert(_hold_switch_for_packet);
 
-  for (deque<pair<int, pair<pair<int, int>, int>>>::iterator iter = _sw_hold_vcs.begin();
-       iter != _sw_hold_vcs.end();
-       ++iter)
+  for (int i = 0; i < _sw_hold_vcs.size(); ++i)
   {
 
-    int const time = iter->first;
+    int const time = _sw_hold_vcs.time(i);
     if (time >= 0)
     {
       break;
     }
-    iter->first = GetSimTime();
+    _sw_hold_vcs.time(i) = GetSimTime();
 
-    int const input = iter->second.first.first;
+    int const input = _sw_hold_vcs.input(i);
     assert((input >= 0) && (input < _inputs));
-    int const vc = iter->second.first.second;
+    int const vc = _sw_hold_vcs.vc(i);
     assert((vc >= 0) && (vc < _vcs));
 
-    assert(iter->second.second == -1);
+    assert(_sw_hold_vcs.grant(i) == -1);
 
     Buffer const *const cur_buf = _buf[input];
     assert(!cur_buf->Empty(vc));
@@ -1107,7 +1123,7 @@ void IQRouter::_SWHoldEvaluate()
                    << "." << (expanded_output % _output_speedup)
                    << ": No credit available." << endl;
       }
-      iter->second.second = dest_buf->IsFull() ? STALL_BUFFER_FULL : STALL_BUFFER_RESERVED;
+      _sw_hold_vcs.grant(i) = dest_buf->IsFull() ? STALL_BUFFER_FULL : STALL_BUFFER_RESERVED;
     }
     else
     {
@@ -1120,7 +1136,7 @@ void IQRouter::_SWHoldEvaluate()
                    << "." << (expanded_output % _output_speedup)
                    << "." << endl;
       }
-      iter->second.second = expanded_output;
+      _sw_hold_vcs.grant(i) = expanded_output;
     }
   }
 }
@@ -1132,21 +1148,19 @@ void IQRouter::_SWHoldUpdate()
   while (!_sw_hold_vcs.empty())
   {
 
-    pair<int, pair<pair<int, int>, int>> const &item = _sw_hold_vcs.front();
-
-    int const time = item.first;
+    int const time = _sw_hold_vcs.time(0);
     if (time < 0)
     {
       break;
     }
     assert(GetSimTime() == time);
 
-    int const input = item.second.first.first;
+    int const input = _sw_hold_vcs.input(0);
     assert((input >= 0) && (input < _inputs));
-    int const vc = item.second.first.second;
+    int const vc = _sw_hold_vcs.vc(0);
     assert((vc >= 0) && (vc < _vcs));
 
-    assert(item.second.second != -1);
+    assert(_sw_hold_vcs.grant(0) != -1);
 
     Buffer *const cur_buf = _buf[input];
     assert(!cur_buf->Empty(vc));
@@ -1168,7 +1182,7 @@ void IQRouter::_SWHoldUpdate()
     int const expanded_input = input * _input_speedup + vc % _input_speedup;
     assert(_switch_hold_vc[expanded_input] == vc);
 
-    int const expanded_output = item.second.second;
+    int const expanded_output = _sw_hold_vcs.grant(0);
 
     if (expanded_output >= 0 && (_output_buffer_size == -1 || _output_buffer[expanded_output / _output_speedup].size() < size_t(_output_buffer_size)))
     {
@@ -1309,7 +1323,7 @@ void IQRouter::_SWHoldUpdate()
           if (_routing_delay)
           {
             cur_buf->SetState(vc, VC::routing);
-            _route_vcs.push_back(make_pair(-1, item.second.first));
+            _route_vcs.push_back(input, vc);
           }
           else
           {
@@ -1325,13 +1339,11 @@ void IQRouter::_SWHoldUpdate()
             cur_buf->SetState(vc, VC::vc_alloc);
             if (_speculative)
             {
-              _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
-                                                              -1)));
+              _sw_alloc_vcs.push_back(input, vc);
             }
             if (_vc_allocator)
             {
-              _vc_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
-                                                              -1)));
+              _vc_alloc_vcs.push_back(input, vc);
             }
             if (_noq)
             {
@@ -1341,8 +1353,7 @@ void IQRouter::_SWHoldUpdate()
         }
         else
         {
-          _sw_hold_vcs.push_back(make_pair(-1, make_pair(item.second.first,
-                                                         -1)));
+          _sw_hold_vcs.push_back(input, vc);
         }
       }
     }
@@ -1367,8 +1378,7 @@ void IQRouter::_SWHoldUpdate()
       _switch_hold_vc[expanded_input] = -1;
       _switch_hold_in[expanded_input] = -1;
       _switch_hold_out[held_expanded_output] = -1;
-      _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
-                                                      -1)));
+      _sw_alloc_vcs.push_back(input, vc);
     }
     _sw_hold_vcs.pop_front();
   }
@@ -1495,23 +1505,21 @@ void IQRouter::_SWAllocEvaluate()
 {
   bool watched = false;
 
-  for (deque<pair<int, pair<pair<int, int>, int>>>::iterator iter = _sw_alloc_vcs.begin();
-       iter != _sw_alloc_vcs.end();
-       ++iter)
+  for (int i = 0; i < _sw_alloc_vcs.size(); ++i)
   {
 
-    int const time = iter->first;
+    int const time = _sw_alloc_vcs.time(i);
     if (time >= 0)
     {
       break;
     }
 
-    int const input = iter->second.first.first;
+    int const input = _sw_alloc_vcs.input(i);
     assert((input >= 0) && (input < _inputs));
-    int const vc = iter->second.first.second;
+    int const vc = _sw_alloc_vcs.vc(i);
     assert((vc >= 0) && (vc < _vcs));
 
-    assert(iter->second.second == -1);
+    assert(_sw_alloc_vcs.grant(i) == -1);
 
     assert(_switch_hold_vc[input * _input_speedup + vc % _input_speedup] != vc);
 
@@ -1552,7 +1560,7 @@ void IQRouter::_SWAllocEvaluate()
                      << " at output " << dest_output
                      << " is full." << endl;
         }
-        iter->second.second = dest_buf->IsFull() ? STALL_BUFFER_FULL : STALL_BUFFER_RESERVED;
+        _sw_alloc_vcs.grant(i) = dest_buf->IsFull() ? STALL_BUFFER_FULL : STALL_BUFFER_RESERVED;
         continue;
       }
       bool const requested = _SWAllocAddReq(input, vc, dest_output);
@@ -1570,11 +1578,11 @@ void IQRouter::_SWAllocEvaluate()
     OutputSet const *const route_set = cur_buf->GetRouteSet(vc);
     assert(route_set);
 
-    set<OutputSet::sSetElement> const setlist = route_set->GetSet();
+    vector<OutputSet::sSetElement> const &setlist = route_set->GetSet();
 
     assert(!_noq || (setlist.size() == 1));
 
-    for (set<OutputSet::sSetElement>::const_iterator iset = setlist.begin();
+    for (vector<OutputSet::sSetElement>::const_iterator iset = setlist.begin();
          iset != setlist.end();
          ++iset)
     {
@@ -1638,7 +1646,7 @@ void IQRouter::_SWAllocEvaluate()
                      << "  Output " << dest_output
                      << " has no suitable VCs available." << endl;
         }
-        iter->second.second = STALL_BUFFER_BUSY;
+        _sw_alloc_vcs.grant(i) = STALL_BUFFER_BUSY;
       }
       else if (_spec_check_cred && !cred)
       {
@@ -1648,7 +1656,7 @@ void IQRouter::_SWAllocEvaluate()
                      << "  All suitable VCs at output " << dest_output
                      << " are full." << endl;
         }
-        iter->second.second = dest_buf->IsFull() ? STALL_BUFFER_FULL : STALL_BUFFER_RESERVED;
+        _sw_alloc_vcs.grant(i) = dest_buf->IsFull() ? STALL_BUFFER_FULL : STALL_BUFFER_RESERVED;
       }
       else
       {
@@ -1670,6 +1678,7 @@ void IQRouter::_SWAllocEvaluate()
   }
 
   _sw_allocator->Allocate();
+  _sw_allocator->CountGrants();
   if (_spec_sw_allocator)
     _spec_sw_allocator->Allocate();
 
@@ -1684,29 +1693,27 @@ void IQRouter::_SWAllocEvaluate()
     }
   }
 
-  for (deque<pair<int, pair<pair<int, int>, int>>>::iterator iter = _sw_alloc_vcs.begin();
-       iter != _sw_alloc_vcs.end();
-       ++iter)
+  for (int i = 0; i < _sw_alloc_vcs.size(); ++i)
   {
 
-    int const time = iter->first;
+    int const time = _sw_alloc_vcs.time(i);
     if (time >= 0)
     {
       break;
     }
-    iter->first = GetSimTime() + _sw_alloc_delay - 1;
+    _sw_alloc_vcs.time(i) = GetSimTime() + _sw_alloc_delay - 1;
 
-    int const input = iter->second.first.first;
+    int const input = _sw_alloc_vcs.input(i);
     assert((input >= 0) && (input < _inputs));
-    int const vc = iter->second.first.second;
+    int const vc = _sw_alloc_vcs.vc(i);
     assert((vc >= 0) && (vc < _vcs));
 
-    if (iter->second.second < -1)
+    if (_sw_alloc_vcs.grant(i) < -1)
     {
       continue;
     }
 
-    assert(iter->second.second == -1);
+    assert(_sw_alloc_vcs.grant(i) == -1);
 
     Buffer const *const cur_buf = _buf[input];
     assert(!cur_buf->Empty(vc));
@@ -1738,7 +1745,7 @@ void IQRouter::_SWAllocEvaluate()
                      << "." << endl;
         }
         _sw_rr_offset[expanded_input] = (vc + _input_speedup) % _vcs;
-        iter->second.second = expanded_output;
+        _sw_alloc_vcs.grant(i) = expanded_output;
       }
       else
       {
@@ -1749,7 +1756,7 @@ void IQRouter::_SWAllocEvaluate()
                      << " at input " << input
                      << ": Granted to VC " << granted_vc << "." << endl;
         }
-        iter->second.second = STALL_CROSSBAR_CONFLICT;
+        _sw_alloc_vcs.grant(i) = STALL_CROSSBAR_CONFLICT;
       }
     }
     else if (_spec_sw_allocator)
@@ -1771,7 +1778,7 @@ void IQRouter::_SWAllocEvaluate()
                        << "." << (expanded_output % _output_speedup)
                        << " has non-speculative requests." << endl;
           }
-          iter->second.second = STALL_CROSSBAR_CONFLICT;
+          _sw_alloc_vcs.grant(i) = STALL_CROSSBAR_CONFLICT;
         }
         else if (!_spec_mask_by_reqs &&
                  (_sw_allocator->InputAssigned(expanded_output) >= 0))
@@ -1786,7 +1793,7 @@ void IQRouter::_SWAllocEvaluate()
                        << "." << (expanded_output % _output_speedup)
                        << " has a non-speculative grant." << endl;
           }
-          iter->second.second = STALL_CROSSBAR_CONFLICT;
+          _sw_alloc_vcs.grant(i) = STALL_CROSSBAR_CONFLICT;
         }
         else
         {
@@ -1805,7 +1812,7 @@ void IQRouter::_SWAllocEvaluate()
                          << "." << endl;
             }
             _sw_rr_offset[expanded_input] = (vc + _input_speedup) % _vcs;
-            iter->second.second = expanded_output;
+            _sw_alloc_vcs.grant(i) = expanded_output;
           }
           else
           {
@@ -1816,7 +1823,7 @@ void IQRouter::_SWAllocEvaluate()
                          << " at input " << input
                          << ": Granted to VC " << granted_vc << "." << endl;
             }
-            iter->second.second = STALL_CROSSBAR_CONFLICT;
+            _sw_alloc_vcs.grant(i) = STALL_CROSSBAR_CONFLICT;
           }
         }
       }
@@ -1831,7 +1838,7 @@ void IQRouter::_SWAllocEvaluate()
                      << ": No output granted." << endl;
         }
 
-        iter->second.second = STALL_CROSSBAR_CONFLICT;
+        _sw_alloc_vcs.grant(i) = STALL_CROSSBAR_CONFLICT;
       }
     }
     else
@@ -1845,7 +1852,7 @@ void IQRouter::_SWAllocEvaluate()
                    << ": No output granted." << endl;
       }
 
-      iter->second.second = STALL_CROSSBAR_CONFLICT;
+      _sw_alloc_vcs.grant(i) = STALL_CROSSBAR_CONFLICT;
     }
   }
 
@@ -1854,21 +1861,19 @@ void IQRouter::_SWAllocEvaluate()
     return;
   }
 
-  for (deque<pair<int, pair<pair<int, int>, int>>>::iterator iter = _sw_alloc_vcs.begin();
-       iter != _sw_alloc_vcs.end();
-       ++iter)
+  for (int i = 0; i < _sw_alloc_vcs.size(); ++i)
   {
 
-    int const time = iter->first;
+    int const time = _sw_alloc_vcs.time(i);
     assert(time >= 0);
     if (GetSimTime() < time)
     {
       break;
     }
 
-    assert(iter->second.second != -1);
+    assert(_sw_alloc_vcs.grant(i) != -1);
 
-    int const expanded_output = iter->second.second;
+    int const expanded_output = _sw_alloc_vcs.grant(i);
 
     if (expanded_output >= 0)
     {
@@ -1878,10 +1883,10 @@ void IQRouter::_SWAllocEvaluate()
 
       BufferState const *const dest_buf = _next_buf[output];
 
-      int const input = iter->second.first.first;
+      int const input = _sw_alloc_vcs.input(i);
       assert((input >= 0) && (input < _inputs));
       assert((input % _output_speedup) == (expanded_output % _output_speedup));
-      int const vc = iter->second.first.second;
+      int const vc = _sw_alloc_vcs.vc(i);
       assert((vc >= 0) && (vc < _vcs));
 
       int const expanded_input = input * _input_speedup + vc % _input_speedup;
@@ -1922,7 +1927,7 @@ void IQRouter::_SWAllocEvaluate()
           }
           *gWatchOut << "." << endl;
         }
-        iter->second.second = STALL_CROSSBAR_CONFLICT;
+        _sw_alloc_vcs.grant(i) = STALL_CROSSBAR_CONFLICT;
       }
       else if (_speculative && (cur_buf->GetState(vc) == VC::vc_alloc))
       {
@@ -1947,7 +1952,7 @@ void IQRouter::_SWAllocEvaluate()
                          << "." << (expanded_output % _output_speedup)
                          << " due to misspeculation." << endl;
             }
-            iter->second.second = -1; // stall is counted in VC allocation path!
+            _sw_alloc_vcs.grant(i) = -1; // stall is counted in VC allocation path!
           }
           else if ((output_and_vc / _vcs) != output)
           {
@@ -1960,7 +1965,7 @@ void IQRouter::_SWAllocEvaluate()
                          << "." << (expanded_output % _output_speedup)
                          << " due to port mismatch between VC and switch allocator." << endl;
             }
-            iter->second.second = STALL_BUFFER_CONFLICT; // count this case as if we had failed allocation
+            _sw_alloc_vcs.grant(i) = STALL_BUFFER_CONFLICT; // count this case as if we had failed allocation
           }
           else if (dest_buf->IsFullFor((output_and_vc % _vcs)))
           {
@@ -1973,7 +1978,7 @@ void IQRouter::_SWAllocEvaluate()
                          << "." << (expanded_output % _output_speedup)
                          << " due to lack of credit." << endl;
             }
-            iter->second.second = dest_buf->IsFull() ? STALL_BUFFER_FULL : STALL_BUFFER_RESERVED;
+            _sw_alloc_vcs.grant(i) = dest_buf->IsFull() ? STALL_BUFFER_FULL : STALL_BUFFER_RESERVED;
           }
         }
         else
@@ -1982,7 +1987,7 @@ void IQRouter::_SWAllocEvaluate()
           OutputSet const *const route_set = cur_buf->GetRouteSet(vc);
           assert(route_set);
 
-          set<OutputSet::sSetElement> const setlist = route_set->GetSet();
+          vector<OutputSet::sSetElement> const &setlist = route_set->GetSet();
 
           bool busy = true;
           bool full = true;
@@ -1990,7 +1995,7 @@ void IQRouter::_SWAllocEvaluate()
 
           assert(!_noq || (setlist.size() == 1));
 
-          for (set<OutputSet::sSetElement>::const_iterator iset = setlist.begin();
+          for (vector<OutputSet::sSetElement>::const_iterator iset = setlist.begin();
                iset != setlist.end();
                ++iset)
           {
@@ -2050,7 +2055,7 @@ void IQRouter::_SWAllocEvaluate()
                          << "." << (expanded_output % _output_speedup)
                          << " because no suitable output VC for piggyback allocation is available." << endl;
             }
-            iter->second.second = STALL_BUFFER_BUSY;
+            _sw_alloc_vcs.grant(i) = STALL_BUFFER_BUSY;
           }
           else if (full)
           {
@@ -2063,7 +2068,7 @@ void IQRouter::_SWAllocEvaluate()
                          << "." << (expanded_output % _output_speedup)
                          << " because all suitable output VCs for piggyback allocation are full." << endl;
             }
-            iter->second.second = reserved ? STALL_BUFFER_RESERVED : STALL_BUFFER_FULL;
+            _sw_alloc_vcs.grant(i) = reserved ? STALL_BUFFER_RESERVED : STALL_BUFFER_FULL;
           }
         }
       }
@@ -2085,7 +2090,7 @@ void IQRouter::_SWAllocEvaluate()
                        << "." << (expanded_output % _output_speedup)
                        << " due to lack of credit." << endl;
           }
-          iter->second.second = dest_buf->IsFull() ? STALL_BUFFER_FULL : STALL_BUFFER_RESERVED;
+          _sw_alloc_vcs.grant(i) = dest_buf->IsFull() ? STALL_BUFFER_FULL : STALL_BUFFER_RESERVED;
         }
       }
     }
@@ -2097,18 +2102,16 @@ void IQRouter::_SWAllocUpdate()
   while (!_sw_alloc_vcs.empty())
   {
 
-    pair<int, pair<pair<int, int>, int>> const &item = _sw_alloc_vcs.front();
-
-    int const time = item.first;
+    int const time = _sw_alloc_vcs.time(0);
     if ((time < 0) || (GetSimTime() < time))
     {
       break;
     }
     assert(GetSimTime() == time);
 
-    int const input = item.second.first.first;
+    int const input = _sw_alloc_vcs.input(0);
     assert((input >= 0) && (input < _inputs));
-    int const vc = item.second.first.second;
+    int const vc = _sw_alloc_vcs.vc(0);
     assert((vc >= 0) && (vc < _vcs));
 
     Buffer *const cur_buf = _buf[input];
@@ -2129,7 +2132,7 @@ void IQRouter::_SWAllocUpdate()
                  << ")." << endl;
     }
 
-    int const expanded_output = item.second.second;
+    int const expanded_output = _sw_alloc_vcs.grant(0);
 
     if (expanded_output >= 0)
     {
@@ -2160,11 +2163,11 @@ void IQRouter::_SWAllocUpdate()
         int match_prio = numeric_limits<int>::min();
 
         const OutputSet *route_set = cur_buf->GetRouteSet(vc);
-        set<OutputSet::sSetElement> const setlist = route_set->GetSet();
+        vector<OutputSet::sSetElement> const &setlist = route_set->GetSet();
 
         assert(!_noq || (setlist.size() == 1));
 
-        for (set<OutputSet::sSetElement>::const_iterator iset = setlist.begin();
+        for (vector<OutputSet::sSetElement>::const_iterator iset = setlist.begin();
              iset != setlist.end();
              ++iset)
         {
@@ -2342,7 +2345,7 @@ void IQRouter::_SWAllocUpdate()
           if (_routing_delay)
           {
             cur_buf->SetState(vc, VC::routing);
-            _route_vcs.push_back(make_pair(-1, item.second.first));
+            _route_vcs.push_back(input, vc);
           }
           else
           {
@@ -2358,13 +2361,11 @@ void IQRouter::_SWAllocUpdate()
             cur_buf->SetState(vc, VC::vc_alloc);
             if (_speculative)
             {
-              _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
-                                                              -1)));
+              _sw_alloc_vcs.push_back(input, vc);
             }
             if (_vc_allocator)
             {
-              _vc_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
-                                                              -1)));
+              _vc_alloc_vcs.push_back(input, vc);
             }
             if (_noq)
             {
@@ -2389,13 +2390,11 @@ void IQRouter::_SWAllocUpdate()
             _switch_hold_vc[expanded_input] = vc;
             _switch_hold_in[expanded_input] = expanded_output;
             _switch_hold_out[expanded_output] = expanded_input;
-            _sw_hold_vcs.push_back(make_pair(-1, make_pair(item.second.first,
-                                                           -1)));
+            _sw_hold_vcs.push_back(input, vc);
           }
           else
           {
-            _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
-                                                            -1)));
+            _sw_alloc_vcs.push_back(input, vc);
           }
         }
       }
@@ -2437,7 +2436,7 @@ void IQRouter::_SWAllocUpdate()
       }
 #endif
 
-      _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first, -1)));
+      _sw_alloc_vcs.push_back(input, vc);
     }
     _sw_alloc_vcs.pop_front();
   }
@@ -2449,23 +2448,23 @@ void IQRouter::_SWAllocUpdate()
 
 void IQRouter::_SwitchEvaluate()
 {
-  for (deque<pair<int, pair<Flit *, pair<int, int>>>>::iterator iter = _crossbar_flits.begin();
-       iter != _crossbar_flits.end();
-       ++iter)
+  for (int i = 0; i < _crossbar_flits.size(); ++i)
   {
 
-    int const time = iter->first;
+    pair<int, pair<Flit *, pair<int, int>>> &item = _crossbar_flits[i];
+
+    int const time = item.first;
     if (time >= 0)
     {
       break;
     }
-    iter->first = GetSimTime() + _crossbar_delay - 1;
+    item.first = GetSimTime() + _crossbar_delay - 1;
 
-    Flit const *const f = iter->second.first;
+    Flit const *const f = item.second.first;
     assert(f);
 
-    int const expanded_input = iter->second.second.first;
-    int const expanded_output = iter->second.second.second;
+    int const expanded_input = item.second.second.first;
+    int const expanded_output = item.second.second.second;
 
     if (f->watch)
     {
@@ -2607,6 +2606,38 @@ void IQRouter::_SendCredits()
 // misc.
 //------------------------------------------------------------------------------
 
+void IQRouter::Checkpoint(spatial::StateArchive &ar)
+{
+  Router::Checkpoint(ar);
+  ar & _active & _in_queue_flits & _proc_credits & _route_vcs & _vc_alloc_vcs
+     & _sw_hold_vcs & _sw_alloc_vcs & _crossbar_flits & _out_queue_credits;
+  for (int i = 0; i < _inputs; ++i)
+  {
+    _buf[i]->Checkpoint(ar);
+  }
+  for (int j = 0; j < _outputs; ++j)
+  {
+    _next_buf[j]->Checkpoint(ar);
+  }
+  if (_vc_allocator)
+  {
+    _vc_allocator->Checkpoint(ar);
+  }
+  _sw_allocator->Checkpoint(ar);
+  if (_spec_sw_allocator)
+  {
+    _spec_sw_allocator->Checkpoint(ar);
+  }
+  ar & _vc_rr_offset & _sw_rr_offset & _output_buffer & _credit_buffer
+     & _switch_hold_in & _switch_hold_out & _switch_hold_vc
+     & _noq_next_output_port & _noq_next_vc_start & _noq_next_vc_end;
+#ifdef TRACK_FLOWS
+  ar & _outstanding_classes;
+#endif
+  _switchMonitor->Checkpoint(ar);
+  _bufferMonitor->Checkpoint(ar);
+}
+
 void IQRouter::Display(ostream &os) const
 {
   for (int input = 0; input < _inputs; ++input)
@@ -2688,7 +2719,7 @@ void IQRouter::_UpdateNOQ(int input, int vc, Flit const *f)
   assert(f);
   assert(f->vc == vc);
   assert(f->head);
-  set<OutputSet::sSetElement> sl = f->la_route_set.GetSet();
+  vector<OutputSet::sSetElement> sl = f->la_route_set.GetSet();
   assert(sl.size() == 1);
   int out_port = sl.begin()->output_port;
   const FlitChannel *channel = _output_channels[out_port];
@@ -29,13 +29,13 @@
 #define _IQ_ROUTER_HPP_
 
 #include <string>
-#include <deque>
 #include <queue>
 #include <set>
 #include <map>
 
 #include "router.hpp"
 #include "routefunc.hpp"
+#include "stage_queue.hpp"
 
 using namespace std;
 
@@ -70,14 +70,14 @@ protected:
   
   map<int, Flit *> _in_queue_flits;
 
-  deque<pair<int, pair<Credit *, int> > > _proc_credits;
+  RingQueue<pair<int, pair<Credit *, int> > > _proc_credits;
 
-  deque<pair<int, pair<int, int> > > _route_vcs;    // [time]=<input, vc>
-  deque<pair<int, pair<pair<int, int>, int> > > _vc_alloc_vcs;  // [time][<input, vc>]=channel_and_vc
-  deque<pair<int, pair<pair<int, int>, int> > > _sw_hold_vcs;
-  deque<pair<int, pair<pair<int, int>, int> > > _sw_alloc_vcs;
+  StageQueue _route_vcs;
+  StageQueue _vc_alloc_vcs;   // granted an output_and_vc
+  StageQueue _sw_hold_vcs;
+  StageQueue _sw_alloc_vcs;
 
-  deque<pair<int, pair<Flit *, pair<int, int> > > > _crossbar_flits;
+  RingQueue<pair<int, pair<Flit *, pair<int, int> > > > _crossbar_flits;
 
   map<int, Credit *> _out_queue_credits;
 
@@ -162,6 +162,8 @@ public:
 
   virtual void ReadInputs( );
   virtual void WriteOutputs( );
+  virtual bool Idle( ) const;
+  virtual void Checkpoint( spatial::StateArchive & ar );
   
   void Display( ostream & os = cout ) const;
 
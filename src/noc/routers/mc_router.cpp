@@ -14,7 +14,6 @@
 #include <fstream>
 #include <map>
 #include <vector>
-#include <deque>
 #include <assert.h>
 #include <stdlib.h>
 #include <limits>
@@ -203,18 +202,18 @@ void MCRouter::_FlitDispatch() {
 
             cur_buf->SetState(vc, VC::routing);
             if (multicast) {
-                _multi_route_vcs.push_back(make_pair(-1, make_pair(input, vc)));
+                _multi_route_vcs.push_back(input, vc);
             } else {
-                _route_vcs.push_back(make_pair(-1, make_pair(input, vc)));
+                _route_vcs.push_back(input, vc);
             }
         }
         else if ((cur_buf->GetState(vc) == VC::active)
               && (cur_buf->FrontFlit(vc) == f))
         {
             if (multicast) {
-                _multi_sw_alloc_vcs.push_back(make_pair(-1, make_pair(make_pair(input, vc), vector<int>())));
+                _multi_sw_alloc_vcs.push_back(input, vc);
             } else {
-                _sw_alloc_vcs.push_back(make_pair(-1, make_pair(make_pair(input, vc), -1)));
+                _sw_alloc_vcs.push_back(input, vc);
             }
         }
     }
@@ -247,20 +246,18 @@ void MCRouter::_FlitDispatch() {
 void MCRouter::_MultiRouteEvaluate() {
     assert(_routing_delay == 1);
 
-    for (deque<pair<int, pair<int, int>>>::iterator iter = _multi_route_vcs.begin();
-         iter != _multi_route_vcs.end();
-         iter++)
+    for (int i = 0; i < _multi_route_vcs.size(); ++i)
     {
-        int const time = iter->first;
+        int const time = _multi_route_vcs.time(i);
         if (time >= 0) {
             break;
         }
 
-        iter->first = GetSimTime() + _routing_delay - 1;
+        _multi_route_vcs.time(i) = GetSimTime() + _routing_delay - 1;
 
-        int const input = iter->second.first;
+        int const input = _multi_route_vcs.input(i);
         assert((input >= 0) && (input < _inputs));
-        int const vc = iter->second.second;
+        int const vc = _multi_route_vcs.vc(i);
         assert((vc >= 0) && (vc < _vcs));
 
         MCBuffer const *const cur_buf = _mc_buf[input];
@@ -290,17 +287,16 @@ void MCRouter::_MultiRouteUpdate() {
     assert(_routing_delay == 1);
 
     while (!_multi_route_vcs.empty()) {
-        auto& item = _multi_route_vcs.front();
 
-        int const time = item.first;
+        int const time = _multi_route_vcs.time(0);
         if ((time < 0) || (GetSimTime() < time)) {
             break;
         }
         assert(GetSimTime() == time);
 
-        int const input = item.second.first;
+        int const input = _multi_route_vcs.input(0);
         assert((input >= 0) && (input < _inputs));
-        int const vc = item.second.second;
+        int const vc = _multi_route_vcs.vc(0);
         assert((vc >= 0) && (vc < _vcs));
 
         MCBuffer *const cur_buf = _mc_buf[input];
@@ -325,7 +321,7 @@ void MCRouter::_MultiRouteUpdate() {
         cur_buf->SetState(vc, VC::vc_alloc);
 
         if (_vc_allocator) {
-            _multi_vc_alloc_vcs.push_back(make_pair(-1, make_pair(item.second, vector<int>())));
+            _multi_vc_alloc_vcs.push_back(input, vc);
         }
         _multi_route_vcs.pop_front();
     }
@@ -337,20 +333,20 @@ void MCRouter::_MultiVCAllocEvaluate() {
 
     bool watched = false;
 
-    for (auto iter = _multi_vc_alloc_vcs.begin(); iter != _multi_vc_alloc_vcs.end(); ++iter)
+    for (int i = 0; i < _multi_vc_alloc_vcs.size(); ++i)
     {
 
-        int const time = iter->first;
+        int const time = _multi_vc_alloc_vcs.time(i);
         if (time >= 0) {
             break;
         }
 
-        int const input = iter->second.first.first;
+        int const input = _multi_vc_alloc_vcs.input(i);
         assert((input >= 0) && (input < _inputs));
-        int const vc = iter->second.first.second;
+        int const vc = _multi_vc_alloc_vcs.vc(i);
         assert((vc >= 0) && (vc < _vcs));
 
-        assert(iter->second.second.empty());
+        assert(_multi_vc_alloc_vcs.grant(i) == -1);
 
         MCBuffer const *const cur_buf = _mc_buf[input];
         assert(!cur_buf->Empty(vc));
@@ -376,7 +372,7 @@ void MCRouter::_MultiVCAllocEvaluate() {
         assert(route_set);
 
         int const out_priority = cur_buf->GetPriority(vc);
-        set<OutputSet::sSetElement> const setlist = route_set->GetSet();
+        vector<OutputSet::sSetElement> const &setlist = route_set->GetSet();
 
         bool elig = true;
         bool reserved = false;
@@ -384,7 +380,7 @@ void MCRouter::_MultiVCAllocEvaluate() {
         // assert(!_noq || (setlist.size() >= 1));
         assert(!_noq && (setlist.size() == f->GetFanoutFlitNum(GetID())));
 
-        set<int> vis;
+        uint64_t vis = 0;
         // These requests are buffered here. They are submitted to the allocator
         // only if all output ports are available.
 
@@ -392,7 +388,8 @@ void MCRouter::_MultiVCAllocEvaluate() {
             int in, out, label, in_pri, out_pri;
         };
 
-        std::vector<Paras> req_paras;
+        Paras req_paras[FocusFlit::MAX_FANOUT];
+        int num_req_paras = 0;
         for (auto iset = setlist.begin(); iset != setlist.end(); ++iset)
         {
 
@@ -400,8 +397,8 @@ void MCRouter::_MultiVCAllocEvaluate() {
             assert((out_port >= 0) && (out_port < _outputs));
 
             // The routing result must have different output ports
-            assert(vis.find(out_port) == vis.end());
-            vis.insert(out_port);
+            assert(!((vis >> out_port) & 1));
+            vis |= 1ULL << out_port;
 
             BufferState const *const dest_buf = _next_buf[out_port];
 
@@ -414,7 +411,7 @@ void MCRouter::_MultiVCAllocEvaluate() {
             // We randomly select an output virtual channel for multicast packets
             int out_vc = 0;
             if (vc_end != 0) {
-                out_vc = rand() % (vc_end - vc_start + 1) + vc_start;
+                out_vc = _vc_rng() % (vc_end - vc_start + 1) + vc_start;
             }
 
             assert((out_vc >= 0) && (out_vc < _vcs));
@@ -447,15 +444,16 @@ void MCRouter::_MultiVCAllocEvaluate() {
                 elig = false;   // A multicast flit needs all output ports available
             } else {
                 int const input_and_vc = _vc_shuffle_requests ? (vc * _inputs + input) : (input * _vcs + vc);
-                req_paras.push_back({input_and_vc, out_port * _vcs + out_vc, 0, in_priority, out_priority});
+                req_paras[num_req_paras++] = {input_and_vc, out_port * _vcs + out_vc, 0, in_priority, out_priority};
             }
         }
 
         if (!elig) {            // Some output ports are unavailabe
-            iter->second.second.push_back(STALL_BUFFER_BUSY);
+            _multi_vc_alloc_vcs.grant(i) = STALL_BUFFER_BUSY;
         } else {    // Submit the requests to the allocator
-            for (auto p: req_paras) {
-               _multi_vc_allocator->AddRequest(p.in, p.out, p.label, p.in_pri, p.out_pri);
+            for (int p = 0; p < num_req_paras; ++p) {
+               _multi_vc_allocator->AddRequest(req_paras[p].in, req_paras[p].out, req_paras[p].label,
+                                               req_paras[p].in_pri, req_paras[p].out_pri);
             }
         }
     }
@@ -466,27 +464,28 @@ void MCRouter::_MultiVCAllocEvaluate() {
     }
 
     _multi_vc_allocator->Allocate();
+    _multi_vc_allocator->CountGrants();
 
     if (watched) {
         *gWatchOut << GetSimTime() << " | " << _multi_vc_allocator->FullName() << " | ";
         _multi_vc_allocator->PrintRequests(gWatchOut);
     }
 
-    for (auto iter = _multi_vc_alloc_vcs.begin(); iter != _multi_vc_alloc_vcs.end(); ++iter) {
-        int const time = iter->first;
+    for (int i = 0; i < _multi_vc_alloc_vcs.size(); ++i) {
+        int const time = _multi_vc_alloc_vcs.time(i);
         if (time >= 0) {
             break;
         }
 
-        iter->first = GetSimTime() + _vc_alloc_delay - 1;
+        _multi_vc_alloc_vcs.time(i) = GetSimTime() + _vc_alloc_delay - 1;
 
-        int const input = iter->second.first.first;
+        int const input = _multi_vc_alloc_vcs.input(i);
         assert((input >= 0) && (input < _inputs));
-        int const vc = iter->second.first.second;
+        int const vc = _multi_vc_alloc_vcs.vc(i);
         assert((vc >= 0) && (vc < _vcs));
 
-        if (!iter->second.second.empty()) {
-            assert(iter->second.second.front() < -1);
+        if (_multi_vc_alloc_vcs.grant(i) != -1) {
+            assert(_multi_vc_alloc_vcs.grant(i) < -1);
             continue;
         }
 
@@ -500,19 +499,17 @@ void MCRouter::_MultiVCAllocEvaluate() {
         assert(f->head);
 
         int const input_and_vc = _vc_shuffle_requests ? (vc * _inputs + input) : (input * _vcs + vc);
-        vector<int> outputs_and_vcs = _multi_vc_allocator->MultiOutputAssigned(input_and_vc);
-
-        assert(outputs_and_vcs.size() == f->GetFanoutFlitNum(GetID()));
+        assert(_multi_vc_allocator->NumInputRequests(input_and_vc) > 0);
 
-        bool grant_succeed = true;
-        for (int it: outputs_and_vcs) {
-            grant_succeed &= it >= 0;
-        }
+        if (_multi_vc_allocator->MultiOutputGranted(input_and_vc)) {
+            int outputs_and_vcs[FocusFlit::MAX_FANOUT];
+            int const num_outputs = _multi_vc_allocator->MultiOutputAssigned(input_and_vc, outputs_and_vcs);
+            assert(num_outputs == f->GetFanoutFlitNum(GetID()));
 
-        if (grant_succeed) {
             if (f->watch) {
                 *gWatchOut << GetSimTime() << " | " << FullName() << " | " << "Assigning VC ";
-                for (int output_and_vc: outputs_and_vcs) {
+                for (int k = 0; k < num_outputs; ++k) {
+                    int const output_and_vc = outputs_and_vcs[k];
                     int const match_output = output_and_vc / _vcs;
                     assert((match_output >= 0) && (match_output < _outputs));
                     int const match_vc = output_and_vc % _vcs;
@@ -521,7 +518,7 @@ void MCRouter::_MultiVCAllocEvaluate() {
                 }
                 *gWatchOut << " to VC " << vc << " at input " << input << ". [Multicast Flit]" << endl;
             }
-            iter->second.second = outputs_and_vcs;
+            _multi_vc_alloc_vcs.grant(i) = num_outputs;
 
             // Multicast flits grab the buffer before vc_allocate_update. Although it violates
             // the two-phase update scheme, it forbids the unicast flits from being allocated to
@@ -530,9 +527,9 @@ void MCRouter::_MultiVCAllocEvaluate() {
             // clean the out_pair
             cur_buf->ClearOutputs(vc);
 
-            for (int output_and_vc: outputs_and_vcs) {
-                int const match_output = output_and_vc / _vcs;
-                int const match_vc = output_and_vc % _vcs;
+            for (int k = 0; k < num_outputs; ++k) {
+                int const match_output = outputs_and_vcs[k] / _vcs;
+                int const match_vc = outputs_and_vcs[k] % _vcs;
                 assert((match_output >= 0) && (match_output < _outputs));
                 assert((match_vc >= 0) && (match_vc < _vcs));
 
@@ -549,6 +546,7 @@ void MCRouter::_MultiVCAllocEvaluate() {
 
                 dest_buf->TakeBuffer(match_vc, input * _vcs + vc);
                 cur_buf->addMultiOutput(vc, match_output, match_vc);
+                _multi_vc_alloc_vcs.ports(i) |= 1ULL << match_output;
             }
 
         } else {
@@ -559,7 +557,7 @@ void MCRouter::_MultiVCAllocEvaluate() {
                         << " at input " << input
                         << ". [Multicast Flit]" << endl;
             }
-            iter->second.second.push_back(STALL_BUFFER_CONFLICT);
+            _multi_vc_alloc_vcs.grant(i) = STALL_BUFFER_CONFLICT;
         }
     }
 
@@ -572,21 +570,20 @@ void MCRouter::_MultiVCAllocUpdate() {
     assert(_vc_allocator);
 
     while (!_multi_vc_alloc_vcs.empty()) {
-        auto& item = _multi_vc_alloc_vcs.front();
 
-        int const time = item.first;
+        int const time = _multi_vc_alloc_vcs.time(0);
 
         if ((time < 0) || (GetSimTime() < time)) {
             break;
         }
         assert(GetSimTime() == time);
 
-        int const input = item.second.first.first;
+        int const input = _multi_vc_alloc_vcs.input(0);
         assert((input >= 0) && (input < _inputs));
-        int const vc = item.second.first.second;
+        int const vc = _multi_vc_alloc_vcs.vc(0);
         assert((vc >= 0) && (vc < _vcs));
 
-        assert(!item.second.second.empty());
+        assert(_multi_vc_alloc_vcs.grant(0) != -1);
 
         MCBuffer *const cur_buf = _mc_buf[input];
         assert(!cur_buf->Empty(vc));
@@ -607,23 +604,15 @@ void MCRouter::_MultiVCAllocUpdate() {
                         << "). [Multicast Flit]" << endl;
         }
 
-        vector<int> outputs_and_vcs = item.second.second;
-        assert(!outputs_and_vcs.empty());
-
-        bool grant_succeed = true;
-        for (int it: outputs_and_vcs) {
-            grant_succeed &= it >= 0;
-        }
-
-        if (grant_succeed) {
+        if (_multi_vc_alloc_vcs.grant(0) >= 0) {
             cur_buf->SetState(vc, VC::active);
-            _multi_sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first, vector<int>())));
+            _multi_sw_alloc_vcs.push_back(input, vc);
         } else {
             if (f->watch) {
                 *gWatchOut << GetSimTime() << " | " << FullName() << " | "
                            << "  Not all required VCs are allocated. [Multicast Flit]" << endl;
             }
-            _multi_vc_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first, vector<int>())));
+            _multi_vc_alloc_vcs.push_back(input, vc);
         }
         _multi_vc_alloc_vcs.pop_front();
     }
@@ -635,18 +624,18 @@ void MCRouter::_MultiSWAllocEvaluate() {
 
     bool watched = false;
 
-    for (auto iter = _multi_sw_alloc_vcs.begin(); iter != _multi_sw_alloc_vcs.end(); ++iter) {
-        int const time = iter->first;
+    for (int i = 0; i < _multi_sw_alloc_vcs.size(); ++i) {
+        int const time = _multi_sw_alloc_vcs.time(i);
         if (time >= 0) {
             break;
         }
 
-        int const input = iter->second.first.first;
+        int const input = _multi_sw_alloc_vcs.input(i);
         assert((input >= 0) && (input < _inputs));
-        int const vc = iter->second.first.second;
+        int const vc = _multi_sw_alloc_vcs.vc(i);
         assert((vc >= 0) && (vc < _vcs));
 
-        assert(iter->second.second.empty());
+        assert(_multi_sw_alloc_vcs.grant(i) == -1);
 
         MCBuffer *const cur_buf = _mc_buf[input];
         assert(!cur_buf->Empty(vc));
@@ -669,7 +658,7 @@ void MCRouter::_MultiSWAllocEvaluate() {
         }
 
         if (cur_buf->GetState(vc) == VC::active) {
-            std::map<int, int> outputs = cur_buf->getMultiOutputs(vc);
+            vector<pair<int, int> > const &outputs = cur_buf->getMultiOutputs(vc);
 
             bool elig = true;
 
@@ -677,7 +666,8 @@ void MCRouter::_MultiSWAllocEvaluate() {
                 int in, out, label, in_pri, out_pri;
             };
 
-            std::vector<Paras> req_paras;
+            Paras req_paras[FocusFlit::MAX_FANOUT];
+            int num_req_paras = 0;
             for (auto out_iter = outputs.begin(); out_iter != outputs.end(); ++out_iter) {
                 int dest_output = out_iter->first;
                 assert((dest_output >= 0) && (dest_output < _outputs));
@@ -705,7 +695,7 @@ void MCRouter::_MultiSWAllocEvaluate() {
                     // int const expanded_output = dest_output * _output_speedup + input % _output_speedup;
                     int const expanded_input = input * _vcs + vc;
                     int const expanded_output = dest_output;
-                    req_paras.push_back({expanded_input, expanded_output, vc, prio, prio});
+                    req_paras[num_req_paras++] = {expanded_input, expanded_output, vc, prio, prio};
                 }
             }
 
@@ -713,13 +703,14 @@ void MCRouter::_MultiSWAllocEvaluate() {
                 watched |= f->watch;
 
                 // TODO: refine this according to _SWAllocAddReq
-                for (auto p: req_paras) {
-                    _multi_sw_allocator->AddRequest(p.in, p.out, p.label, p.in_pri, p.out_pri);
+                for (int p = 0; p < num_req_paras; ++p) {
+                    _multi_sw_allocator->AddRequest(req_paras[p].in, req_paras[p].out, req_paras[p].label,
+                                                    req_paras[p].in_pri, req_paras[p].out_pri);
                 }
 
             } else {
                 // What about STALL_BUFFER_RESERVED ?
-                iter->second.second.push_back(STALL_BUFFER_FULL);
+                _multi_sw_alloc_vcs.grant(i) = STALL_BUFFER_FULL;
                 continue;
             }
         }
@@ -731,27 +722,28 @@ void MCRouter::_MultiSWAllocEvaluate() {
     }
 
     _multi_sw_allocator->Allocate();
+    _multi_sw_allocator->CountGrants();
 
     if (watched) {
         *gWatchOut << GetSimTime() << " | " << _multi_sw_allocator->FullName() << " | ";
         _multi_sw_allocator->PrintGrants(gWatchOut);
     }
 
-    for (auto iter = _multi_sw_alloc_vcs.begin(); iter != _multi_sw_alloc_vcs.end(); ++iter) {
+    for (int i = 0; i < _multi_sw_alloc_vcs.size(); ++i) {
 
-        int const time = iter->first;
+        int const time = _multi_sw_alloc_vcs.time(i);
         if (time >= 0) {
             break;
         }
-        iter->first = GetSimTime() + _sw_alloc_delay - 1;
+        _multi_sw_alloc_vcs.time(i) = GetSimTime() + _sw_alloc_delay - 1;
 
-        int const input = iter->second.first.first;
+        int const input = _multi_sw_alloc_vcs.input(i);
         assert((input >= 0) && (input < _inputs));
-        int const vc = iter->second.first.second;
+        int const vc = _multi_sw_alloc_vcs.vc(i);
         assert((vc >= 0) && (vc < _vcs));
 
-        if (!iter->second.second.empty()) {
-            assert(iter->second.second.front() < -1);
+        if (_multi_sw_alloc_vcs.grant(i) != -1) {
+            assert(_multi_sw_alloc_vcs.grant(i) < -1);
             continue;
         }
 
@@ -766,27 +758,26 @@ void MCRouter::_MultiSWAllocEvaluate() {
 
         // int const expanded_input = input * _input_speedup + vc % _input_speedup;
         int const expanded_input = input * _vcs + vc;
-        vector<int> expanded_outputs = _multi_sw_allocator->MultiOutputAssigned(expanded_input);
 
         // Check whether our input port grant the output channel
-        bool input_grant_succeed = true;
-        for (int it: expanded_outputs) {
-            input_grant_succeed &= it >= 0;
-        }
-
-        if (input_grant_succeed) {
+        if (_multi_sw_allocator->MultiOutputGranted(expanded_input)) {
+            int expanded_outputs[FocusFlit::MAX_FANOUT];
+            int const num_outputs = _multi_sw_allocator->MultiOutputAssigned(expanded_input, expanded_outputs);
 
             bool vc_grant_succeed = true;
             // Checkout whether our virtual channel grant the output channel
-            for (int expanded_output: expanded_outputs) {
+            for (int k = 0; k < num_outputs; ++k) {
+                int const expanded_output = expanded_outputs[k];
                 // assert((expanded_output % _output_speedup) == (input % _output_speedup));
                 int const granted_vc = _multi_sw_allocator->ReadRequest(expanded_input, expanded_output);
                 vc_grant_succeed &= granted_vc == vc;
             }
 
             if (vc_grant_succeed) {
-                assert(expanded_outputs.size() == f->GetFanoutFlitNum(GetID()));
-                for (int expanded_output: expanded_outputs) {
+                assert(num_outputs == f->GetFanoutFlitNum(GetID()));
+                _multi_sw_alloc_vcs.grant(i) = num_outputs;
+                for (int k = 0; k < num_outputs; ++k) {
+                    int const expanded_output = expanded_outputs[k];
                     if (f->watch)
                     {
                         *gWatchOut << GetSimTime() << " | " << FullName() << " | "
@@ -800,7 +791,7 @@ void MCRouter::_MultiSWAllocEvaluate() {
                     // FIXME: What's this ??
                     // _sw_rr_offset[expanded_input] = (vc + _input_speedup) % _vcs;
                     // assert(false);
-                    iter->second.second.push_back(expanded_output);
+                    _multi_sw_alloc_vcs.ports(i) |= 1ULL << expanded_output;
                 }
             } else {
                 if (f->watch) {
@@ -809,7 +800,7 @@ void MCRouter::_MultiSWAllocEvaluate() {
                                 << " at input " << input
                                 << ": Granted to VCs" << ". [Multicast Flit]" << endl;
                 }
-                iter->second.second.push_back(STALL_CROSSBAR_CONFLICT);
+                _multi_sw_alloc_vcs.grant(i) = STALL_CROSSBAR_CONFLICT;
             }
         } else {
             if (f->watch) {
@@ -818,7 +809,7 @@ void MCRouter::_MultiSWAllocEvaluate() {
                            << " at input " << input
                            << ": No output granted. [Multicast Flit]" << endl;
             }
-            iter->second.second.push_back(STALL_CROSSBAR_CONFLICT);
+            _multi_sw_alloc_vcs.grant(i) = STALL_CROSSBAR_CONFLICT;
         }
     }
 
@@ -829,17 +820,16 @@ void MCRouter::_MultiSWAllocEvaluate() {
 void MCRouter::_MultiSWAllocUpdate() {
 
     while (!_multi_sw_alloc_vcs.empty()) {
-        auto& item = _multi_sw_alloc_vcs.front();
 
-        int const time = item.first;
+        int const time = _multi_sw_alloc_vcs.time(0);
         if ((time < 0) || (GetSimTime() < time)) {
             break;
         }
         assert(GetSimTime() == time);
 
-        int const input = item.second.first.first;
+        int const input = _multi_sw_alloc_vcs.input(0);
         assert((input >= 0) && (input < _inputs));
-        int const vc = item.second.first.second;
+        int const vc = _multi_sw_alloc_vcs.vc(0);
         assert((vc >= 0) && (vc < _vcs));
 
         MCBuffer *const cur_buf = _mc_buf[input];
@@ -860,34 +850,31 @@ void MCRouter::_MultiSWAllocUpdate() {
                         << "). [multicast]" << endl;
         }
 
-        vector<int> expanded_outputs = item.second.second;
-        assert(!expanded_outputs.empty());
+        int const osize = _multi_sw_alloc_vcs.grant(0);
+        assert(osize != -1);
 
-        bool grant_succeed = true;
-        for (int it: expanded_outputs) {
-            grant_succeed &= it >= 0;
-        }
-
-        if (grant_succeed) {
+        if (osize > 0) {
             int const expanded_input = input * _input_speedup + vc % _input_speedup;
-            int osize = expanded_outputs.size();
+            uint64_t const expanded_outputs = _multi_sw_alloc_vcs.ports(0);
 
-            assert(osize == cur_buf->getMultiOutputs(vc).size());
+            assert(osize == __builtin_popcountll(expanded_outputs));
             assert(osize == f->GetFanoutFlitNum(GetID()));
 
-            vector<FocusFlit*> fanout_flits = f->GetFanoutFlits(GetID());
-            map<int, int> out_pairs = cur_buf->getMultiOutputs(vc);                 // output port -> output vc
+            FocusFlit* fanout_flits[FocusFlit::MAX_FANOUT];
+            int fanout_num = f->GetFanoutFlits(GetID(), fanout_flits);
+            // <output port, output vc>, in ascending order of ports as the granted outputs
+            vector<pair<int, int> > const &out_pairs = cur_buf->getMultiOutputs(vc);
 
-            map<int, int> port_to_target = cur_buf->getPortTargetMap(vc);           // output port -> target
-            map<int, FocusFlit*> target_to_flit;                                   // target -> fanout flits
-            for (FocusFlit* f: fanout_flits) {
-                target_to_flit.insert(make_pair(f->SegEnd(), f));
-            }
+            // The next hop of a flit is only its segment end when it has no intermediate nodes left,
+            // so pair the targets with the flits, which come in the same order
+            int fanout_targets[FocusFlit::MAX_FANOUT];
+            f->GetFanoutFlitTargets(GetID(), fanout_targets);
 
-            assert(fanout_flits.size() == osize && port_to_target.size() == osize && out_pairs.size() == osize);
+            assert(fanout_num == osize && (int)out_pairs.size() == osize);
 
-            // f is a dummy flit who won't reach the end, delete it
-            if (!f->IsRealFlit() && f->IsRetired(GetID())) {
+            // f is a dummy flit who won't reach the end, delete it once it is removed from the buffer
+            bool dummy_retired = !f->IsRealFlit() && f->IsRetired(GetID());
+            if (dummy_retired) {
                 // if (!(std::find(fanout_flits.begin(), fanout_flits.end(), f) == fanout_flits.end() && f->SegEnd() == GetID())) {
                 //     std::cerr << f->id << std::endl;
                 //     std::cerr << f->SegStart() << " " << f->SegEnd() << std::endl;
@@ -896,22 +883,19 @@ void MCRouter::_MultiSWAllocUpdate() {
                 // }
                 // std::cerr << f->id << " " << f->SegEnd() << " " << GetID() << std::endl;
                 // assert(f->SegEnd() == GetID());
-                assert(std::find(fanout_flits.begin(), fanout_flits.end(), f) == fanout_flits.end());
-                f->Free();
+                assert(std::find(fanout_flits, fanout_flits + fanout_num, f) == fanout_flits + fanout_num);
             }
 
-            // Allocator doesn't guarantee the order of requests
-            // out_pairs & expanded_outputs & duplicated_flits should be the same order
-
-            for (int i = 0; i < osize; ++i) {
-                int expanded_output = expanded_outputs[i];
+            int k = 0;
+            for (uint64_t bits = expanded_outputs; bits != 0; bits &= bits - 1, ++k) {
+                int const expanded_output = __builtin_ctzll(bits);
                 int const output = expanded_output / _output_speedup;
 
                 assert((output >= 0) && (output < _outputs));
-                assert(out_pairs.count(output) == 1);
+                assert(out_pairs[k].first == output);
 
                 BufferState *const dest_buf = _next_buf[output];
-                int match_vc = out_pairs[output];
+                int match_vc = out_pairs[k].second;
                 assert((match_vc >= 0) && (match_vc < _vcs));
 
                 if (f->watch) {
@@ -924,8 +908,10 @@ void MCRouter::_MultiSWAllocUpdate() {
                 }
 
                 // assert(outport_to_flit.count(output) == 1);
-                int target = port_to_target[output];
-                FocusFlit* fanout_flit = target_to_flit[target];
+                int const target = cur_buf->getPortTarget(vc, output);
+                int const j = std::find(fanout_targets, fanout_targets + fanout_num, target) - fanout_targets;
+                assert(j < fanout_num);
+                FocusFlit* fanout_flit = fanout_flits[j];
                 fanout_flit->hops = f->hops + 1;
                 fanout_flit->vc = match_vc;
 
@@ -952,8 +938,8 @@ void MCRouter::_MultiSWAllocUpdate() {
                 }
                 _switch_hold_vc[expanded_input] = -1;
                 _switch_hold_in[expanded_input] = -1;
-                for (int expanded_output: expanded_outputs) {
-                    _switch_hold_out[expanded_output] = -1;
+                for (uint64_t bits = expanded_outputs; bits != 0; bits &= bits - 1) {
+                    _switch_hold_out[__builtin_ctzll(bits)] = -1;
                 }
                 if (f->tail) {
                     cur_buf->SetState(vc, VC::idle);
@@ -974,24 +960,28 @@ void MCRouter::_MultiSWAllocUpdate() {
                     }
                     _switch_hold_vc[expanded_input] = -1;
                     _switch_hold_in[expanded_input] = -1;
-                    for (int expanded_output: expanded_outputs) {
-                        _switch_hold_out[expanded_output] = -1;
+                    for (uint64_t bits = expanded_outputs; bits != 0; bits &= bits - 1) {
+                        _switch_hold_out[__builtin_ctzll(bits)] = -1;
                     }
                     cur_buf->SetState(vc, VC::routing);
-                    _multi_route_vcs.push_back(make_pair(-1, item.second.first));
+                    _multi_route_vcs.push_back(input, vc);
 
                 } else {
-                    _multi_sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first, vector<int>())));
+                    _multi_sw_alloc_vcs.push_back(input, vc);
                 }
             }
 
+            if (dummy_retired) {
+                f->Free();
+            }
+
         } else {
             if (f->watch)
             {
                 *gWatchOut << GetSimTime() << " | " << FullName() << " | "
                         << "  No output port allocated." << endl;
             }
-            _multi_sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first, vector<int>())));
+            _multi_sw_alloc_vcs.push_back(input, vc);
         }
         _multi_sw_alloc_vcs.pop_front();
     }
@@ -1002,7 +992,8 @@ void MCRouter::_MultiSWAllocUpdate() {
 MCRouter::MCRouter(
     Configuration const & config, Module *parent,
     string const & name, int id, int inputs, int outputs
-) : IQRouter(config, parent, name, id, inputs, outputs)
+) : IQRouter(config, parent, name, id, inputs, outputs), _vc_rng(id + 1), 
+    _window_requests(0), _window_grants(0)
 {
 
     string multi_vc_alloc_type = config.GetStr("multi_vc_allocator");
@@ -1011,8 +1002,8 @@ MCRouter::MCRouter(
                                                   multi_vc_alloc_type,
                                                   _vcs * _inputs,
                                                   _vcs * _outputs);
-    assert(typeid(*temp) == typeid(MultiOutputSparseAllocator));
-    _multi_vc_allocator = static_cast<MultiOutputSparseAllocator*>(temp);
+    assert(typeid(*temp) == typeid(MultiOutputAllocator));
+    _multi_vc_allocator = static_cast<MultiOutputAllocator*>(temp);
 
     if (!_multi_vc_allocator) {
       Error("Unknown vc_allocator type: " + multi_vc_alloc_type);
@@ -1025,13 +1016,19 @@ MCRouter::MCRouter(
                                                   _inputs * _vcs,
                                                 //   _inputs * _input_speedup,
                                                   _outputs * _output_speedup);
-    assert(typeid(*temp) == typeid(MultiOutputSparseAllocator));
-    _multi_sw_allocator = static_cast<MultiOutputSparseAllocator*>(temp);
+    assert(typeid(*temp) == typeid(MultiOutputAllocator));
+    _multi_sw_allocator = static_cast<MultiOutputAllocator*>(temp);
 
     if (!_multi_sw_allocator) {
         Error("Unknown sw_allocator type: " + multi_sw_alloc_type);
     }
 
+    assert(_outputs * _output_speedup <= 64);
+    int const stage_capacity = _inputs * _vcs + 1;
+    _multi_route_vcs = StageQueue(stage_capacity);
+    _multi_vc_alloc_vcs = StageQueue(stage_capacity);
+    _multi_sw_alloc_vcs = StageQueue(stage_capacity);
+
     _mc_buf.resize(_inputs);
     for (int i = 0; i < _inputs; ++i) {
         ostringstream module_name;
@@ -1042,20 +1039,79 @@ MCRouter::MCRouter(
 
 }
 
-double MCRouter::ConflictFactor() const {
-    // Calculate conflict factor based on switch allocation conflicts
-    // This is a simplified implementation - in a real system, you might want to track
-    // actual conflicts over time and return a more sophisticated metric
-    
-    int total_requests = 0;
-    int total_conflicts = 0;
-    
-    // Count conflicts from switch allocation
-    if (_multi_sw_allocator) {
-        // This is a simplified approach - in practice you'd want to track actual conflicts
-        // For now, return a reasonable default value
-        return 0.1; // 10% conflict rate as a default
+MCRouter::~MCRouter()
+{
+    for (int i = 0; i < _inputs; ++i) {
+        delete _mc_buf[i];
+    }
+    delete _multi_vc_allocator;
+    delete _multi_sw_allocator;
+}
+
+bool MCRouter::Idle() const {
+    return IQRouter::Idle() && _multi_route_vcs.empty() && 
+           _multi_vc_alloc_vcs.empty() && _multi_sw_alloc_vcs.empty();
+}
+
+void MCRouter::Checkpoint(spatial::StateArchive & ar) {
+    IQRouter::Checkpoint(ar);
+    for (MCBuffer* buf: _mc_buf) {
+        buf->Checkpoint(ar);
+    }
+    ar & _multi_route_vcs & _multi_vc_alloc_vcs & _multi_sw_alloc_vcs;
+    _multi_vc_allocator->Checkpoint(ar);
+    _multi_sw_allocator->Checkpoint(ar);
+    ar & _vc_rng & _window_requests & _window_grants;
+}
+
+// Multicast flits wait in their own buffer of the input
+int MCRouter::GetBufferOccupancy(int i) const {
+    return IQRouter::GetBufferOccupancy(i) + _mc_buf[i]->GetOccupancy();
+}
+
+// Outputs of the VC allocators are output VCs, those of the switch allocators
+// are the output ports times the output speedup
+static void AddPortConflicts(const Allocator* alloc, int outputs_per_port, 
+                             vector<unsigned long>& requests, vector<unsigned long>& grants) {
+    if (alloc == NULL) {
+        return;
+    }
+    for (int out = 0; out < alloc->NumOutputs(); ++out) {
+        requests[out / outputs_per_port] += alloc->Requests(out);
+        grants[out / outputs_per_port] += alloc->Grants(out);
+    }
+}
+
+void MCRouter::PortConflicts(vector<unsigned long>& requests, vector<unsigned long>& grants) const {
+    requests.assign(_outputs, 0);
+    grants.assign(_outputs, 0);
+    AddPortConflicts(_vc_allocator, _vcs, requests, grants);
+    AddPortConflicts(_sw_allocator, _output_speedup, requests, grants);
+    AddPortConflicts(_multi_vc_allocator, _vcs, requests, grants);
+    AddPortConflicts(_multi_sw_allocator, _output_speedup, requests, grants);
+}
+
+double MCRouter::ConflictFactor(bool window) const {
+    vector<unsigned long> requests, grants;
+    PortConflicts(requests, grants);
+    unsigned long total_requests = 0, total_grants = 0;
+    for (int port = 0; port < _outputs; ++port) {
+        total_requests += requests[port];
+        total_grants += grants[port];
+    }
+    if (window) {
+        total_requests -= _window_requests;
+        total_grants -= _window_grants;
+    }
+    return total_requests > 0 ? 1.0 - (double)total_grants / total_requests : 0.0;
+}
+
+void MCRouter::StartConflictWindow() {
+    vector<unsigned long> requests, grants;
+    PortConflicts(requests, grants);
+    _window_requests = _window_grants = 0;
+    for (int port = 0; port < _outputs; ++port) {
+        _window_requests += requests[port];
+        _window_grants += grants[port];
     }
-    
-    return 0.0; // No conflicts if no allocator
 }
\ No newline at end of file
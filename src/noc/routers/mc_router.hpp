@@ -1,9 +1,9 @@
 #ifndef __MC_ROUTER_HPP_
 #define __MC_ROUTER_HPP_
 
-#include <deque>
 #include <vector>
 #include <map>
+#include <random>
 #include "iq_router.hpp"
 #include "router.hpp"
 #include "buffer.hpp"
@@ -19,18 +19,28 @@ protected:
     vector<MCBuffer* > _mc_buf;
 
     // Seperated Control Pane For Multicast
-    deque<pair<int, pair<int, int> > > _multi_route_vcs;
-    deque<pair<int, pair<pair<int, int>, vector<int> > > > _multi_vc_alloc_vcs;
-    // deque<pair<int, pair<pair<int, int>, vector<int> > > > _multi_sw_hold_vcs;
-    deque<pair<int, pair<pair<int, int>, vector<int> > > > _multi_sw_alloc_vcs;
+    // Granted outputs are kept as port masks, hence at most 64 of them
+    StageQueue _multi_route_vcs;
+    StageQueue _multi_vc_alloc_vcs;     // granted the number of outputs
+    // StageQueue _multi_sw_hold_vcs;
+    StageQueue _multi_sw_alloc_vcs;     // granted the number of outputs
 
     // Sparse allocator
-    MultiOutputSparseAllocator* _multi_sw_allocator;
-    MultiOutputSparseAllocator* _multi_vc_allocator;
+    MultiOutputAllocator* _multi_sw_allocator;
+    MultiOutputAllocator* _multi_vc_allocator;
+
+    // Picks output VCs for multicast flits. It's private to the router so that
+    // routers can be evaluated in any order, or in parallel.
+    minstd_rand _vc_rng;
+
+    // Requests and grants of all its allocators when the window started
+    unsigned long _window_requests, _window_grants;
 
 public:
 
     virtual void _InternalStep() override;
+    virtual bool Idle() const override;
+    virtual int GetBufferOccupancy(int i) const override;
 
     void _FlitDispatch();    // This function replaces InputQueueing to dispatch incoming flits to different control panes. 
                              // Flits with more than one fanouts are processed by new functions headed with _multi.
@@ -48,11 +58,20 @@ public:
     void _MultiSWAllocUpdate( );
     void _MultiSwitchUpdate( );
 
-    // Get conflict factor for router statistics
-    double ConflictFactor() const;
+    virtual void Checkpoint( spatial::StateArchive & ar ) override;
+
+    // Requests to each output port and the ones granted, summed over the
+    // unicast and multicast VC and switch allocators since the router was built
+    void PortConflicts(vector<unsigned long>& requests, vector<unsigned long>& grants) const;
+
+    // The share of requests denied by the allocators since the router was
+    // built, or since the window started if `window`
+    double ConflictFactor(bool window = false) const;
+    void StartConflictWindow();
 
     MCRouter( Configuration const & config, Module *parent, string const & name, int id,
               int inputs, int outputs );
+    virtual ~MCRouter( );
 
 };
 
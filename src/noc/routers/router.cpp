@@ -41,6 +41,7 @@
 #include "booksim.hpp"
 #include <iostream>
 #include <cassert>
+#include <cmath>
 #include "router.hpp"
 
 //////////////////Sub router types//////////////////////
@@ -93,6 +94,7 @@ void Router::AddInputChannel( FlitChannel *channel, CreditChannel *backchannel )
   _input_channels.push_back( channel );
   _input_credits.push_back( backchannel );
   channel->SetSink( this, _input_channels.size() - 1 ) ;
+  channel->SetReader( this );
 }
 
 void Router::AddOutputChannel( FlitChannel *channel, CreditChannel *backchannel )
@@ -101,6 +103,7 @@ void Router::AddOutputChannel( FlitChannel *channel, CreditChannel *backchannel
   _output_credits.push_back( backchannel );
   _channel_faults.push_back( false );
   channel->SetSource( this, _output_channels.size() - 1 ) ;
+  backchannel->SetReader( this );
 }
 
 void Router::Evaluate( )
@@ -112,6 +115,26 @@ void Router::Evaluate( )
   }
 }
 
+void Router::Skip( int cycles )
+{
+  // An idle router only keeps the phase of its internal clock
+  _partial_internal_cycles = fmod( _partial_internal_cycles + cycles * _internal_speedup, 1.0 );
+}
+
+void Router::Checkpoint( spatial::StateArchive & ar )
+{
+  ar.Check(_inputs, "the number of router inputs");
+  ar.Check(_outputs, "the number of router outputs");
+  ar & _partial_internal_cycles & _channel_faults;
+#ifdef TRACK_FLOWS
+  ar & _received_flits & _stored_flits & _sent_flits & _outstanding_credits & _active_packets;
+#endif
+#ifdef TRACK_STALLS
+  ar & _buffer_busy_stalls & _buffer_conflict_stalls & _buffer_full_stalls 
+     & _buffer_reserved_stalls & _crossbar_conflict_stalls;
+#endif
+}
+
 void Router::OutChannelFault( int c, bool fault )
 {
   assert( ( c >= 0 ) && ( (size_t)c < _channel_faults.size( ) ) );
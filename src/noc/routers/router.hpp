@@ -116,6 +116,10 @@ public:
   virtual void ReadInputs( ) = 0;
   virtual void Evaluate( );
   virtual void WriteOutputs( ) = 0;
+  virtual void Skip( int cycles );
+
+  // Saves or loads the dynamic state of the router and of what it owns
+  virtual void Checkpoint( spatial::StateArchive & ar );
 
   void OutChannelFault( int c, bool fault = true );
   bool IsFaultyOutput( int c ) const;
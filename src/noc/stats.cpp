@@ -168,6 +168,31 @@ void Stats::AddNodeSample( double val, int dest )
   _node_hist[dest][b]++;
 }
 
+// Of the MAX_NODES per-node statistics, only the ones with samples are written
+void Stats::Checkpoint( spatial::StateArchive & ar )
+{
+  ar.Check(_num_bins, "the number of histogram bins");
+  if ( ar.loading() ) {
+    Clear();
+  }
+  ar & _num_samples & _sample_sum & _sample_squared_sum & _min & _max & _hist;
+
+  vector<int> nodes;
+  for (int i = 0; i < MAX_NODES; i++) {
+    if (_node_num_samples[i] > 0) {
+      nodes.push_back(i);
+    }
+  }
+  ar & nodes;
+  for (int i: nodes) {
+    if (i < 0 || i >= MAX_NODES) {
+      throw string("The checkpoint has statistics of an unknown node");
+    }
+    ar & _node_num_samples[i] & _node_sample_sum[i] & _node_min[i] & _node_max[i]
+       & _node_slowdown_sum[i] & _node_hist[i];
+  }
+}
+
 void Stats::Display( ostream & os ) const
 {
   os << *this << endl;
@@ -64,7 +64,8 @@ TrafficManager * TrafficManager::New(Configuration const & config,
 
 TrafficManager::TrafficManager( const Configuration &config, const vector<Network *> & net )
     : Module( 0, "traffic_manager" ), _net(net), _empty_network(false), _deadlock_timer(0),
-      _reset_time(0), _drain_time(-1), _cur_id(0), _cur_pid(0), _time(0), _send_queues(nullptr), _receive_queues(nullptr)
+      _reset_time(0), _drain_time(-1), _cur_id(0), _cur_pid(0), _time(0), _send_queues(nullptr), _receive_queues(nullptr),
+      _event_log(&spatial::EventLog::Default())
 {
 
     _nodes = _net[0]->NumNodes( );
@@ -291,6 +292,7 @@ TrafficManager::TrafficManager( const Configuration &config, const vector<Networ
     _total_in_flight_flits.resize(_classes);
     _measured_in_flight_flits.resize(_classes);
     _retired_packets.resize(_classes);
+    _ejected.assign(_subnets, vector<Flit *>(_nodes, NULL));
 
     _packet_seq_no.resize(_nodes);
     _repliesPending.resize(_nodes);
@@ -624,7 +626,6 @@ TrafficManager::~TrafficManager( )
         }
     }
   
-    if(gWatchOut && (gWatchOut != &cout)) delete gWatchOut;
     if(_stats_out && (_stats_out != &cout)) delete _stats_out;
 
 #ifdef TRACK_FLOWS
@@ -657,12 +658,10 @@ void TrafficManager::_RetireFlit( Flit *f, int dest )
     FocusFlit* ff = static_cast<FocusFlit*>(f);
     assert(ff->IsRealFlit());
 
-    assert(_total_in_flight_flits[f->cl].count(f->id) > 0);
-    _total_in_flight_flits[f->cl].erase(f->id);
+    _total_in_flight_flits[f->cl].Erase(f);
   
     if(f->record) {
-        assert(_measured_in_flight_flits[f->cl].count(f->id) > 0);
-        _measured_in_flight_flits[f->cl].erase(f->id);
+        _measured_in_flight_flits[f->cl].Erase(f);
     }
 
     if ( f->watch ) { 
@@ -875,19 +874,21 @@ void TrafficManager::_GeneratePacket( int source, int stype,
                    << "." << endl;
     }
 
-    FocusFlit* head_flits = NULL;
-    
+    // Every flit of the packet refers to the tree of the packet on its board
+    int root_seg;
+    if (pkt.type == spatial::Packet::TransferType::_MULTICAST) {
+        root_seg = pkt.board->findSeg(pkt.tree, make_pair(TREESTART, source));
+    } else {
+        std::vector<int> dests = pkt.board->getDestNodes(pkt.tree);
+        assert(dests.size() == 1);
+        root_seg = pkt.board->findSeg(pkt.tree, make_pair(source, dests.front()));
+    }
+    assert(root_seg >= 0);
+
     for ( int i = 0; i < size; ++i ) {
         // Flit * f  = Flit::New();
 
-        FocusFlit* root = nullptr;
-        if (pkt.type == spatial::Packet::TransferType::_MULTICAST) {
-            root = FocusFlit::NewFlitTree(pkt.path, make_pair(TREESTART, source));
-        } else {
-            std::set<int> dests = pkt.path->getDestNodes();
-            assert(dests.size() == 1);
-            root = FocusFlit::NewFlitTree(pkt.path, make_pair(source, *dests.begin()));
-        }
+        FocusFlit* root = FocusFlit::NewFlitTree(pkt.board, root_seg);
 
         // Set the flits by bfs
         std::queue<FocusFlit*> bfs;
@@ -895,7 +896,7 @@ void TrafficManager::_GeneratePacket( int source, int stype,
 
         while (!bfs.empty()) {
             FocusFlit* f = bfs.front();
-            for (FocusFlit* child: f->GetChilds()) {
+            for (FocusFlit* child = f->FirstChild(); child; child = child->NextSibling()) {
                 bfs.push(child);
             }
             bfs.pop();
@@ -923,13 +924,13 @@ void TrafficManager::_GeneratePacket( int source, int stype,
 
             bool true_flit = f->IsRealFlit();                                   // Whether this flit will be received by someone
             if (true_flit) {
-                _total_in_flight_flits[f->cl].insert(make_pair(f->id, f));      // Erase it in getDuplicateFlits & _RetireFlits
+                _total_in_flight_flits[f->cl].Insert(f);      // Erase it in getDuplicateFlits & _RetireFlits
                 if (record) {
-                    _measured_in_flight_flits[f->cl].insert(make_pair(f->id, f));
+                    _measured_in_flight_flits[f->cl].Insert(f);
                 }
             }
             if (gTrace) {
-                std::cout << "New Flit " << f->src << endl;
+                *spatial::SimContext::Current()->log << "New Flit " << f->src << endl;
             }
             
             if (i == 0) {
@@ -972,14 +973,6 @@ void TrafficManager::_GeneratePacket( int source, int stype,
             }
         }
 
-        if (i == 0) {
-            head_flits = root;
-        }
-        if (root->tail) {
-            assert(head_flits != NULL);
-            root->SyncWithHeadFlit(head_flits);
-        }
-
         // FIXME: For each flit within the tree
         // f->id     = _cur_id++;
         // assert(_cur_id);
@@ -1068,8 +1061,6 @@ void TrafficManager::_Step( )
         cout << "WARNING: Possible network deadlock.\n";
     }
 
-    vector<map<int, Flit *> > flits(_subnets);
-
     for ( int subnet = 0; subnet < _subnets; ++subnet ) {
         for ( int n = 0; n < _nodes; ++n ) {
             Flit * const f = _net[subnet]->ReadFlit( n );
@@ -1082,7 +1073,7 @@ void TrafficManager::_Step( )
                                << " from VC " << f->vc
                                << "." << endl;
                 }
-                flits[subnet].insert(make_pair(n, f));
+                _ejected[subnet][n] = f;
                 if((_sim_state == warming_up) || (_sim_state == running)) {
                     ++_accepted_flits[f->cl][n];
                     if(f->tail) {
@@ -1165,7 +1156,7 @@ void TrafficManager::_Step( )
 	  
                     OutputSet route_set;
                     _rf(NULL, cf, -1, &route_set, true);
-                    set<OutputSet::sSetElement> const & os = route_set.GetSet();
+                    vector<OutputSet::sSetElement> const & os = route_set.GetSet();
                     assert(os.size() == 1);
                     OutputSet::sSetElement const & se = *os.begin();
                     assert(se.output_port == -1);
@@ -1192,7 +1183,7 @@ void TrafficManager::_Step( )
                                        << "Generating lookahead routing info for flit " << cf->id
                                        << " (NOQ)." << endl;
                         }
-                        set<OutputSet::sSetElement> const sl = cf->la_route_set.GetSet();
+                        vector<OutputSet::sSetElement> const sl = cf->la_route_set.GetSet();
                         assert(sl.size() == 1);
                         int next_output = sl.begin()->output_port;
                         vc_count /= router->NumOutputs();
@@ -1344,9 +1335,9 @@ void TrafficManager::_Step( )
 
     for(int subnet = 0; subnet < _subnets; ++subnet) {
         for(int n = 0; n < _nodes; ++n) {
-            map<int, Flit *>::const_iterator iter = flits[subnet].find(n);
-            if(iter != flits[subnet].end()) {
-                Flit * const f = iter->second;
+            Flit * const f = _ejected[subnet][n];
+            if(f) {
+                _ejected[subnet][n] = NULL;
 
                 f->atime = _time;
                 if(f->watch) {
@@ -1363,11 +1354,10 @@ void TrafficManager::_Step( )
 #ifdef TRACK_FLOWS
                 ++_ejected_flits[f->cl][n];
 #endif
-                std::cout << "Retiring flit " << f->id << " (packet " << f->pid << ", src = " << f->src << ", dest = " << f->dest << ", hops = " << f->hops << ", flat = " << f->atime - f->itime << ")." << std::endl;
+                _event_log->Log(spatial::EVENT_RETIRE_FLIT, _time, f->id, f->pid, f->src, f->dest, f->hops, f->atime - f->itime);
                 _RetireFlit(f, n);
             }
         }
-        flits[subnet].clear();
         _net[subnet]->Evaluate( );
         _net[subnet]->WriteOutputs( );
     }
@@ -1377,23 +1367,118 @@ void TrafficManager::_Step( )
     // if(gTrace) {
     //     cout<<"TIME "<<_time<<endl;
     // }
+}
+  
+// Nothing is in flight or waiting to be injected, and the network won't change
+// until something is sent into it
+bool TrafficManager::Idle( ) const
+{
+    for ( int c = 0; c < _classes; ++c ) {
+        if ( !_total_in_flight_flits[c].empty() ) {
+            return false;
+        }
+    }
+    for ( int n = 0; n < _nodes; ++n ) {
+        if ( !(*_send_queues)[n]->empty() || !_repliesPending[n].empty() ) {
+            return false;
+        }
+        for ( int c = 0; c < _classes; ++c ) {
+            if ( !_partial_packets[n][c].empty() ) {
+                return false;
+            }
+        }
+    }
+    for ( int subnet = 0; subnet < _subnets; ++subnet ) {
+        if ( !_net[subnet]->Idle() ) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    // dump waiting flits
-#ifdef DUMP_WAITING_FLITS
-    int waiting_flits = 0;
-    for (int n = 0; n < _nodes; ++n) {
-        waiting_flits += _partial_packets[n][0].size();
+// Advance an idle network by the given number of cycles, leaving it in the 
+// same state as that many calls to _Step(). The only per-cycle work of an idle
+// step is _Inject() catching each queue time up with _time without generating
+// a packet.
+void TrafficManager::_Skip( int cycles )
+{
+    assert(Idle());
+    if ( !_empty_network ) {
+        int const time = _time + cycles;
+        for ( int input = 0; input < _nodes; ++input ) {
+            for ( int c = 0; c < _classes; ++c ) {
+                if ( _qtime[input][c] < time ) {
+                    if ( !_use_read_write[c] ) {
+                        _requestsOutstanding[input] += time - _qtime[input][c];
+                    }
+                    _qtime[input][c] = time;
+                }
+                if ( ( _sim_state == draining ) && 
+                     ( _qtime[input][c] > _drain_time ) ) {
+                    _qdrained[input][c] = true;
+                }
+            }
+        }
     }
-    int in_flight_flits = _total_in_flight_flits[0].size();
-    if (_time < 10000) {
-        ofstream ofs("dump_flits.txt", std::ofstream::out | std::ofstream::app);
-        ofs << _time << " " << waiting_flits << " " << in_flight_flits << std::endl;
-        ofs.close();
+    for ( int subnet = 0; subnet < _subnets; ++subnet ) {
+        _net[subnet]->Skip( cycles );
     }
+    _time += cycles;
+}
+  
+void TrafficManager::Checkpoint( spatial::StateArchive & ar )
+{
+    ar.Check(_nodes, "the number of nodes");
+    ar.Check(_classes, "the number of traffic classes");
+    ar.Check(_subnets, "the number of subnets");
+
+    ar & _last_class;
+    for ( int n = 0; n < _nodes; ++n ) {
+        for ( int subnet = 0; subnet < _subnets; ++subnet ) {
+            _buf_states[n][subnet]->Checkpoint(ar);
+        }
+    }
+    ar & _last_vc & _qtime & _qdrained & _partial_packets;
+    for ( int c = 0; c < _classes; ++c ) {
+        _total_in_flight_flits[c].Checkpoint(ar);
+        _measured_in_flight_flits[c].Checkpoint(ar);
+    }
+
+    ar & _retired_packets & _empty_network & _deadlock_timer & _packet_seq_no 
+       & _requestsOutstanding;
+
+    // Every Stats object is registered by name
+    ar.Check((int)_stats.size(), "the number of statistics");
+    for ( map<string, Stats *>::iterator iter = _stats.begin(); iter != _stats.end(); ++iter ) {
+        iter->second->Checkpoint(ar);
+    }
+    ar & _overall_min_plat & _overall_avg_plat & _overall_max_plat
+       & _overall_min_nlat & _overall_avg_nlat & _overall_max_nlat
+       & _overall_min_flat & _overall_avg_flat & _overall_max_flat
+       & _overall_min_frag & _overall_avg_frag & _overall_max_frag
+       & _overall_hop_stats
+       & _sent_packets & _overall_min_sent_packets & _overall_avg_sent_packets & _overall_max_sent_packets
+       & _accepted_packets & _overall_min_accepted_packets & _overall_avg_accepted_packets & _overall_max_accepted_packets
+       & _sent_flits & _overall_min_sent & _overall_avg_sent & _overall_max_sent
+       & _accepted_flits & _overall_min_accepted & _overall_avg_accepted & _overall_max_accepted
+       & _slowest_packet & _slowest_flit;
+#ifdef TRACK_STALLS
+    ar & _buffer_busy_stalls & _buffer_conflict_stalls & _buffer_full_stalls
+       & _buffer_reserved_stalls & _crossbar_conflict_stalls
+       & _overall_buffer_busy_stalls & _overall_buffer_conflict_stalls & _overall_buffer_full_stalls
+       & _overall_buffer_reserved_stalls & _overall_crossbar_conflict_stalls;
+#endif
+#ifdef TRACK_FLOWS
+    ar & _outstanding_credits & _outstanding_classes & _injected_flits & _ejected_flits;
 #endif
 
+    ar & _sim_state & _reset_time & _drain_time & _cur_id & _cur_pid & _time;
+
+    for ( int subnet = 0; subnet < _subnets; ++subnet ) {
+        _net[subnet]->Checkpoint(ar);
+    }
 }
-  
+
 bool TrafficManager::_PacketsOutstanding( ) const
 {
     for ( int c = 0; c < _classes; ++c ) {
@@ -1504,30 +1589,33 @@ void TrafficManager::_DisplayRemaining( ostream & os ) const
 {
     for(int c = 0; c < _classes; ++c) {
 
-        map<int, Flit *>::const_iterator iter;
-        int i;
-
         os << "Class " << c << ":" << endl;
 
         os << "Remaining flits: ";
-        for ( iter = _total_in_flight_flits[c].begin( ), i = 0;
-              ( iter != _total_in_flight_flits[c].end( ) ) && ( i < 50 );
+#ifdef TRACK_IN_FLIGHT_FLITS
+        set<int>::const_iterator iter;
+        int i;
+        for ( iter = _total_in_flight_flits[c].Ids().begin( ), i = 0;
+              ( iter != _total_in_flight_flits[c].Ids().end( ) ) && ( i < 50 );
               iter++, i++ ) {
-            os << iter->first << " ";
+            os << *iter << " ";
         }
         if(_total_in_flight_flits[c].size() > 50)
             os << "[...] ";
+#endif
     
         os << "(" << _total_in_flight_flits[c].size() << " flits)" << endl;
     
         os << "Measured flits: ";
-        for ( iter = _measured_in_flight_flits[c].begin( ), i = 0;
-              ( iter != _measured_in_flight_flits[c].end( ) ) && ( i < 10 );
+#ifdef TRACK_IN_FLIGHT_FLITS
+        for ( iter = _measured_in_flight_flits[c].Ids().begin( ), i = 0;
+              ( iter != _measured_in_flight_flits[c].Ids().end( ) ) && ( i < 10 );
               iter++, i++ ) {
-            os << iter->first << " ";
+            os << *iter << " ";
         }
         if(_measured_in_flight_flits[c].size() > 10)
             os << "[...] ";
+#endif
     
         os << "(" << _measured_in_flight_flits[c].size() << " flits)" << endl;
     
@@ -1585,13 +1673,8 @@ bool TrafficManager::_SingleSim( )
             double latency = (double)_plat_stats[c]->Sum();
             double count = (double)_plat_stats[c]->NumSamples();
       
-            map<int, Flit *>::const_iterator iter;
-            for(iter = _total_in_flight_flits[c].begin(); 
-                iter != _total_in_flight_flits[c].end(); 
-                iter++) {
-                latency += (double)(_time - iter->second->ctime);
-                count++;
-            }
+            latency += (double)_total_in_flight_flits[c].Age(_time);
+            count += (double)_total_in_flight_flits[c].size();
       
             if((lat_exc_class < 0) &&
                (_latency_thres[c] >= 0.0) &&
@@ -1690,13 +1773,8 @@ bool TrafficManager::_SingleSim( )
                         double acc_latency = _plat_stats[c]->Sum();
                         double acc_count = (double)_plat_stats[c]->NumSamples();
 	    
-                        map<int, Flit *>::const_iterator iter;
-                        for(iter = _total_in_flight_flits[c].begin(); 
-                            iter != _total_in_flight_flits[c].end(); 
-                            iter++) {
-                            acc_latency += (double)(_time - iter->second->ctime);
-                            acc_count++;
-                        }
+                        acc_latency += (double)_total_in_flight_flits[c].Age(_time);
+                        acc_count += (double)_total_in_flight_flits[c].size();
 	    
                         if((acc_latency / acc_count) > threshold) {
                             lat_exc_class = c;
@@ -1775,11 +1853,6 @@ void TrafficManager::SetupSim(PCNInterfaceSet send_queues, PCNInterfaceSet recei
     ofs_node.close();
 #endif
 
-#ifdef DUMP_WAITING_FLITS
-    ofstream ofs_flit("dump_flits.txt", std::ofstream::out);
-    ofs_flit.close();
-#endif
-
     _sim_state = running;
 }
 
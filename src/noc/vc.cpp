@@ -156,6 +156,25 @@ void VC::SetState(eVCState s)
   _state = s;
 }
 
+void VC::Checkpoint(spatial::StateArchive &ar)
+{
+  ar & _buffer & _state & _out_port & _out_vc & _pri & _watched
+     & _expected_pid & _last_id & _last_pid;
+  if (!_lookahead_routing)
+  {
+    ar & *_route_set;
+    return;
+  }
+  // A lookahead route set is the one carried by the head flit, which is still
+  // at the front while the VC routes or allocates
+  bool in_front = _route_set && !_buffer.empty() && _route_set == &_buffer.front()->la_route_set;
+  ar & in_front;
+  if (ar.loading())
+  {
+    _route_set = in_front ? &_buffer.front()->la_route_set : NULL;
+  }
+}
+
 const OutputSet *VC::GetRouteSet() const
 {
   return _route_set;
@@ -1,17 +1,55 @@
 #include <string>
+#include <cstring>
 #include <fstream>
+#include <iterator>
+#include <set>
+#include <stdexcept>
 #include "math.h"
+#include <algorithm>
 #include "config_utils.hpp"
 #include "noc.hpp"
 #include "core_array.hpp"
 #include "spatial_chip.hpp"
 #include "spatial_config.hpp"
+#include "flit.hpp"
+#include "credit.hpp"
 #include "time.h"
 
 namespace spatial {
 
-SpatialChip::SpatialChip(std::string spatial_chip_spec) {
+// Magic and version of checkpoint files, followed by the archived state
+static const char CHECKPOINT_MAGIC[8] = {'S', 'P', 'C', 'K', 'P', 'T', '\0', '\0'};
+static const uint32_t CHECKPOINT_VERSION = 7;
+
+// Parameters the cores, the interface queues or the logs are built from, which
+// reconfigure() can't change
+static const std::set<std::string> CHIP_PARAMETERS = {
+    "k", "n", "array_size", "tasks", "working_directory", "workload_cache", "routing_board", "threshold", 
+    "channel_width", "load_threads", "core_threads", "log_file", "log_level", "log_categories", "event_log"
+};
+// Parameters only run() reads
+static const std::set<std::string> RUN_PARAMETERS = {
+    "deadlock_check_freq", "fast_forward", "telemetry_interval", "telemetry_samples", "telemetry_file"
+};
+
+// Columns of the telemetry, in the order _readTelemetry fills them
+enum TelemetryColumn {
+    TELEMETRY_CYCLE, TELEMETRY_LINK_FLITS, TELEMETRY_ROUTER_OCCUPANCY, TELEMETRY_WAITING_FLITS, 
+    TELEMETRY_IN_FLIGHT_FLITS, TELEMETRY_CORE_BUSY, TELEMETRY_CORE_IDLE, TELEMETRY_NI_SEND_DEPTH, 
+    TELEMETRY_NI_RECEIVE_DEPTH
+};
+
+
+static void checkTelemetryInterval(const SpatialSimConfig& config) {
+    int interval = config.GetInt("telemetry_interval");
+    if (interval > 0 && interval < TELEMETRY_MIN_INTERVAL) {
+        throw "telemetry_interval is " + std::to_string(interval) + ", it is either 0 or at least " 
+              + std::to_string(TELEMETRY_MIN_INTERVAL);
+    }
+}
+
 
+SpatialSimConfig SpatialChip::_parseSpec(const std::string& spatial_chip_spec) {
     SpatialSimConfig config;
 
     // Parse config file
@@ -23,12 +61,35 @@ SpatialChip::SpatialChip(std::string spatial_chip_spec) {
         exit(0);
     } 
     config.checkConsistency();
-    _config = config;
+    return config;
+}
+
+
+SpatialChip::SpatialChip(std::string spatial_chip_spec): SpatialChip(_parseSpec(spatial_chip_spec)) { }
+
+
+SpatialChip::SpatialChip(const SpatialSimConfig& config): _context(new SimContext()), _config(config) {
+    _build(nullptr);
+}
+
+
+SpatialChip::SpatialChip(const SpatialSimConfig& config, const CoreArray& parent_cores)
+    : _context(new SimContext()), _config(config) {
+    _build(&parent_cores);
+}
+
+
+// The cores are built from the task files, or share the compiled tasks of 
+// `parent_cores` if given
+void SpatialChip::_build(const CoreArray* parent_cores) {
+    SimContext::Scope scope(_context.get());
+    const SpatialSimConfig& config = _config;
+    checkTelemetryInterval(config);
 
     // Initialize the interface queues between cores and nocs
     int k = config.GetInt("k");
     int n = config.GetInt("n");
-    array_size = (int)std::pow(k, n);
+    int array_size = (int)std::pow(k, n);
 
     _send_queues = std::make_shared<std::vector<CNInterface> >();
     _received_queues = std::make_shared<std::vector<CNInterface> >();
@@ -41,105 +102,374 @@ SpatialChip::SpatialChip(std::string spatial_chip_spec) {
     }
     _credit_board->resize(array_size, true);
 
-    std::streambuf *backup = std::cout.rdbuf();
-    // redirect the standard output stream into log file
+    // Everything the simulation prints goes into the log file
     if (config.GetStr("log_file") != "-") {
         _log_file = new ofstream(config.GetStr("log_file"), std::ios::out);
         if (!(*_log_file)) {
-            std::cerr << "Log file doesn't exist !! " << std::endl;
-            throw "Wrong 1";
+            delete _log_file;
+            throw "Log file doesn't exist !! " + config.GetStr("log_file");
         }
-        // _log_file = std::ofstream(config.GetStr("log_file"), std::ios::out);
-        std::cout.rdbuf(_log_file->rdbuf());
     } else {
         _log_file = &std::cout;
     }
+    _context->log = _log_file;
 
     try {
+        // Traces go into the log file as they're made, so the events can't lag behind
+        bool traced = config.GetStr("watch_out") == "-" || config.GetInt("viewer_trace") > 0;
+        _event_log = std::make_shared<EventLog>(
+            EventLog::ParseLevel(config.GetStr("log_level")), 
+            EventLog::ParseCategories(config.GetStrArray("log_categories")), 
+            config.GetStr("event_log"), *_log_file, !traced);
+
         // Instantiate NoC
-        noc = std::make_shared<NoC>(config, _send_queues, _received_queues);
+        noc = std::shared_ptr<NoC>(NoC::New(config, _send_queues, _received_queues, _event_log.get()));
 
         // Instantiate Core Array
-        core_array = std::make_shared<CoreArray>(config, _send_queues, _received_queues, _credit_board);
+        if (parent_cores) {
+            core_array = std::make_shared<CoreArray>(*parent_cores, config, _send_queues, _received_queues, 
+                                                     _credit_board, _event_log.get(), *_log_file);
+        } else {
+            core_array = std::make_shared<CoreArray>(config, _send_queues, _received_queues, _credit_board, 
+                                                     _event_log.get(), *_log_file);
+        }
     } catch (char const* msg) {
-        std::cerr << msg << std::endl;
-        exit(-1);
+        _teardown();
+        throw std::string(msg);
+    } catch (const std::string&) {
+        _teardown();
+        throw;
     }
 
-    // restore cout's original streambuf
-    std::cout.rdbuf(backup);
-
     // setup clock
     _clock = 0;
+    _noc_epoch = 0;
+    _saveInitialState();
+    _setupTelemetry();
+}
+
+
+// The routers and flits go back to the context's pools, so they are released
+// while it is still bound
+SpatialChip::~SpatialChip() {
+    SimContext::Scope scope(_context.get());
+    _teardown();
+}
+
+
+// The event log writes into the log file until it is gone
+void SpatialChip::_teardown() {
+    core_array.reset();
+    noc.reset();
+    _event_log.reset();
+    if (_log_file != &std::cout) {
+        delete _log_file;
+    }
+    _log_file = nullptr;
+}
+
+
+void SpatialChip::_saveInitialState() {
+    StateArchive ar;
+    _checkpoint(ar);
+    _initial_state = ar.image();
 }
 
 
+// Loading the state the chip was built in rewinds the cores, the interface 
+// queues and the network alike, without parsing or building anything again
 void SpatialChip::reset() {
-    // reset clock
-    _clock = 0;
-    // reset queue pairs
-    // reset noc & core
+    StateArchive ar(_initial_state);
+    _checkpoint(ar);
+}
+
+
+void SpatialChip::_setupTelemetry() {
+    _telemetry.reset();
+    int interval = _config.GetInt("telemetry_interval");
+    if (interval <= 0) {
+        return;
+    }
+    int cores = core_array->_cores.size();
+    std::vector<Telemetry::Column> columns = {
+        {"cycle", 1, false},
+        {"link_flits", noc->num_links(), true},
+        {"router_occupancy", noc->num_routers(), false},
+        {"waiting_flits", cores, false},
+        {"in_flight_flits", 1, false},
+        {"core_busy", cores, true},
+        {"core_idle", cores, true},
+        {"ni_send_depth", cores, false},
+        {"ni_receive_depth", cores, false},
+    };
+    _telemetry.reset(new Telemetry(interval, std::max(1, _config.GetInt("telemetry_samples")), columns));
+    _readTelemetry();
+    _telemetry->restart();
+}
+
+
+void SpatialChip::_readTelemetry() {
+    _telemetry->readings(TELEMETRY_CYCLE)[0] = _clock;
+    noc->read_link_flits(_telemetry->readings(TELEMETRY_LINK_FLITS));
+    noc->read_router_occupancy(_telemetry->readings(TELEMETRY_ROUTER_OCCUPANCY));
+    noc->read_waiting_flits(_telemetry->readings(TELEMETRY_WAITING_FLITS));
+    _telemetry->readings(TELEMETRY_IN_FLIGHT_FLITS)[0] = noc->in_flight_flits();
+    uint64_t* busy = _telemetry->readings(TELEMETRY_CORE_BUSY);
+    uint64_t* idle = _telemetry->readings(TELEMETRY_CORE_IDLE);
+    uint64_t* receive = _telemetry->readings(TELEMETRY_NI_RECEIVE_DEPTH);
+    for (const CORE& c: core_array->_cores) {
+        *busy++ = c.getBusyCycles();
+        *idle++ = c.getIdleCycles();
+        *receive++ = c.getReceiveDepth();
+    }
+    uint64_t* send = _telemetry->readings(TELEMETRY_NI_SEND_DEPTH);
+    for (const CNInterface& q: *_send_queues) {
+        *send++ = q->size();
+    }
+}
+
+
+// Values come as text and are converted to the type of the parameter
+static void assignParameter(SpatialSimConfig& config, const std::string& name, const std::string& value) {
+    try {
+        if (config.GetIntMap().count(name)) {
+            config.Assign(name, std::stoi(value));
+        } else if (config.GetFloatMap().count(name)) {
+            config.Assign(name, std::stod(value));
+        } else if (config.GetStrMap().count(name)) {
+            config.Assign(name, value);
+        } else {
+            throw std::string("Unknown parameter: ") + name;
+        }
+    } catch (const std::logic_error&) {
+        throw std::string("Invalid value of ") + name + ": " + value;
+    }
 }
 
 
-unsigned int SpatialChip::run() {
+void SpatialChip::reconfigure(const std::map<std::string, std::string>& parameters) {
+    SpatialSimConfig config = _config;
+    bool rebuild_noc = false;
+    bool reload_latency = false;
+    for (const auto& p: parameters) {
+        if (CHIP_PARAMETERS.count(p.first)) {
+            throw p.first + " can't be changed by reconfigure, it needs a new chip";
+        }
+        assignParameter(config, p.first, p.second);
+        if (p.first == "micro_instr_latency") {
+            reload_latency = true;
+        } else if (!RUN_PARAMETERS.count(p.first)) {
+            rebuild_noc = true;
+        }
+    }
+    checkTelemetryInterval(config);
+
+    SimContext::Scope scope(_context.get());
     reset();
+    try {
+        if (reload_latency) {
+            core_array->setLatency(config.GetStr("micro_instr_latency"));
+        }
+        if (rebuild_noc) {
+            // The old network goes first, booksim keeps its routing in globals
+            noc.reset();
+            try {
+                noc = std::shared_ptr<NoC>(NoC::New(config, _send_queues, _received_queues, _event_log.get()));
+            } catch (char const* msg) {
+                noc = std::shared_ptr<NoC>(NoC::New(_config, _send_queues, _received_queues, _event_log.get()));
+                throw std::string(msg);
+            } catch (const std::string&) {
+                noc = std::shared_ptr<NoC>(NoC::New(_config, _send_queues, _received_queues, _event_log.get()));
+                throw;
+            }
+        }
+    } catch (char const* msg) {
+        throw std::string(msg);
+    }
+    _config = config;
+    _saveInitialState();
+    _setupTelemetry();
+}
+
+
+unsigned int SpatialChip::run(unsigned int until) {
+    SimContext::Scope scope(_context.get());
     int check_frequency = _config.GetInt("deadlock_check_freq");
-    std::streambuf *backup = std::cout.rdbuf();
-    std::cout.rdbuf(_log_file->rdbuf());
-    
+    bool fast_forward = _config.GetInt("fast_forward") > 0;
+
     while (!task_finished(_clock)) {
-        core_array->step(_clock);
-        noc->step(_clock);
-
-        _clock++;
-        if (_clock % check_frequency  == 0) {
-            std::cout << "Simulate " << _clock << " cycles" << std::endl;
-            if (check_deadlock()) {
-                std::cerr << "Deadlock detected: the chip state keeps unchanged over " << check_frequency << " cycles" << std::endl;
-                display_stats();
-                exit(1); 
+        if (_clock >= until) {
+            _event_log->Flush();
+            return _clock;
+        }
+        unsigned int next = fast_forward ? std::min(next_event(), until) : _clock;
+        if (_telemetry) {
+            // A sample reads the state at its cycle, so skips stop there
+            next = std::min(next, (_clock / _telemetry->interval() + 1) * _telemetry->interval());
+        }
+        if (next > _clock) {
+            core_array->skip(next);
+            noc->skip(_clock, next - _clock);
+        } else {
+            core_array->step(_clock);
+            noc->step(_clock);
+            next = _clock + 1;
+        }
+
+        // Visit every check point up to the next clock, as stepping one by one 
+        // would. The sample, if any, is at the next clock itself.
+        while (_clock < next) {
+            _clock = std::min(next, (_clock / check_frequency + 1) * check_frequency);
+            if (_telemetry && _clock % _telemetry->interval() == 0) {
+                _readTelemetry();
+                _telemetry->sample();
             }
+            if (_clock % check_frequency  == 0) {
+                _event_log->Flush();
+                *_log_file << "Simulate " << _clock << " cycles" << std::endl;
+                if (check_deadlock()) {
+                    std::cerr << "Deadlock detected: the chip state keeps unchanged over " << check_frequency << " cycles" << std::endl;
+                    display_stats(*_log_file);
+                    _event_log->Close();
+                    exit(1); 
+                }
 #ifdef DUMP_NODE_STATE
-            std::ofstream out("dump.log", std::ios::out|std::ios::app);
-            out.close();
+                std::ofstream out("dump.log", std::ios::out|std::ios::app);
+                out.close();
 #endif
+            }
         }
-
     }
-    std::cout << _clock << " | " << "Task Is Finished " << std::endl;
+    _event_log->Flush();
+    *_log_file << _clock << " | " << "Task Is Finished " << std::endl;
+    noc->DisplayPoolStats(*_log_file);
+    if (_telemetry && _config.GetStr("telemetry_file") != "" && !_telemetry->dump(_config.GetStr("telemetry_file"))) {
+        std::cerr << "WARNING: Failed to write the telemetry file " << _config.GetStr("telemetry_file") << std::endl;
+    }
 
-    // restore cout's original streambuf
-    std::cout.rdbuf(backup);
-    
     return _clock;
 }
 
-bool SpatialChip::task_finished(int _clock) {
-    return noc->traffic_drained() && core_array->allCoreClosed(_clock);
+// Everything but the configuration, in the order: chip, cores, NoC. Flits and
+// credits of the NoC are all recreated by loading.
+void SpatialChip::_checkpoint(StateArchive& ar) {
+    SimContext::Scope scope(_context.get());
+    if (ar.loading()) {
+        Flit::FreeAll();
+        Credit::FreeAll();
+    }
+    ar & _clock;
+    // The queues are shared with the cores and the NoC, so only their packets go
+    ar.Check((int)_send_queues->size(), "the number of cores");
+    for (CNInterface& q : *_send_queues) {
+        ar & *q;
+    }
+    for (CNInterface& q : *_received_queues) {
+        ar & *q;
+    }
+    ar & *_credit_board & _context->random;
+    core_array->Checkpoint(ar);
+    ar.Check(_config.GetStr("noc_model"), "the NoC model");
+    noc->Checkpoint(ar);
+    ar & _noc_epoch;
+    if (ar.loading() && _telemetry) {
+        _readTelemetry();
+        _telemetry->restart();
+    }
 }
 
-bool SpatialChip::check_deadlock() {
 
-    static std::pair<PCNInterfaceSet, PCNInterfaceSet> queue_pair_backup = std::make_pair(nullptr, nullptr);
-    bool deadlock = true;
+void SpatialChip::save_checkpoint(const std::string& path) {
+    StateArchive ar;
+    _checkpoint(ar);
 
-    if (queue_pair_backup.first == nullptr) {
-        deadlock = false;
-    } else {
-        deadlock &= !core_array->stateChanged();
-        deadlock &= (*(queue_pair_backup.first) == *_send_queues) && (*(queue_pair_backup.second) == *_received_queues);
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    file.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    file.write(reinterpret_cast<const char*>(&CHECKPOINT_VERSION), sizeof(CHECKPOINT_VERSION));
+    file.write(ar.image().data(), ar.image().size());
+    if (!file) {
+        throw std::string("Failed to write the checkpoint ") + path;
+    }
+}
+
+
+void SpatialChip::load_checkpoint(const std::string& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    uint32_t version;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!file || memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0) {
+        throw std::string("Not a checkpoint: ") + path;
+    }
+    if (version != CHECKPOINT_VERSION) {
+        throw std::string("Unsupported checkpoint version: ") + path;
+    }
+    std::string image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    StateArchive ar(image);
+    _checkpoint(ar);
+    if (!ar.exhausted()) {
+        throw std::string("The checkpoint doesn't match this simulation: it has trailing state");
+    }
+}
+
+
+// The child shares the compiled tasks, the latencies and the routing board of
+// this chip, which are never written, and builds its own network. Everything
+// that changes while simulating goes over through an in-memory checkpoint.
+std::unique_ptr<SpatialChip> SpatialChip::fork(const std::string& log_file) {
+    SpatialSimConfig config = _config;
+    config.Assign("log_file", log_file);
+    config.Assign("event_log", std::string(""));
+    config.Assign("telemetry_file", std::string(""));
+    std::unique_ptr<SpatialChip> child(new SpatialChip(config, *core_array));
+
+    StateArchive saved;
+    _checkpoint(saved);
+    StateArchive loaded(saved.image());
+    child->_checkpoint(loaded);
+    return child;
+}
+
+
+// The next cycle at which anything may happen on the chip. Cycles before it are
+// skipped only if every unfinished core is busy and the network has nothing to
+// do before it, so that skipping is exact: no core or router would have done
+// anything on them.
+unsigned int SpatialChip::next_event() {
+    unsigned int noc_event = noc->next_event(_clock);
+    if (noc_event <= _clock) {
+        return _clock;
+    }
+    int wakeup = core_array->wakeupCycle(_clock);
+    if (wakeup <= (int)_clock + 1) {
+        return _clock;
     }
+    return std::min((unsigned int)wakeup, noc_event);
+}
 
-    std::vector<CNInterface> sq_bu = *_send_queues, rq_bu = *_received_queues;
-    queue_pair_backup.first = std::make_shared<vector<CNInterface> >(sq_bu);
-    queue_pair_backup.second = std::make_shared<vector<CNInterface> >(rq_bu);
+bool SpatialChip::task_finished(int _clock) {
+    SimContext::Scope scope(_context.get());
+    return noc->traffic_drained() && core_array->allCoreClosed(_clock);
+}
 
-    return deadlock;
+// The chip is deadlocked if no core has issued or retired an instruction and no
+// flit has moved since the last check, while no core is running one that would
+// still complete.
+bool SpatialChip::check_deadlock() {
+    SimContext::Scope scope(_context.get());
+    bool progress = core_array->stateChanged();
+    unsigned long noc_epoch = noc->progress();
+    progress |= (noc_epoch != _noc_epoch);
+    _noc_epoch = noc_epoch;
+    return !progress && !core_array->anyCoreBusy(_clock);
 }
 
 
 void SpatialChip::display_stats(std::ostream & os) {
+    SimContext::Scope scope(_context.get());
+    _event_log->Flush();
 
     os << std::endl << " ================== Dumped Stats ================== " << std::endl;
     core_array->DisplayStats(os);
@@ -149,6 +479,7 @@ void SpatialChip::display_stats(std::ostream & os) {
 }
 
 std::vector<int> SpatialChip::compute_cycles() {
+    SimContext::Scope scope(_context.get());
     std::vector<int> ret(core_array->_cores.size());
     std::vector<int>::iterator rit = ret.begin();
     std::vector<spatial::CORE>::iterator cit = core_array->_cores.begin();
@@ -159,6 +490,7 @@ std::vector<int> SpatialChip::compute_cycles() {
 }
 
 std::vector<int> SpatialChip::communicate_cycles() {
+    SimContext::Scope scope(_context.get());
     std::vector<int> ret(core_array->_cores.size());
     std::vector<int>::iterator rit = ret.begin();
     std::vector<spatial::CORE>::iterator cit = core_array->_cores.begin();
@@ -168,8 +500,14 @@ std::vector<int> SpatialChip::communicate_cycles() {
     return ret;
 }
 
-std::vector<double> SpatialChip::router_conflict_factors() {
-    return noc->router_conflict_factors();
+std::vector<double> SpatialChip::router_conflict_factors(bool window) {
+    SimContext::Scope scope(_context.get());
+    return noc->router_conflict_factors(window);
+}
+
+int SpatialChip::router_port_conflicts(std::vector<unsigned long>& requests, std::vector<unsigned long>& grants) {
+    SimContext::Scope scope(_context.get());
+    return noc->router_port_conflicts(requests, grants);
 }
 
 };
\ No newline at end of file
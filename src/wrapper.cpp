@@ -1,9 +1,17 @@
 #include "spatial_chip.hpp"
 #include "pybind11/pybind11.h"
+#include "pybind11/numpy.h"
 #include "pybind11/stl.h"
 
 namespace py = pybind11;
 
+template <class T>
+static py::array_t<T> toArray(const std::vector<T>& values, std::vector<ssize_t> shape) {
+    py::array_t<T> array(shape);
+    std::copy(values.begin(), values.end(), array.mutable_data());
+    return array;
+}
+
 PYBIND11_MODULE(simulator, m) {
     m.doc() = R"pbdoc(
         Pybind11 simulator plugin
@@ -18,16 +26,77 @@ PYBIND11_MODULE(simulator, m) {
            is_finished
            is_deadlock
            reset
+           reconfigure
            display_stats
+           save_checkpoint
+           load_checkpoint
+           fork
+           router_conflict_factors
+           router_port_conflicts
+           telemetry
     )pbdoc";
 
+    // Checkpoints that don't fit the chip, or can't be read, throw strings
+    py::register_exception_translator([](std::exception_ptr p) {
+        try {
+            if (p) {
+                std::rethrow_exception(p);
+            }
+        } catch (const std::string& msg) {
+            PyErr_SetString(PyExc_RuntimeError, msg.c_str());
+        }
+    });
+
     py::class_<spatial::SpatialChip>(m, "SpatialChip")
-        .def(py::init<const std::string &>())
-        .def("run", &spatial::SpatialChip::run)
+        // Chips are independent, so other Python threads may simulate meanwhile
+        .def(py::init<const std::string &>(), py::call_guard<py::gil_scoped_release>())
+        .def("run", &spatial::SpatialChip::run, py::arg("until") = UINT_MAX, 
+             py::call_guard<py::gil_scoped_release>())
         .def("is_finished", &spatial::SpatialChip::task_finished)
         .def("is_deadlock", &spatial::SpatialChip::check_deadlock)
-        .def("reset", &spatial::SpatialChip::reset)
+        .def("reset", &spatial::SpatialChip::reset, py::call_guard<py::gil_scoped_release>())
+        // Values may be given as numbers too, they are converted like the spec's
+        .def("reconfigure", [](spatial::SpatialChip& chip, py::dict parameters) {
+            std::map<std::string, std::string> values;
+            for (auto item: parameters) {
+                values[py::str(item.first)] = py::str(item.second);
+            }
+            py::gil_scoped_release release;
+            chip.reconfigure(values);
+        })
         .def("compute_cycles", &spatial::SpatialChip::compute_cycles)
         .def("communicate_cycles", &spatial::SpatialChip::communicate_cycles)
-        .def("router_conflict_factors", &spatial::SpatialChip::router_conflict_factors);
+        .def("router_conflict_factors", [](spatial::SpatialChip& chip, bool window) {
+            std::vector<double> factors = chip.router_conflict_factors(window);
+            return toArray(factors, {(ssize_t)factors.size()});
+        }, py::arg("window") = false)
+        // Arrays of routers x output ports
+        .def("router_port_conflicts", [](spatial::SpatialChip& chip) {
+            std::vector<unsigned long> requests, grants, denials;
+            int ports = chip.router_port_conflicts(requests, grants);
+            for (size_t i = 0; i < requests.size(); ++i) {
+                denials.push_back(requests[i] - grants[i]);
+            }
+            std::vector<ssize_t> shape = {ports > 0 ? (ssize_t)(requests.size() / ports) : 0, ports};
+            py::dict conflicts;
+            conflicts["requests"] = toArray(requests, shape);
+            conflicts["grants"] = toArray(grants, shape);
+            conflicts["denials"] = toArray(denials, shape);
+            return conflicts;
+        })
+        // Column name -> array of samples x values, empty if telemetry is disabled
+        .def("telemetry", [](spatial::SpatialChip& chip) {
+            py::dict columns;
+            const spatial::Telemetry* telemetry = chip.telemetry();
+            for (int c = 0; telemetry && c < telemetry->columns(); ++c) {
+                py::array_t<uint32_t> series({(ssize_t)telemetry->samples(), (ssize_t)telemetry->column(c).width});
+                telemetry->series(c, series.mutable_data());
+                columns[telemetry->column(c).name.c_str()] = series;
+            }
+            return columns;
+        })
+        .def("save_checkpoint", &spatial::SpatialChip::save_checkpoint, py::call_guard<py::gil_scoped_release>())
+        .def("load_checkpoint", &spatial::SpatialChip::load_checkpoint, py::call_guard<py::gil_scoped_release>())
+        .def("fork", &spatial::SpatialChip::fork, py::arg("log_file") = "-", 
+             py::call_guard<py::gil_scoped_release>());
 }
\ No newline at end of file